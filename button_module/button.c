@@ -24,7 +24,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "button.h"
+#include "button_history.h"
+#include "button_log.h"
+#include "button_trace.h"
 
 typedef enum 
 {
@@ -32,24 +36,100 @@ typedef enum
     SUCCESS = 0
 } init_status_t;
 
-typedef struct
+#if (BUTTON_INSTANCE_TLS > 0)
+#define INSTANCE_STORAGE    _Thread_local
+#else
+#define INSTANCE_STORAGE
+#endif
+
+#define TICK_DIFF(tick) (p_inst->p_api->fp_tick_elapsed(tick, p_inst->p_api->fp_get_current_tick()))
+
+static button_instance_t default_instance = {0};
+static INSTANCE_STORAGE button_instance_t * p_inst = &default_instance;
+
+/*
+ * With BUTTON_CROSS_CORE the ISR runs on another core than the initialization,
+ * so ready is published with a release store once the state is set up and read
+ * with an acquire load: an ISR that sees it set also sees the state.
+ */
+#if (BUTTON_CROSS_CORE > 0)
+#define READY_GET()         (__atomic_load_n(&p_inst->ready, __ATOMIC_ACQUIRE))
+#define READY_SET(value)    (__atomic_store_n(&p_inst->ready, (value), __ATOMIC_RELEASE))
+#else
+#define READY_GET()         (p_inst->ready)
+#define READY_SET(value)    (p_inst->ready = (value))
+#endif
+
+#if (BUTTON_CYCLE_STATS > 0)
+#define CYCLE_START(mark)           ((mark) = cycle_now())
+#define CYCLE_LAP(mark, p_stat)     cycle_add((p_stat), cycle_lap(&(mark)))
+#else
+#define CYCLE_START(mark)
+#define CYCLE_LAP(mark, p_stat)
+#endif
+
+#if (BUTTON_CYCLE_STATS > 0)
+/**
+ * @fn     cycle_now
+ * @brief  Read the cycle counter, or 0 when no fp_cycle_counter is configured.
+ */
+
+static uint32_t cycle_now(void)
 {
-    uint32_t first;
-    uint32_t last;
-} detection_pressed_tick_t;
+    return (NULL != p_inst->p_api->fp_cycle_counter) ? p_inst->p_api->fp_cycle_counter() : 0;
+}
 
-#define TICK_DIFF(tick) (p_api->fp_tick_elapsed(tick, p_api->fp_get_current_tick()))
-#define DETECT_SINGLE_BUTTON_PRESS_IN_US    (500000) 
+/**
+ * @fn     cycle_lap
+ * @brief  Cycles elapsed since *p_mark; restarts the lap at the current count.
+ *
+ * @param  p_mark  Counter value at the start of the lap, updated to now.
+ * @return Elapsed cycles (modulo 2^32, so counter wraps are harmless).
+ */
 
-static button_api_t * p_api = NULL;
-static init_status_t button_init_status = FAIL;
-static detection_pressed_tick_t pressed_tick[BUTTON_MAX] = {{0}};
+static uint32_t cycle_lap(uint32_t * p_mark)
+{
+    uint32_t now = cycle_now();
+    uint32_t elapsed = now - *p_mark;
+    *p_mark = now;
+    return elapsed;
+}
+
+/**
+ * @fn     cycle_add
+ * @brief  Accumulate one measurement into a min/total/max record.
+ *
+ * Nothing is recorded without fp_cycle_counter, so the statistics stay empty.
+ *
+ * @param  p_stat  Statistics of one stage.
+ * @param  cycles  Measured cycles.
+ */
+
+static void cycle_add(button_cycle_stat_t * p_stat, uint32_t cycles)
+{
+    if (NULL != p_inst->p_api->fp_cycle_counter)
+    {
+        if ((0 == p_stat->count) || (cycles < p_stat->min))
+        {
+            p_stat->min = cycles;
+        }
+        if (cycles > p_stat->max)
+        {
+            p_stat->max = cycles;
+        }
+        p_stat->total += cycles;
+        p_stat->count++;
+    }
+}
+#endif
 
 /**
  * @fn     find_pin_id
  * @brief  Locate the index of a given GPIO pin in the configured button list.
  *
- * Searches through the p_api->button_pins array for a matching pin value.
+ * Pins below BUTTON_PIN_LUT_SIZE are resolved through the pin_slot table built at
+ * initialization; higher pin numbers fall back to searching the interrupt-driven
+ * entries of p_api->button_pins.
  *
  * @param  pin  GPIO pin number to search for.
  * @return Index (0..size_of_buttons-1) of the matching entry, or -1 if not found.
@@ -59,9 +139,14 @@ static int8_t find_pin_id(uint8_t pin)
 {
     int8_t index = -1;
     uint8_t i = 0;
-    while (i <= p_api->size_of_buttons-1)
+    if (pin < BUTTON_PIN_LUT_SIZE)
     {
-        if (p_api->button_pins[i].pin == pin)
+        return (int8_t)(p_inst->p_derived->pin_slot[pin] - 1);
+    }
+    while (i <= p_inst->p_api->size_of_buttons-1)
+    {
+        if ((p_inst->p_api->button_pins[i].pin == pin)
+            && (BUTTON_INTERRUPT_MODE_NONE != p_inst->p_api->button_pins[i].interrupt_mode))
         {
             index = i;
             break;
@@ -71,6 +156,156 @@ static int8_t find_pin_id(uint8_t pin)
     return index;
 }
 
+/**
+ * @fn     to_stamp
+ * @brief  Turn a tick into a storable timestamp.
+ *
+ * Stored timestamps use 0 for "unset", so a tick counter that wraps to exactly 0
+ * would make a real edge or counted press disappear. Such ticks are stored as
+ * UINT32_MAX instead, one tick early: a stamp one tick late would lie in the
+ * future and read as an elapsed time of almost a full wrap. Every timestamp the
+ * driver stores goes through here.
+ *
+ * @param  tick  Tick to store.
+ * @return tick, or UINT32_MAX if tick is 0.
+ */
+
+static uint32_t to_stamp(uint32_t tick)
+{
+    return (0 != tick) ? tick : UINT32_MAX;
+}
+
+/**
+ * @fn     stamp_now
+ * @brief  Current tick for storing as a timestamp (see to_stamp).
+ *
+ * @return The current tick, never 0.
+ */
+
+static uint32_t stamp_now(void)
+{
+    return to_stamp(p_inst->p_api->fp_get_current_tick());
+}
+
+/**
+ * @fn     rebase_tick
+ * @brief  Shift a stored timestamp across a time discontinuity.
+ *
+ * A timestamp is considered to predate the discontinuity when at least delta_tick
+ * ticks have elapsed since it; such timestamps are moved forward by delta_tick so
+ * that the time spent asleep or paused is not counted. Unset (0) timestamps and
+ * timestamps taken after the discontinuity are returned unchanged.
+ *
+ * @param  tick        Stored timestamp (0 = unset).
+ * @param  now         Current tick.
+ * @param  delta_tick  Length of the discontinuity in ticks.
+ * @return The rebased timestamp, never 0 unless tick was 0.
+ */
+
+static uint32_t rebase_tick(uint32_t tick, uint32_t now, uint32_t delta_tick)
+{
+    if ((0 != tick) && (p_inst->p_api->fp_tick_elapsed(tick, now) >= delta_tick))
+    {
+        tick = to_stamp(tick + delta_tick);
+    }
+    return tick;
+}
+
+/**
+ * @fn     emit_event
+ * @brief  Deliver an event to the application and to the enabled diagnostics.
+ *
+ * Every event leaves the driver through here, so the history ring (when
+ * BUTTON_HISTORY_SIZE > 0) and the event log (when BUTTON_LOG_SIZE > 0) see
+ * exactly what fp_event_callback sees. Both are single process-wide buffers
+ * without locking, so only events of the built-in instance are recorded; events
+ * of instances chosen with button_select_instance() are not. The emit and
+ * callback tracepoints bracket the application callback so its duration shows
+ * up in traces. With BUTTON_CYCLE_STATS the whole delivery counts as the
+ * dispatch stage.
+ *
+ * @param  type   Event type.
+ * @param  index  Index of the button in the configuration array.
+ */
+
+static void emit_event(button_pressed_types_t type, uint8_t index)
+{
+#if (BUTTON_CYCLE_STATS > 0)
+    uint32_t mark = cycle_now();
+    uint32_t cycles = 0;
+#endif
+#if (BUTTON_HISTORY_SIZE > 0) || (BUTTON_LOG_SIZE > 0)
+    uint32_t tick = p_inst->p_api->fp_get_current_tick();
+#endif
+#if (BUTTON_HISTORY_SIZE > 0)
+    if (&default_instance == p_inst)
+    {
+        button_history_record(type, (button_enum)index, tick);
+    }
+#endif
+#if (BUTTON_LOG_SIZE > 0)
+    if (&default_instance == p_inst)
+    {
+        button_log_record(type, (button_enum)index, tick);
+    }
+#endif
+    BUTTON_TRACE_EMIT(index, type);
+    BUTTON_TRACE_CALLBACK_BEGIN(index, type);
+    p_inst->p_api->fp_event_callback(type, (button_enum)index);
+    BUTTON_TRACE_CALLBACK_END(index, type);
+#if (BUTTON_CYCLE_STATS > 0)
+    cycles = cycle_lap(&mark);
+    p_inst->dispatch_cycles += cycles;
+    cycle_add(&p_inst->cycle_stats.stage[index][BUTTON_STAGE_DISPATCH], cycles);
+#endif
+}
+
+/**
+ * @fn     latch_event_info
+ * @brief  Copy the edges of the press being classified into the reported event info.
+ *
+ * Called right before a press is accepted, while pressed_tick still holds its edges,
+ * so that `button_get_event_info()` describes the press behind the next event.
+ *
+ * @param  index  Index of the button in the configuration array.
+ */
+
+static void latch_event_info(uint8_t index)
+{
+    p_inst->event_info[index].press_tick = p_inst->pressed_tick[index].first;
+    p_inst->event_info[index].release_tick = p_inst->pressed_tick[index].last;
+    p_inst->event_info[index].press_uncertainty_tick = p_inst->pending_info[index].press_uncertainty_tick;
+    p_inst->event_info[index].release_uncertainty_tick = p_inst->pending_info[index].release_uncertainty_tick;
+    p_inst->pending_info[index].press_uncertainty_tick = 0;
+    p_inst->pending_info[index].release_uncertainty_tick = 0;
+}
+
+/**
+ * @fn     interpolate_edge
+ * @brief  Estimate when a polled button changed level between two samples.
+ *
+ * The edge happened somewhere between the previous sample and this one, so the
+ * midpoint is returned and half the sample gap is stored as its uncertainty.
+ * Without a previous sample the current sample tick is returned with no uncertainty.
+ *
+ * @param  index            Index of the button in the configuration array.
+ * @param  sample           Tick of the current sample.
+ * @param  p_uncertainty    Receives the half-gap uncertainty in ticks.
+ * @return Estimated edge tick, never 0.
+ */
+
+static uint32_t interpolate_edge(uint8_t index, uint32_t sample, uint32_t * p_uncertainty)
+{
+    uint32_t edge = sample;
+    *p_uncertainty = 0;
+    if (0 != p_inst->prev_sample_tick[index])
+    {
+        *p_uncertainty = p_inst->p_api->fp_tick_elapsed(p_inst->prev_sample_tick[index], sample) / 2;
+        edge = p_inst->prev_sample_tick[index] + *p_uncertainty;
+    }
+    return to_stamp(edge);
+}
+
 /**
  * @fn     detect_the_press
  * @brief  Process and detect button press events for a specific button index.
@@ -81,6 +316,11 @@ static int8_t find_pin_id(uint8_t pin)
  * short presses, resets tick counters, and returns the tick at which a short press
  * was confirmed.
  *
+ * The debounce window after the last edge is the button's release_debounce_us, or
+ * debounce_us when that is 0. A press shorter than press_debounce_us is dropped as
+ * a glitch without an event. A pin marked hw_filtered is clean already, so neither
+ * applies: the press is classified as soon as the pin reads released.
+ *
  * @param  index   Index of the button in the configuration array.
  * @param  p_count Pointer to the variable tracking the number of short presses.
  *                This will be incremented when a valid press is detected.
@@ -92,24 +332,42 @@ static int8_t find_pin_id(uint8_t pin)
 static uint32_t detect_the_press(uint8_t index, uint8_t *p_count)
 {
     uint32_t last_count_tick = 0;
-    if ((0 != pressed_tick[index].first) && (0 != pressed_tick[index].last ))
+    if ((0 != p_inst->pressed_tick[index].first) && (0 != p_inst->pressed_tick[index].last ))
     {
-        if (TICK_DIFF(pressed_tick[index].last ) > p_api->debounce_us*p_api->tick_count_in_1us)
+        const pin_config_t * p_pin = &p_inst->p_api->button_pins[index];
+        uint32_t release_tick = (0 != p_inst->p_derived->release_debounce_tick[index]) ? p_inst->p_derived->release_debounce_tick[index]
+                                                                                     : p_inst->p_derived->debounce_tick;
+        uint8_t settled = p_pin->hw_filtered ? (0 == (p_inst->pressed_mask & (1UL << index)))
+                                             : (TICK_DIFF(p_inst->pressed_tick[index].last ) > release_tick);
+        if (settled)
         {
-            if (p_api->fp_tick_elapsed(pressed_tick[index].first, pressed_tick[index].last ) > p_api->long_press_us * p_api->tick_count_in_1us)
+            uint32_t held = p_inst->p_api->fp_tick_elapsed(p_inst->pressed_tick[index].first, p_inst->pressed_tick[index].last );
+            if ((!p_pin->hw_filtered) && (held < p_inst->p_derived->press_debounce_tick[index]))
+            {
+                BUTTON_TRACE_DECISION(index, BUTTON_TRACE_DECISION_GLITCH, *p_count);
+                p_inst->pending_info[index].press_uncertainty_tick = 0;
+                p_inst->pending_info[index].release_uncertainty_tick = 0;
+                p_inst->pressed_tick[index].first = 0;
+                p_inst->pressed_tick[index].last  = 0;
+            }
+            else if (held > p_inst->p_derived->long_press_tick)
             {
-                p_api->fp_event_callback(BUTTON_LONG_PRESS, (button_enum)index);
-                pressed_tick[index].first = 0;
-                pressed_tick[index].last  = 0;
+                BUTTON_TRACE_DECISION(index, BUTTON_TRACE_DECISION_LONG, *p_count);
+                latch_event_info(index);
+                emit_event(BUTTON_LONG_PRESS, index);
+                p_inst->pressed_tick[index].first = 0;
+                p_inst->pressed_tick[index].last  = 0;
             }
             else
             {
-                if (TICK_DIFF(pressed_tick[index].last ) < DETECT_SINGLE_BUTTON_PRESS_IN_US*p_api->tick_count_in_1us)
+                if (TICK_DIFF(p_inst->pressed_tick[index].last ) < p_inst->p_derived->multi_press_tick)
                 {
                     (*p_count)++;
-                    pressed_tick[index].first = 0;
-                    pressed_tick[index].last  = 0;
-                    last_count_tick = p_api->fp_get_current_tick();
+                    BUTTON_TRACE_DECISION(index, BUTTON_TRACE_DECISION_COUNTED, *p_count);
+                    latch_event_info(index);
+                    p_inst->pressed_tick[index].first = 0;
+                    p_inst->pressed_tick[index].last  = 0;
+                    last_count_tick = stamp_now();
                 }
             }
         }
@@ -122,8 +380,9 @@ static uint32_t detect_the_press(uint8_t index, uint8_t *p_count)
  * @brief  Evaluate accumulated press counts and invoke the appropriate button event.
  *
  * This function calls `detect_the_press` to update the short-press count and retrieves
- * the tick at which the last valid press occurred. It uses static storage to track
- * the last press tick and count for each button index. If the elapsed time since the
+ * the tick at which the last valid press occurred. It uses the module-level
+ * record_last_tick/press_count arrays to track the last press tick and count for
+ * each button index. If the elapsed time since the
  * last detected press exceeds the single-press timeout, it resets the record and:
  *   - Fires `BUTTON_NORMAL_PRESS` if exactly one press was counted.
  *   - Fires `BUTTON_DOUBLE_PRESS` if exactly two presses were counted.
@@ -134,61 +393,522 @@ static uint32_t detect_the_press(uint8_t index, uint8_t *p_count)
 
 static void desicion_by_pressed_count(uint8_t index)
 {
-    static uint32_t check_last_tick = 0;
-    static uint32_t record_last_tick[BUTTON_MAX] = {0};
-    static uint8_t press_count[BUTTON_MAX] = {0};
-    check_last_tick = detect_the_press(index, &press_count[index]);
+    uint32_t check_last_tick = detect_the_press(index, &p_inst->press_count[index]);
     if (0 != check_last_tick)
     {
-        record_last_tick[index] = check_last_tick;   
+        p_inst->record_last_tick[index] = check_last_tick;   
     }
 
-    if ((0 != record_last_tick[index]) && (press_count[index] > 0)
-        && (TICK_DIFF(record_last_tick[index]) > DETECT_SINGLE_BUTTON_PRESS_IN_US*p_api->tick_count_in_1us)) 
+    if ((0 != p_inst->record_last_tick[index]) && (p_inst->press_count[index] > 0)
+        && (TICK_DIFF(p_inst->record_last_tick[index]) > p_inst->p_derived->multi_press_tick)) 
     {
-        record_last_tick[index] = 0;
-        if (1 == press_count[index])
+        p_inst->record_last_tick[index] = 0;
+        BUTTON_TRACE_DECISION(index, BUTTON_TRACE_DECISION_SETTLED, p_inst->press_count[index]);
+        if (1 == p_inst->press_count[index])
         {
-            p_api->fp_event_callback(BUTTON_NORMAL_PRESS, (button_enum)index);
+            emit_event(BUTTON_NORMAL_PRESS, index);
         }
         else
         {
-            if (2 == press_count[index])
+            if (2 == p_inst->press_count[index])
             {
-                p_api->fp_event_callback(BUTTON_DOUBLE_PRESS, (button_enum)index);
+                emit_event(BUTTON_DOUBLE_PRESS, index);
             }
         }
-        press_count[index] = 0;
+        p_inst->press_count[index] = 0;
     }    
 }
 
+/**
+ * @fn     check_hold_levels
+ * @brief  Emit the next hold level of a button once its hold passes that threshold.
+ *
+ * Runs in the scan that already times the press, and only compares against the
+ * next threshold, so levels cost no extra timer or polling. Levels restart when
+ * the press is classified; a hold that ends before a threshold never emits it.
+ * The hold levels do not change button_get_event_info(), which still describes
+ * the last classified press.
+ *
+ * @param  index  Index of the button in the configuration array.
+ */
+
+static void check_hold_levels(uint8_t index)
+{
+    uint8_t level = p_inst->hold_level[index];
+    const uint32_t * p_hold = p_inst->p_derived->hold_tick[index];
+    if (0 == p_inst->pressed_tick[index].first)
+    {
+        p_inst->hold_level[index] = 0;
+    }
+    else if ((level < BUTTON_HOLD_LEVELS) && (0 != p_hold[level])
+             && (0 != (p_inst->pressed_mask & (1UL << index)))
+             && (TICK_DIFF(p_inst->pressed_tick[index].first) > p_hold[level]))
+    {
+        p_inst->hold_level[index] = (uint8_t)(level + 1);
+        emit_event((button_pressed_types_t)(BUTTON_HOLD_LEVEL_1 + level), index);
+    }
+}
+
+/**
+ * @fn     latch_modifiers
+ * @brief  Remember which other buttons were held when a button's gesture began.
+ *
+ * Taken at the first scan that sees the first press of a gesture, so a modifier
+ * released before the event is delivered (after the release debounce and the
+ * multi-press window) still selects the layer, as in keyboard firmware.
+ *
+ * @param  index  Index of the button in the configuration array.
+ */
+
+static void latch_modifiers(uint8_t index)
+{
+    uint32_t bit = 1UL << index;
+    if ((0 != p_inst->pressed_tick[index].first) && (0 == p_inst->press_count[index])
+        && (0 == (p_inst->modifiers_latched & bit)))
+    {
+        p_inst->press_modifiers[index] = p_inst->pressed_mask & ~bit;
+        p_inst->modifiers_latched |= bit;
+    }
+}
+
+/**
+ * @fn     us_to_tick
+ * @brief  Convert a duration to ticks, rejecting results that overflow 32 bits.
+ *
+ * @param  us                 Duration in microseconds.
+ * @param  tick_count_in_1us  Ticks per microsecond.
+ * @param  p_tick             Receives the duration in ticks.
+ * @return SUCCESS, or FAIL on overflow.
+ */
+
+static init_status_t us_to_tick(uint32_t us, uint32_t tick_count_in_1us, uint32_t * p_tick)
+{
+    init_status_t ret = FAIL;
+    if (us <= (UINT32_MAX / tick_count_in_1us))
+    {
+        *p_tick = us * tick_count_in_1us;
+        ret = SUCCESS;
+    }
+    return ret;
+}
+
+/**
+ * @fn     check_shape
+ * @brief  Check what the driver dereferences: the function pointers and the button count.
+ *
+ * @param  p_button_api  Configuration to check.
+ * @return SUCCESS or FAIL.
+ */
+
+static init_status_t check_shape(const button_api_t * p_button_api)
+{
+    init_status_t ret = FAIL;
+    if ((NULL != p_button_api)
+        && (p_button_api->size_of_buttons > 0)
+        && (p_button_api->size_of_buttons <= BUTTON_MAX)
+        && (NULL != p_button_api->fp_tick_elapsed)
+        && (NULL != p_button_api->fp_read_button)
+        && (NULL != p_button_api->fp_get_current_tick)
+        && (NULL != p_button_api->fp_event_callback))
+    {
+        ret = SUCCESS;
+    }
+    return ret;
+}
+
+/**
+ * @fn     check_api
+ * @brief  Validate everything in a configuration that does not depend on pin numbers.
+ *
+ * Requires every function pointer, 1..BUTTON_MAX buttons with a known interrupt mode,
+ * a non-zero tick rate, debounce times shorter than the long press time and
+ * fitting 32-bit ticks, and hold thresholds that increase strictly, fit too and
+ * are longer than the button's press debounce.
+ *
+ * @param  p_button_api  Configuration to check.
+ * @return SUCCESS or FAIL.
+ */
+
+static init_status_t check_api(const button_api_t * p_button_api)
+{
+    init_status_t ret = FAIL;
+    uint8_t i = 0;
+    if ((SUCCESS == check_shape(p_button_api))
+        && (p_button_api->tick_count_in_1us > 0)
+        && (p_button_api->debounce_us < p_button_api->long_press_us))
+    {
+        ret = SUCCESS;
+        for (i=0; i<p_button_api->size_of_buttons; i++)
+        {
+            const uint32_t * p_hold = p_button_api->button_pins[i].hold_us;
+            uint8_t level = 0;
+            if ((p_button_api->button_pins[i].interrupt_mode > BUTTON_INTERRUPT_MODE_BOTH_EDGES)
+                || (p_button_api->button_pins[i].press_debounce_us >= p_button_api->long_press_us)
+                || (p_button_api->button_pins[i].release_debounce_us >= p_button_api->long_press_us)
+                || (p_button_api->button_pins[i].press_debounce_us > (UINT32_MAX / p_button_api->tick_count_in_1us))
+                || (p_button_api->button_pins[i].release_debounce_us > (UINT32_MAX / p_button_api->tick_count_in_1us)))
+            {
+                ret = FAIL;
+            }
+            for (level=0; (level<BUTTON_HOLD_LEVELS) && (0 != p_hold[level]); level++)
+            {
+                if ((p_hold[level] > (UINT32_MAX / p_button_api->tick_count_in_1us))
+                    || (p_hold[level] <= p_button_api->button_pins[i].press_debounce_us)
+                    || ((level > 0) && (p_hold[level] <= p_hold[level - 1])))
+                {
+                    ret = FAIL;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * @fn     check_pins
+ * @brief  Build the pin lookup table and reject interrupt pins used twice.
+ *
+ * Only interrupt-driven buttons are looked up by pin (in button_isr()), so only
+ * they enter the table and only they must have distinct pins. Polled buttons
+ * may share a pin, e.g. several logical buttons decoded from one input.
+ *
+ * @param  p_button_api  Configuration to check.
+ * @param  p_slot        Pin lookup table to fill, all zero on entry.
+ * @return SUCCESS or FAIL.
+ */
+
+static init_status_t check_pins(const button_api_t * p_button_api, uint8_t * p_slot)
+{
+    init_status_t ret = SUCCESS;
+    uint8_t i = 0;
+    uint8_t j = 0;
+    for (i=0; (i<p_button_api->size_of_buttons) && (SUCCESS == ret); i++)
+    {
+        uint8_t pin = p_button_api->button_pins[i].pin;
+        if (BUTTON_INTERRUPT_MODE_NONE == p_button_api->button_pins[i].interrupt_mode)
+        {
+            continue;
+        }
+        if (pin < BUTTON_PIN_LUT_SIZE)
+        {
+            if (0 == p_slot[pin])
+            {
+                p_slot[pin] = (uint8_t)(i + 1);
+            }
+            else
+            {
+                ret = FAIL;
+            }
+        }
+        else
+        {
+            for (j=0; j<i; j++)
+            {
+                if ((p_button_api->button_pins[j].pin == pin)
+                    && (BUTTON_INTERRUPT_MODE_NONE != p_button_api->button_pins[j].interrupt_mode))
+                {
+                    ret = FAIL;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * @fn     derive
+ * @brief  Compute every value the scan path derives from the configuration.
+ *
+ * @param  p_button_api  Validated configuration.
+ * @param  p_derived     Receives the derived values.
+ * @return SUCCESS, or FAIL if a value does not fit 32-bit ticks or a pin is reused.
+ */
+
+static init_status_t derive(const button_api_t * p_button_api, button_derived_t * p_derived)
+{
+    uint32_t t = p_button_api->tick_count_in_1us;
+    init_status_t ret = FAIL;
+    uint8_t i = 0;
+    uint8_t level = 0;
+    memset(p_derived, 0, sizeof(*p_derived));
+    p_derived->stamp = BUTTON_DERIVED_STAMP;
+    if ((SUCCESS == us_to_tick(p_button_api->debounce_us, t, &p_derived->debounce_tick))
+        && (SUCCESS == us_to_tick(p_button_api->long_press_us, t, &p_derived->long_press_tick))
+        && (SUCCESS == us_to_tick(BUTTON_MULTI_PRESS_US, t, &p_derived->multi_press_tick))
+        && (SUCCESS == us_to_tick(p_button_api->time_jump_us, t, &p_derived->time_jump_tick))
+        && (SUCCESS == check_pins(p_button_api, p_derived->pin_slot)))
+    {
+        ret = SUCCESS;
+        for (i=0; i<p_button_api->size_of_buttons; i++)
+        {
+            if ((SUCCESS != us_to_tick(p_button_api->button_pins[i].press_debounce_us, t, &p_derived->press_debounce_tick[i]))
+                || (SUCCESS != us_to_tick(p_button_api->button_pins[i].release_debounce_us, t, &p_derived->release_debounce_tick[i])))
+            {
+                ret = FAIL;
+            }
+            for (level=0; level<BUTTON_HOLD_LEVELS; level++)
+            {
+                if (SUCCESS != us_to_tick(p_button_api->button_pins[i].hold_us[level], t, &p_derived->hold_tick[i][level]))
+                {
+                    ret = FAIL;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+#if (BUTTON_VERIFY_PRECOMPUTED > 0)
+/**
+ * @fn     same_derived
+ * @brief  Compare two sets of derived values field by field (padding ignored).
+ */
+
+static uint8_t same_derived(const button_derived_t * p_a, const button_derived_t * p_b)
+{
+    return (p_a->stamp == p_b->stamp)
+           && (p_a->debounce_tick == p_b->debounce_tick)
+           && (p_a->long_press_tick == p_b->long_press_tick)
+           && (p_a->multi_press_tick == p_b->multi_press_tick)
+           && (p_a->time_jump_tick == p_b->time_jump_tick)
+           && (0 == memcmp(p_a->hold_tick, p_b->hold_tick, sizeof(p_a->hold_tick)))
+           && (0 == memcmp(p_a->press_debounce_tick, p_b->press_debounce_tick, sizeof(p_a->press_debounce_tick)))
+           && (0 == memcmp(p_a->release_debounce_tick, p_b->release_debounce_tick, sizeof(p_a->release_debounce_tick)))
+           && (0 == memcmp(p_a->pin_slot, p_b->pin_slot, sizeof(p_a->pin_slot)));
+}
+#endif
+
+#if (BUTTON_CROSS_CORE > 0)
+/**
+ * @fn     edge_discard
+ * @brief  Empty every edge queue and clear its drop count (scan side).
+ *
+ * The ISR may still be pushing while the driver is re-initialized, so head is
+ * never written here: the scan side skips what is queued by moving its own tail
+ * up to head, with the same acquire/release pairing as edge_drain().
+ */
+
+static void edge_discard(void)
+{
+    uint8_t i = 0;
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        button_edge_queue_t * p_queue = &p_inst->edge_queue[i];
+        __atomic_store_n(&p_queue->tail, __atomic_load_n(&p_queue->head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        __atomic_store_n(&p_queue->dropped, 0, __ATOMIC_RELAXED);
+    }
+}
+#endif
+
+/**
+ * @fn     reset_state
+ * @brief  Clear all runtime state so every initialization starts from the same point.
+ */
+
+static void reset_state(void)
+{
+    memset(p_inst->pressed_tick, 0, sizeof(p_inst->pressed_tick));
+    memset(p_inst->record_last_tick, 0, sizeof(p_inst->record_last_tick));
+    memset(p_inst->press_count, 0, sizeof(p_inst->press_count));
+    memset(p_inst->prev_sample_tick, 0, sizeof(p_inst->prev_sample_tick));
+    memset(p_inst->prev_pressed, 0, sizeof(p_inst->prev_pressed));
+    memset(p_inst->pending_info, 0, sizeof(p_inst->pending_info));
+    memset(p_inst->event_info, 0, sizeof(p_inst->event_info));
+    p_inst->last_scan_tick = 0;
+    p_inst->pressed_mask = 0;
+    p_inst->modifiers_latched = 0;
+    memset(p_inst->press_modifiers, 0, sizeof(p_inst->press_modifiers));
+    memset(p_inst->hold_level, 0, sizeof(p_inst->hold_level));
+#if (BUTTON_CROSS_CORE > 0)
+    edge_discard();
+#endif
+    button_reset_cycle_stats();
+}
+
+/**
+ * @fn     button_select_instance
+ * @brief  Choose the driver instance the API functions work on.
+ *
+ * Switching is a pointer store; nothing is copied. With BUTTON_INSTANCE_TLS the
+ * choice applies to the calling thread only.
+ *
+ * @param  p_instance  Zeroed or previously initialized instance; NULL selects the
+ *                     built-in instance.
+ */
+
+void button_select_instance(button_instance_t * p_instance)
+{
+    p_inst = (NULL != p_instance) ? p_instance : &default_instance;
+}
+
 /**
  * @fn     button_initialize
  * @brief  Initialize the button driver with the provided API configuration.
  *
- * Validates that the API pointer is non-NULL, that at least one button is configured,
- * and that required function pointers for retrieving the current tick and handling
- * events are set. On success, stores the API pointer internally and marks the driver
- * as initialized.
+ * Fully validates the configuration (see check_api/check_pins) and, in the same
+ * pass, precomputes every value the scan path derives from it: thresholds in
+ * ticks and the pin lookup table used by the ISR. The work is bounded by
+ * BUTTON_MAX and BUTTON_PIN_LUT_SIZE, so it takes the same time on every boot,
+ * and the first scan runs exactly like every later one. Runtime state is cleared.
  *
  * @param  p_button_api  Pointer to a fully populated button_api_t structure.
  * @return SUCCESS (0) if initialization succeeds; FAIL (-1) otherwise.
  */
 int button_initialize(button_api_t * p_button_api)
 {
-    button_init_status = FAIL;
+    READY_SET(0);
 
-    if ((NULL != p_button_api) 
-        && (p_button_api->size_of_buttons > 0)
-        && (NULL != p_button_api->fp_get_current_tick)
-        && (NULL != p_button_api->fp_event_callback))
+    if ((SUCCESS == check_api(p_button_api))
+        && (SUCCESS == derive(p_button_api, &p_inst->derived)))
+    {
+        reset_state();
+        p_inst->p_derived = &p_inst->derived;
+        p_inst->p_api = p_button_api;
+        READY_SET(1);
+    }
+    return p_inst->ready ? SUCCESS : FAIL;
+}
+
+/**
+ * @fn     button_initialize_precomputed
+ * @brief  Initialize the driver with derived values computed at build time.
+ *
+ * p_precomputed is normally a const object built with BUTTON_DERIVED_INITIALIZER()
+ * (or emitted by tools/button_codegen.py) and stays in flash, where the scan and
+ * ISR paths read it. The table is trusted: initialization only checks the
+ * pointers and button count the driver dereferences and the table's stamp, so it
+ * takes constant time whatever the configuration. The generator has already
+ * validated what it emitted.
+ *
+ * With BUTTON_VERIFY_PRECOMPUTED the configuration is fully validated as by
+ * button_initialize(), and the table is recomputed once into the instance's own
+ * storage and compared with it field by field, so a table that does not match
+ * p_button_api is rejected. Enable it in debug builds and host checks.
+ *
+ * @param  p_button_api   Pointer to a fully populated button_api_t structure.
+ * @param  p_precomputed  Derived values matching p_button_api; must outlive the driver.
+ * @return SUCCESS (0) if initialization succeeds; FAIL (-1) otherwise.
+ */
+int button_initialize_precomputed(button_api_t * p_button_api, const button_derived_t * p_precomputed)
+{
+    READY_SET(0);
+
+#if (BUTTON_VERIFY_PRECOMPUTED > 0)
+    if ((NULL != p_precomputed)
+        && (SUCCESS == check_api(p_button_api))
+        && (SUCCESS == derive(p_button_api, &p_inst->derived))
+        && (same_derived(&p_inst->derived, p_precomputed)))
+#else
+    if ((NULL != p_precomputed)
+        && (BUTTON_DERIVED_STAMP == p_precomputed->stamp)
+        && (SUCCESS == check_shape(p_button_api)))
+#endif
+    {
+        reset_state();
+        p_inst->p_derived = p_precomputed;
+        p_inst->p_api = p_button_api;
+        READY_SET(1);
+    }
+    return p_inst->ready ? SUCCESS : FAIL;
+}
+
+/**
+ * @fn     record_edge
+ * @brief  Apply an interrupt edge of a button to its press/release ticks.
+ *
+ * Runs in button_isr(), or with BUTTON_CROSS_CORE in button_process() for the
+ * edges the ISR queued, so pressed_tick is written by one core only.
+ *
+ * @param  inx   Index of the button in the configuration array.
+ * @param  mode  Interrupt mode of the button.
+ * @param  tick  Tick of the edge (from stamp_now, never 0).
+ */
+
+static void record_edge(uint8_t inx, button_interrupt_mode_t mode, uint32_t tick)
+{
+    switch (mode)
+    {
+        case BUTTON_INTERRUPT_MODE_RISING_EDGE:
+            if (0 == p_inst->pressed_tick[inx].last)
+            {
+                p_inst->pressed_tick[inx].last = tick;
+                BUTTON_TRACE_EDGE(inx, BUTTON_TRACE_EDGE_RELEASE, p_inst->pressed_tick[inx].last);
+            }
+            break;
+        case BUTTON_INTERRUPT_MODE_FALLING_EDGE:
+            if (0 == p_inst->pressed_tick[inx].first)
+            {
+                p_inst->pressed_tick[inx].first = tick;
+                BUTTON_TRACE_EDGE(inx, BUTTON_TRACE_EDGE_PRESS, p_inst->pressed_tick[inx].first);
+            }
+            break;
+        case BUTTON_INTERRUPT_MODE_BOTH_EDGES:
+            if (0 == p_inst->pressed_tick[inx].first)
+            {
+                p_inst->pressed_tick[inx].first = tick;
+                BUTTON_TRACE_EDGE(inx, BUTTON_TRACE_EDGE_PRESS, p_inst->pressed_tick[inx].first);
+            }
+            else
+            {
+                p_inst->pressed_tick[inx].last = tick;
+                BUTTON_TRACE_EDGE(inx, BUTTON_TRACE_EDGE_RELEASE, p_inst->pressed_tick[inx].last);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+#if (BUTTON_CROSS_CORE > 0)
+/**
+ * @fn     edge_push
+ * @brief  Queue an edge for button_process() (ISR side of the edge queue).
+ *
+ * The slot is written before head is published with a release store, so the
+ * scan core sees the tick once it sees the new head. The acquire load of tail
+ * keeps the slot from being reused before the scan core has read it.
+ *
+ * @param  inx   Index of the button in the configuration array.
+ * @param  tick  Tick of the edge.
+ */
+
+static void edge_push(uint8_t inx, uint32_t tick)
+{
+    button_edge_queue_t * p_queue = &p_inst->edge_queue[inx];
+    uint32_t head = __atomic_load_n(&p_queue->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&p_queue->tail, __ATOMIC_ACQUIRE);
+    if ((head - tail) < BUTTON_CROSS_CORE_QUEUE)
     {
-        p_api = p_button_api;
-        button_init_status = SUCCESS;
+        p_queue->tick[head & (BUTTON_CROSS_CORE_QUEUE - 1)] = tick;
+        __atomic_store_n(&p_queue->head, head + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_fetch_add(&p_queue->dropped, 1, __ATOMIC_RELAXED);
     }
-    return button_init_status;
 }
 
+/**
+ * @fn     edge_drain
+ * @brief  Apply every queued edge of a button (scan side of the edge queue).
+ *
+ * @param  inx  Index of the button in the configuration array.
+ */
+
+static void edge_drain(uint8_t inx)
+{
+    button_edge_queue_t * p_queue = &p_inst->edge_queue[inx];
+    uint32_t tail = __atomic_load_n(&p_queue->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&p_queue->head, __ATOMIC_ACQUIRE);
+    while (tail != head)
+    {
+        record_edge(inx, p_inst->p_api->button_pins[inx].interrupt_mode, p_queue->tick[tail & (BUTTON_CROSS_CORE_QUEUE - 1)]);
+        tail++;
+    }
+    __atomic_store_n(&p_queue->tail, tail, __ATOMIC_RELEASE);
+}
+#endif
+
 /**
  * @fn     button_isr
  * @brief  Handle a GPIO interrupt event for a configured button.
@@ -196,7 +916,8 @@ int button_initialize(button_api_t * p_button_api)
  * This function should be registered as the ISR callback for button GPIO lines.
  * When a button interrupt occurs (rising edge, falling edge, or both), it locates
  * the corresponding button index and records the first and last press timestamps
- * based on the configured interrupt mode.
+ * based on the configured interrupt mode. With BUTTON_CROSS_CORE the timestamp is
+ * only queued, and button_process() records it at its next scan.
  *
  * @param  p_pin  Pointer to the pin_config_t structure describing the triggered pin
  *                and its interrupt mode.
@@ -204,42 +925,216 @@ int button_initialize(button_api_t * p_button_api)
 
 void button_isr(pin_config_t * p_pin)
 {
-    if ((NULL != p_pin) && (p_pin->interrupt_mode > BUTTON_INTERRUPT_MODE_NONE) && (SUCCESS == button_init_status))
+    if ((NULL != p_pin) && (p_pin->interrupt_mode > BUTTON_INTERRUPT_MODE_NONE) && (READY_GET()))
     {
         int8_t inx = find_pin_id(p_pin->pin);
+        BUTTON_TRACE_ISR_ENTRY(p_pin->pin, p_pin->interrupt_mode);
         if (-1 != inx)
         {
-            switch (p_pin->interrupt_mode)
-            {
-                case BUTTON_INTERRUPT_MODE_RISING_EDGE:
-                    if (0 == pressed_tick[inx].last)
-                    {
-                        pressed_tick[inx].last = p_api->fp_get_current_tick();
-                    }
-                    break;
-                case BUTTON_INTERRUPT_MODE_FALLING_EDGE:
-                    if (0 == pressed_tick[inx].first)
-                    {
-                        pressed_tick[inx].first = p_api->fp_get_current_tick();
-                    }
-                    break;
-                case BUTTON_INTERRUPT_MODE_BOTH_EDGES:
-                    if (0 == pressed_tick[inx].first)
-                    {
-                        pressed_tick[inx].first = p_api->fp_get_current_tick();
-                    }
-                    else
-                    {
-                        pressed_tick[inx].last = p_api->fp_get_current_tick();
-                    }   
-                    break;
-                default:
-                    break;
-            }
+#if (BUTTON_CROSS_CORE > 0)
+            edge_push((uint8_t)inx, stamp_now());
+#else
+            record_edge((uint8_t)inx, p_pin->interrupt_mode, stamp_now());
+#endif
         }
     }
 }
 
+/**
+ * @fn     button_notify_time_jump
+ * @brief  Inform the driver that the tick source jumped or was paused.
+ *
+ * Call this after light/deep sleep or after the tick source was stopped, with the
+ * number of ticks that passed without the driver being able to observe them. All
+ * pending press, release and multi-click timestamps are moved forward by delta_tick
+ * so debounce, long-press and multi-click windows continue from where they were
+ * instead of expiring at once. button_process() calls this itself when
+ * time_jump_us is non-zero and two consecutive scans are further apart than it.
+ * With BUTTON_CROSS_CORE, call it on the core that runs button_process(); edges
+ * still queued by the ISR are applied first.
+ *
+ * @param  delta_tick  Length of the discontinuity in ticks.
+ */
+
+void button_notify_time_jump(uint32_t delta_tick)
+{
+    if ((p_inst->ready) && (0 != delta_tick))
+    {
+        uint32_t now = p_inst->p_api->fp_get_current_tick();
+        uint8_t i = 0;
+        for (i=0; i<p_inst->p_api->size_of_buttons; i++)
+        {
+#if (BUTTON_CROSS_CORE > 0)
+            edge_drain(i);
+#endif
+            p_inst->pressed_tick[i].first = rebase_tick(p_inst->pressed_tick[i].first, now, delta_tick);
+            p_inst->pressed_tick[i].last  = rebase_tick(p_inst->pressed_tick[i].last, now, delta_tick);
+            p_inst->record_last_tick[i]   = rebase_tick(p_inst->record_last_tick[i], now, delta_tick);
+            p_inst->prev_sample_tick[i]   = rebase_tick(p_inst->prev_sample_tick[i], now, delta_tick);
+        }
+        p_inst->last_scan_tick = rebase_tick(p_inst->last_scan_tick, now, delta_tick);
+    }
+}
+
+/**
+ * @fn     button_get_event_info
+ * @brief  Report the edges of the press behind the most recent event of a button.
+ *
+ * Intended to be called from fp_event_callback. For polled buttons with
+ * poll_interpolation enabled, the uncertainties give the +/- error of the
+ * interpolated press and release ticks; otherwise they are 0.
+ *
+ * @param  button_id  Button whose last event is queried.
+ * @param  p_info     Receives the press/release ticks and their uncertainties.
+ * @return SUCCESS (0) on success; FAIL (-1) for an invalid button or NULL p_info.
+ */
+
+int button_get_event_info(button_enum button_id, button_event_info_t * p_info)
+{
+    init_status_t ret = FAIL;
+    if ((p_inst->ready) && (NULL != p_info) && (button_id < p_inst->p_api->size_of_buttons))
+    {
+        *p_info = p_inst->event_info[button_id];
+        ret = SUCCESS;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_inject_event
+ * @brief  Deliver an externally classified event through this driver instance.
+ *
+ * Used by receivers of remote button panels (see button_link.h) to feed events
+ * decoded from a link into the local application exactly as if they had been
+ * detected locally.
+ *
+ * @param  type       Event type.
+ * @param  button_id  Local button the event is reported for.
+ * @return SUCCESS (0) if the event was delivered; FAIL (-1) otherwise.
+ */
+
+int button_inject_event(button_pressed_types_t type, button_enum button_id)
+{
+    init_status_t ret = FAIL;
+    if ((p_inst->ready) && (button_id < p_inst->p_api->size_of_buttons))
+    {
+        emit_event(type, (uint8_t)button_id);
+        ret = SUCCESS;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_get_pressed_mask
+ * @brief  Report which buttons were held at the last scan.
+ *
+ * Bit n is set when button n read as pressed during the last `button_process()`.
+ * Used to detect held modifier buttons (see button_keymap.h).
+ *
+ * @return Bit mask of held buttons.
+ */
+
+uint32_t button_get_pressed_mask(void)
+{
+    return p_inst->pressed_mask;
+}
+
+/**
+ * @fn     button_get_press_modifiers
+ * @brief  Report which other buttons were held when a button's gesture began.
+ *
+ * Valid from the first scan of a gesture until its last event has been
+ * delivered, so it is the one to read from fp_event_callback. Outside a gesture
+ * (e.g. for an event passed to button_inject_event()) the other buttons held at
+ * the last scan are returned.
+ *
+ * @param  button_id  Button the event belongs to.
+ * @return Bit mask of the other buttons held, 0 for an invalid button.
+ */
+
+uint32_t button_get_press_modifiers(button_enum button_id)
+{
+    uint32_t mask = 0;
+    if (button_id < BUTTON_MAX)
+    {
+        mask = (0 != (p_inst->modifiers_latched & (1UL << button_id))) ? p_inst->press_modifiers[button_id]
+                                                                        : (p_inst->pressed_mask & ~(1UL << button_id));
+    }
+    return mask;
+}
+
+/**
+ * @fn     button_get_edge_drops
+ * @brief  Report how many edges of a button were dropped on a full edge queue.
+ *
+ * Requires BUTTON_CROSS_CORE. The count is kept by the ISR and read atomically,
+ * so it can be polled from any core; it restarts at every initialization. A
+ * non-zero count means BUTTON_CROSS_CORE_QUEUE is too small for the scan period.
+ *
+ * @param  button_id  Button to query.
+ * @param  p_dropped  Receives the number of dropped edges.
+ * @return 0 on success; -1 for an invalid button, NULL p_dropped, or
+ *         BUTTON_CROSS_CORE disabled.
+ */
+
+int button_get_edge_drops(button_enum button_id, uint32_t * p_dropped)
+{
+    int ret = -1;
+#if (BUTTON_CROSS_CORE > 0)
+    if ((NULL != p_dropped) && (p_inst->ready) && (button_id < p_inst->p_api->size_of_buttons))
+    {
+        *p_dropped = __atomic_load_n(&p_inst->edge_queue[button_id].dropped, __ATOMIC_RELAXED);
+        ret = 0;
+    }
+#else
+    (void)button_id;
+    (void)p_dropped;
+#endif
+    return ret;
+}
+
+/**
+ * @fn     button_get_cycle_stats
+ * @brief  Copy the per-stage cycle statistics collected by `button_process()`.
+ *
+ * Requires BUTTON_CYCLE_STATS and a configured fp_cycle_counter. For every button,
+ * READ covers fp_read_button, DEBOUNCE the edge bookkeeping, CLASSIFY the press
+ * decision without event delivery and DISPATCH event delivery including
+ * fp_event_callback; scan covers one whole `button_process()` call. The cost of
+ * reading the counter itself is included, so calibrate against an empty read pair.
+ *
+ * @param  p_stats  Receives the statistics.
+ * @return 0 on success; -1 if p_stats is NULL or BUTTON_CYCLE_STATS is disabled.
+ */
+
+int button_get_cycle_stats(button_cycle_stats_t * p_stats)
+{
+    int ret = -1;
+#if (BUTTON_CYCLE_STATS > 0)
+    if (NULL != p_stats)
+    {
+        *p_stats = p_inst->cycle_stats;
+        ret = 0;
+    }
+#else
+    (void)p_stats;
+#endif
+    return ret;
+}
+
+/**
+ * @fn     button_reset_cycle_stats
+ * @brief  Clear the cycle statistics, e.g. between benchmark phases.
+ */
+
+void button_reset_cycle_stats(void)
+{
+#if (BUTTON_CYCLE_STATS > 0)
+    memset(&p_inst->cycle_stats, 0, sizeof(p_inst->cycle_stats));
+    p_inst->dispatch_cycles = 0;
+#endif
+}
+
 /**
  * @fn     button_process
  * @brief  Poll and process button states, handling both interrupt-less and hybrid modes.
@@ -252,51 +1147,129 @@ void button_isr(pin_config_t * p_pin)
  *   - FALLING_EDGE: records the release timestamp after a prior press timestamp exists.
  *   - BOTH_EDGES:   managed elsewhere (interrupt-driven), so skipped here.
  *   - NONE (polling): records press and release timestamps purely by level changes.
+ *     With poll_interpolation set, each edge is placed at the midpoint between the
+ *     sample that saw it and the previous one, and half that gap is kept as the
+ *     edge uncertainty reported by `button_get_event_info()`.
  *
  * After timestamp updates, it calls `desicion_by_pressed_count()` to handle debounce,
- * single/double-press detection, and to fire the appropriate event callbacks.
+ * single/double-press detection, and to fire the appropriate event callbacks, then
+ * `check_hold_levels()` to report held buttons passing their hold thresholds.
+ *
+ * If time_jump_us is non-zero, a gap between two scans longer than time_jump_us is
+ * treated as a time discontinuity and handed to `button_notify_time_jump()` before
+ * any button is evaluated.
  *
  * @note   Ensure `button_initialize()` has succeeded before calling this.
  */
 void button_process()
 {
-    if (SUCCESS == button_init_status)
+    if (p_inst->ready)
     {
         uint8_t i = 0;
-        for (i=0; i<p_api->size_of_buttons; i++)
+        uint32_t now = 0;
+#if (BUTTON_CYCLE_STATS > 0)
+        uint32_t scan_mark = 0;
+        uint32_t stage_mark = 0;
+#endif
+        CYCLE_START(scan_mark);
+        now = p_inst->p_api->fp_get_current_tick();
+        if ((0 != p_inst->p_derived->time_jump_tick) && (0 != p_inst->last_scan_tick))
         {
-            uint8_t pressed = p_api->active_high ? (1 == p_api->fp_read_button(&p_api->button_pins[i])) : (0 == p_api->fp_read_button(&p_api->button_pins[i]));
-            switch (p_api->button_pins[i].interrupt_mode)
+            uint32_t gap = p_inst->p_api->fp_tick_elapsed(p_inst->last_scan_tick, now);
+            if (gap > p_inst->p_derived->time_jump_tick)
+            {
+                button_notify_time_jump(gap);
+            }
+        }
+        p_inst->last_scan_tick = to_stamp(now);
+#if (BUTTON_HISTORY_SIZE > 0)
+        if (&default_instance == p_inst)
+        {
+            button_history_advance(now);
+        }
+#endif
+#if (BUTTON_LOG_SIZE > 0)
+        if (&default_instance == p_inst)
+        {
+            button_log_advance(now);
+        }
+#endif
+        for (i=0; i<p_inst->p_api->size_of_buttons; i++)
+        {
+            uint8_t pressed = 0;
+            CYCLE_START(stage_mark);
+            pressed = p_inst->p_api->active_high ? (1 == p_inst->p_api->fp_read_button(&p_inst->p_api->button_pins[i])) : (0 == p_inst->p_api->fp_read_button(&p_inst->p_api->button_pins[i]));
+            p_inst->pressed_mask = pressed ? (p_inst->pressed_mask | (1UL << i)) : (p_inst->pressed_mask & ~(1UL << i));
+            CYCLE_LAP(stage_mark, &p_inst->cycle_stats.stage[i][BUTTON_STAGE_READ]);
+#if (BUTTON_CROSS_CORE > 0)
+            edge_drain(i);
+#endif
+            switch (p_inst->p_api->button_pins[i].interrupt_mode)
             {
                 case BUTTON_INTERRUPT_MODE_RISING_EDGE:
-                    if ((pressed) && (0 == pressed_tick[i].first))
+                    if ((pressed) && (0 == p_inst->pressed_tick[i].first))
                     {
-                        pressed_tick[i].first = p_api->fp_get_current_tick();
+                        p_inst->pressed_tick[i].first = stamp_now();
+                        BUTTON_TRACE_EDGE(i, BUTTON_TRACE_EDGE_PRESS, p_inst->pressed_tick[i].first);
                     }
                     break;
                 case BUTTON_INTERRUPT_MODE_FALLING_EDGE:
-                    if ((pressed) && (0 != pressed_tick[i].first))
+                    if ((pressed) && (0 != p_inst->pressed_tick[i].first))
                     {
-                        pressed_tick[i].last = p_api->fp_get_current_tick();
+                        p_inst->pressed_tick[i].last = stamp_now();
                     }
+                    else if ((!pressed) && (p_inst->prev_pressed[i]) && (0 != p_inst->pressed_tick[i].first))
+                    {
+                        BUTTON_TRACE_EDGE(i, BUTTON_TRACE_EDGE_RELEASE, p_inst->pressed_tick[i].last);
+                    }
+                    p_inst->prev_pressed[i] = pressed;
                     break;
                 case BUTTON_INTERRUPT_MODE_BOTH_EDGES:
                     break;
                 default: //no interrupt
-                if (pressed)
                 {
-                    if (0 == pressed_tick[i].first)
+                    uint32_t sample = stamp_now();
+                    if (pressed)
                     {
-                        pressed_tick[i].first = p_api->fp_get_current_tick();
+                        if (0 == p_inst->pressed_tick[i].first)
+                        {
+                            p_inst->pressed_tick[i].first = p_inst->p_api->poll_interpolation ?
+                                interpolate_edge(i, sample, &p_inst->pending_info[i].press_uncertainty_tick) : sample;
+                            BUTTON_TRACE_EDGE(i, BUTTON_TRACE_EDGE_PRESS, p_inst->pressed_tick[i].first);
+                        }
+                        else
+                        {
+                            p_inst->pressed_tick[i].last = sample;
+                        } 
                     }
-                    else
+                    else if ((p_inst->p_api->poll_interpolation) && (p_inst->prev_pressed[i]) && (0 != p_inst->pressed_tick[i].first))
                     {
-                        pressed_tick[i].last = p_api->fp_get_current_tick();
-                    } 
-                }
+                        p_inst->pressed_tick[i].last = interpolate_edge(i, sample, &p_inst->pending_info[i].release_uncertainty_tick);
+                    }
+                    if ((!pressed) && (p_inst->prev_pressed[i]) && (0 != p_inst->pressed_tick[i].first))
+                    {
+                        BUTTON_TRACE_EDGE(i, BUTTON_TRACE_EDGE_RELEASE, p_inst->pressed_tick[i].last);
+                    }
+                    p_inst->prev_sample_tick[i] = sample;
+                    p_inst->prev_pressed[i] = pressed;
                     break;
+                }
             }
+            latch_modifiers(i);
+            CYCLE_LAP(stage_mark, &p_inst->cycle_stats.stage[i][BUTTON_STAGE_DEBOUNCE]);
+#if (BUTTON_CYCLE_STATS > 0)
+            p_inst->dispatch_cycles = 0;
+#endif
             desicion_by_pressed_count(i);
+            check_hold_levels(i);
+            if ((0 == p_inst->pressed_tick[i].first) && (0 == p_inst->press_count[i]))
+            {
+                p_inst->modifiers_latched &= ~(1UL << i);
+            }
+#if (BUTTON_CYCLE_STATS > 0)
+            cycle_add(&p_inst->cycle_stats.stage[i][BUTTON_STAGE_CLASSIFY], cycle_lap(&stage_mark) - p_inst->dispatch_cycles);
+#endif
         }
+        CYCLE_LAP(scan_mark, &p_inst->cycle_stats.scan);
     }
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #ifndef BUTTON_H
 #define BUTTON_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef enum
 {
     BUTTON_1,
@@ -16,6 +20,11 @@ typedef enum
     BUTTON_NORMAL_PRESS,
     BUTTON_LONG_PRESS,
     BUTTON_DOUBLE_PRESS,
+    BUTTON_HOLD_LEVEL_1,
+    BUTTON_HOLD_LEVEL_2,
+    BUTTON_HOLD_LEVEL_3,
+    BUTTON_HOLD_LEVEL_4,
+    BUTTON_PRESS_TYPE_MAX,
 } button_pressed_types_t;
 
 typedef enum
@@ -26,30 +35,234 @@ typedef enum
     BUTTON_INTERRUPT_MODE_BOTH_EDGES,
 } button_interrupt_mode_t;
 
+#define BUTTON_HOLD_LEVELS      (4)
+
+/*
+ * hold_us lists up to BUTTON_HOLD_LEVELS hold thresholds of a button in strictly
+ * increasing order; 0 ends the list. While the button is held, BUTTON_HOLD_LEVEL_n
+ * is emitted when the hold passes hold_us[n - 1].
+ *
+ * press_debounce_us is the shortest press of a button that counts; shorter ones
+ * are dropped as glitches (0 = no minimum), so hold thresholds must be longer.
+ * release_debounce_us is how long the button must stay quiet after its last edge
+ * before the press is classified (0 = debounce_us of the API).
+ */
 typedef struct
 {
     uint8_t pin;
     button_interrupt_mode_t interrupt_mode;
     uint8_t * p_reg;
+    uint8_t hw_filtered;
+    uint32_t hold_us[BUTTON_HOLD_LEVELS];
+    uint32_t press_debounce_us;
+    uint32_t release_debounce_us;
 } pin_config_t;
 
+typedef struct
+{
+    uint32_t press_tick;
+    uint32_t release_tick;
+    uint32_t press_uncertainty_tick;
+    uint32_t release_uncertainty_tick;
+} button_event_info_t;
+
+#ifndef BUTTON_PIN_LUT_SIZE
+#define BUTTON_PIN_LUT_SIZE     (64)
+#endif
+
+#define BUTTON_MULTI_PRESS_US   (500000)
+
+#ifndef BUTTON_CYCLE_STATS
+#define BUTTON_CYCLE_STATS      (0)
+#endif
+
+#ifndef BUTTON_INSTANCE_TLS
+#define BUTTON_INSTANCE_TLS     (0)
+#endif
+
+#ifndef BUTTON_CROSS_CORE
+#define BUTTON_CROSS_CORE       (0)
+#endif
+
+#ifndef BUTTON_CROSS_CORE_QUEUE
+#define BUTTON_CROSS_CORE_QUEUE (8)
+#endif
+
+#ifndef BUTTON_CACHE_LINE
+#define BUTTON_CACHE_LINE       (64)
+#endif
+
+#ifndef BUTTON_VERIFY_PRECOMPUTED
+#define BUTTON_VERIFY_PRECOMPUTED   (0)
+#endif
+
+typedef enum
+{
+    BUTTON_STAGE_READ,
+    BUTTON_STAGE_DEBOUNCE,
+    BUTTON_STAGE_CLASSIFY,
+    BUTTON_STAGE_DISPATCH,
+    BUTTON_STAGE_MAX,
+} button_stage_t;
+
+/* Cycles spent in one stage; mean = total / count. */
+typedef struct
+{
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+} button_cycle_stat_t;
+
+typedef struct
+{
+    button_cycle_stat_t stage[BUTTON_MAX][BUTTON_STAGE_MAX];
+    button_cycle_stat_t scan;
+} button_cycle_stats_t;
+
+/*
+ * Values derived from button_api_t that the scan path needs. button_initialize()
+ * computes them once; BUTTON_DERIVED_INITIALIZER() lets them be computed by the
+ * compiler instead, for button_initialize_precomputed(). pin_slot[pin] holds the
+ * button index + 1 for interrupt-driven pins below BUTTON_PIN_LUT_SIZE, 0 for
+ * other pins. hold_tick[i] holds the hold thresholds of button i, 0 past the last;
+ * press_debounce_tick[i] and release_debounce_tick[i] its debounce overrides, 0
+ * where it has none.
+ *
+ * BUTTON_DERIVED_INITIALIZER() covers configurations without per-button
+ * thresholds. Otherwise write the initializer out, starting with
+ * BUTTON_DERIVED_FIELDS() and adding the per-button arrays with BUTTON_US_TO_TICK().
+ *
+ * stamp is set by BUTTON_DERIVED_FIELDS() to BUTTON_DERIVED_STAMP, which encodes
+ * the array sizes. It comes first so that a table built with other sizes than the
+ * driver is still recognised and rejected.
+ */
+typedef struct
+{
+    uint32_t stamp;
+    uint32_t debounce_tick;
+    uint32_t long_press_tick;
+    uint32_t multi_press_tick;
+    uint32_t time_jump_tick;
+    uint32_t hold_tick[BUTTON_MAX][BUTTON_HOLD_LEVELS];
+    uint32_t press_debounce_tick[BUTTON_MAX];
+    uint32_t release_debounce_tick[BUTTON_MAX];
+    uint8_t pin_slot[BUTTON_PIN_LUT_SIZE];
+} button_derived_t;
+
+#define BUTTON_US_TO_TICK(tick_count_in_1us, us)    ((uint32_t)((us) * (tick_count_in_1us)))
+
+#define BUTTON_DERIVED_STAMP    ((uint32_t)(0xB0000000UL | ((uint32_t)BUTTON_MAX << 20) \
+                                 | ((uint32_t)BUTTON_HOLD_LEVELS << 16) | (uint32_t)BUTTON_PIN_LUT_SIZE))
+
+#define BUTTON_DERIVED_FIELDS(tick_count_in_1us, debounce_us, long_press_us, time_jump_us) \
+        .stamp = BUTTON_DERIVED_STAMP, \
+        .debounce_tick = BUTTON_US_TO_TICK(tick_count_in_1us, debounce_us), \
+        .long_press_tick = BUTTON_US_TO_TICK(tick_count_in_1us, long_press_us), \
+        .multi_press_tick = BUTTON_US_TO_TICK(tick_count_in_1us, BUTTON_MULTI_PRESS_US), \
+        .time_jump_tick = BUTTON_US_TO_TICK(tick_count_in_1us, time_jump_us)
+
+#define BUTTON_DERIVED_INITIALIZER(tick_count_in_1us, debounce_us, long_press_us, time_jump_us, ...) \
+    { \
+        BUTTON_DERIVED_FIELDS(tick_count_in_1us, debounce_us, long_press_us, time_jump_us), \
+        .pin_slot = { __VA_ARGS__ }, \
+    }
+
 typedef struct
 {
     pin_config_t button_pins[BUTTON_MAX];
     uint8_t size_of_buttons;
     uint8_t active_high;
+    uint8_t poll_interpolation;
     uint32_t tick_count_in_1us;
     uint32_t debounce_us;
     uint32_t long_press_us;
+    uint32_t time_jump_us;
     uint32_t (* fp_tick_elapsed)(uint32_t start, uint32_t end);
     int32_t (* fp_read_button)(pin_config_t * p_pin);
     uint32_t (* fp_get_current_tick)(void);
     void (* fp_event_callback)(button_pressed_types_t type, button_enum button_id);
+    uint32_t (* fp_cycle_counter)(void);
 } button_api_t;
 
+typedef struct
+{
+    uint32_t first;
+    uint32_t last;
+} detection_pressed_tick_t;
+
+/*
+ * With BUTTON_CROSS_CORE, button_isr() only stamps an edge and queues it here;
+ * button_process() applies queued edges at its next scan, so pressed_tick has a
+ * single writer. Each queue is single-producer/single-consumer: the ISR side owns
+ * head, dropped and the slots, the scan side owns tail, and each index is
+ * published with a release store and read with an acquire load. The two sides
+ * sit on separate cache lines, so neither core's writes evict the other's.
+ * BUTTON_CROSS_CORE_QUEUE must be a power of two; edges arriving while a queue is
+ * full are dropped and counted (see button_get_edge_drops()).
+ */
+typedef struct
+{
+    uint32_t head;
+    uint32_t dropped;
+    uint32_t tick[BUTTON_CROSS_CORE_QUEUE];
+    uint32_t tail __attribute__((aligned(BUTTON_CACHE_LINE)));
+} __attribute__((aligned(BUTTON_CACHE_LINE))) button_edge_queue_t;
+
+/*
+ * Runtime state of one driver instance. Every API function works on the instance
+ * chosen with button_select_instance(), or on a built-in one if none was chosen,
+ * so an application with a single set of buttons never needs this type. More
+ * instances let one program run many button sets, e.g. a gateway serving many
+ * panels. Each one must start zeroed and is set up by button_initialize() while
+ * selected. With BUTTON_INSTANCE_TLS the selection is per thread, so worker
+ * threads can each drive their own instances. The ISR uses the selected instance
+ * too, so keep a single instance where button_isr() is in use. The event history
+ * and event log are process-wide and record the built-in instance only.
+ */
+typedef struct
+{
+    button_api_t * p_api;
+    const button_derived_t * p_derived;
+    button_derived_t derived;
+    uint8_t ready;
+    detection_pressed_tick_t pressed_tick[BUTTON_MAX];
+    uint32_t record_last_tick[BUTTON_MAX];
+    uint8_t press_count[BUTTON_MAX];
+    uint32_t last_scan_tick;
+    uint32_t pressed_mask;
+    uint32_t modifiers_latched;
+    uint32_t press_modifiers[BUTTON_MAX];
+    uint8_t hold_level[BUTTON_MAX];
+    uint32_t prev_sample_tick[BUTTON_MAX];
+    uint8_t prev_pressed[BUTTON_MAX];
+    button_event_info_t pending_info[BUTTON_MAX];
+    button_event_info_t event_info[BUTTON_MAX];
+#if (BUTTON_CYCLE_STATS > 0)
+    button_cycle_stats_t cycle_stats;
+    uint32_t dispatch_cycles;
+#endif
+#if (BUTTON_CROSS_CORE > 0)
+    button_edge_queue_t edge_queue[BUTTON_MAX];
+#endif
+} button_instance_t;
+
+extern void button_select_instance(button_instance_t * p_instance);
 extern int button_initialize(button_api_t * p_button_api);
+extern int button_initialize_precomputed(button_api_t * p_button_api, const button_derived_t * p_precomputed);
 extern void button_isr(pin_config_t * p_pin);
 extern void button_process();
+extern void button_notify_time_jump(uint32_t delta_tick);
+extern int button_get_event_info(button_enum button_id, button_event_info_t * p_info);
+extern int button_inject_event(button_pressed_types_t type, button_enum button_id);
+extern uint32_t button_get_pressed_mask(void);
+extern uint32_t button_get_press_modifiers(button_enum button_id);
+extern int button_get_edge_drops(button_enum button_id, uint32_t * p_dropped);
+extern int button_get_cycle_stats(button_cycle_stats_t * p_stats);
+extern void button_reset_cycle_stats(void);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif // BUTTON_H
\ No newline at end of file
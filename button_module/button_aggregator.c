@@ -0,0 +1,480 @@
+/**************************************************
+ * @file    button_aggregator.c                   *
+ * @brief   Multi-node event aggregation with     *
+ *          clock alignment                       *
+ *                                                *
+ * Description:                                   *
+ * Every remote node stamps its events with its   *
+ * own tick source, which has its own epoch and   *
+ * drifts. Each received frame pairs the node     *
+ * tick at flush with the local tick at arrival.  *
+ * Per node, the smallest (least delayed) offset  *
+ * seen in each epoch is kept; the centroid of    *
+ * the recent epoch minima gives the clock offset *
+ * and the slope from an older centroid the skew, *
+ * in integer arithmetic. Event ticks are         *
+ * mapped onto the local timebase and released in *
+ * time order after a configurable hold time, so  *
+ * streams from all nodes are merged.             *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "button_aggregator.h"
+
+/**
+ * @fn     unwrap_local
+ * @brief  Extend the 32-bit local tick to a monotonic 64-bit timeline.
+ *
+ * @param  p_agg       Aggregator state.
+ * @param  local_tick  Current local tick.
+ * @return Local time in ticks since the first observed local tick.
+ */
+
+static int64_t unwrap_local(button_aggregator_t * p_agg, uint32_t local_tick)
+{
+    if (p_agg->local_valid)
+    {
+        p_agg->local_time += (int32_t)(local_tick - p_agg->last_local_tick);
+    }
+    else
+    {
+        p_agg->local_time = local_tick;
+        p_agg->local_valid = 1;
+    }
+    p_agg->last_local_tick = local_tick;
+    return p_agg->local_time;
+}
+
+/**
+ * @fn     scale_q32
+ * @brief  Multiply a tick distance by a Q32 skew, rounding to the nearest tick.
+ *
+ * The distance is clamped to +/-2^31 ticks so the product fits 64 bits; events
+ * are always mapped close to the reference point, so the clamp never applies in
+ * practice.
+ *
+ * @param  skew   Q32 skew.
+ * @param  delta  Distance in node ticks.
+ * @return skew * delta in ticks.
+ */
+
+static int64_t scale_q32(int32_t skew, int64_t delta)
+{
+    int64_t product = 0;
+    delta = (delta > INT32_MAX) ? INT32_MAX : ((delta < -INT32_MAX) ? -INT32_MAX : delta);
+    product = (int64_t)skew * delta;
+    return (product >= 0) ? ((product + (1LL << 31)) >> 32) : -((-product + (1LL << 31)) >> 32);
+}
+
+/**
+ * @fn     predict
+ * @brief  Local-minus-node offset the current model gives at a node time.
+ */
+
+static int64_t predict(const button_aggregator_clock_t * p_clock, int64_t node_time)
+{
+    return p_clock->offset + scale_q32(p_clock->skew, node_time - p_clock->ref_x);
+}
+
+/**
+ * @fn     slope_q32
+ * @brief  Q32 slope of the offset between two points, clamped to +/-0.5.
+ *
+ * @param  p_from  Older point (node time, offset).
+ * @param  p_to    Newer point.
+ * @return Slope, or 0 if the points do not advance in node time.
+ */
+
+static int32_t slope_q32(const button_aggregator_epoch_t * p_from, const button_aggregator_epoch_t * p_to)
+{
+    int64_t dx = p_to->x - p_from->x;
+    int64_t dr = p_to->residual - p_from->residual;
+    int64_t slope = 0;
+    if (dx > 0)
+    {
+        dr = (dr > (1LL << 30)) ? (1LL << 30) : ((dr < -(1LL << 30)) ? -(1LL << 30) : dr);
+        slope = (dr * (1LL << 32)) / dx;
+        slope = (slope > INT32_MAX) ? INT32_MAX : ((slope < -INT32_MAX) ? -INT32_MAX : slope);
+    }
+    return (int32_t)slope;
+}
+
+/**
+ * @fn     centroid
+ * @brief  Mean node time and offset of a run of epoch minima.
+ *
+ * @param  p_clock  Clock state of one node.
+ * @param  newest   Ring index of the newest epoch in the run.
+ * @param  skip     Number of epochs before the run, counting back from newest.
+ * @param  count    Number of epochs in the run (at least 1).
+ * @param  p_out    Receives the mean point.
+ */
+
+static void centroid(const button_aggregator_clock_t * p_clock, uint8_t newest, uint8_t skip, uint8_t count,
+                     button_aggregator_epoch_t * p_out)
+{
+    int64_t sum_x = 0;
+    int64_t sum_r = 0;
+    uint8_t k = 0;
+    for (k=skip; k<skip+count; k++)
+    {
+        const button_aggregator_epoch_t * p_epoch = &p_clock->epoch[(newest + BUTTON_AGGREGATOR_EPOCHS - k) % BUTTON_AGGREGATOR_EPOCHS];
+        sum_x += p_epoch->x;
+        sum_r += p_epoch->residual;
+    }
+    p_out->x = sum_x / count;
+    p_out->residual = sum_r / count;
+}
+
+/**
+ * @fn     fit_clock
+ * @brief  Estimate offset and skew of a node from its epoch minima.
+ *
+ * The model is local = node + offset + skew * (node - ref_x), with (ref_x, offset)
+ * the centroid of the completed epoch minima in the ring, which averages out the
+ * latency noise of single minima. Only completed epochs take part once there are
+ * any, because the minimum of the epoch still being filled has seen too few
+ * frames to be trusted.
+ *
+ * The skew is the slope from an anchor, an older centroid kept for up to
+ * BUTTON_AGGREGATOR_SKEW_EPOCHS epochs, so its error shrinks with the baseline
+ * instead of staying at the noise of the ring's few epochs. Until an anchor is
+ * a full ring span old, the slope between the older and newer half of the ring
+ * is used. With a single usable epoch only the offset is known.
+ *
+ * @param  p_agg    Aggregator state.
+ * @param  p_clock  Clock state of one node.
+ */
+
+static void fit_clock(const button_aggregator_t * p_agg, button_aggregator_clock_t * p_clock)
+{
+    uint8_t used = (p_clock->epochs > 1) ? (uint8_t)(p_clock->epochs - 1) : 1;
+    uint8_t newest = (p_clock->epochs > 1) ? (uint8_t)((p_clock->head + BUTTON_AGGREGATOR_EPOCHS - 1) % BUTTON_AGGREGATOR_EPOCHS)
+                                           : p_clock->head;
+    button_aggregator_epoch_t now;
+    button_aggregator_epoch_t older;
+    button_aggregator_epoch_t newer;
+
+    centroid(p_clock, newest, 0, used, &now);
+    p_clock->ref_x = now.x;
+    p_clock->offset = now.residual;
+    p_clock->skew = 0;
+    if ((p_clock->anchors > 0)
+        && ((now.x - p_clock->anchor[0].x) >= (int64_t)BUTTON_AGGREGATOR_EPOCHS * p_agg->epoch_ticks))
+    {
+        p_clock->skew = slope_q32(&p_clock->anchor[0], &now);
+    }
+    else if (used >= 2)
+    {
+        centroid(p_clock, newest, 0, (uint8_t)(used / 2), &newer);
+        centroid(p_clock, newest, (uint8_t)(used / 2), (uint8_t)(used - used / 2), &older);
+        p_clock->skew = slope_q32(&older, &newer);
+    }
+}
+
+/**
+ * @fn     advance_anchors
+ * @brief  Keep the skew anchors between half and all of the maximum baseline old.
+ *
+ * Called when an epoch completes with a full ring. Two anchors take turns: the
+ * second is set halfway through the baseline and replaces the first when that
+ * one reaches BUTTON_AGGREGATOR_SKEW_EPOCHS, so the skew always rests on a long
+ * baseline yet follows slow drift (temperature) of the node's oscillator.
+ *
+ * @param  p_agg    Aggregator state.
+ * @param  p_clock  Clock state of one node.
+ */
+
+static void advance_anchors(const button_aggregator_t * p_agg, button_aggregator_clock_t * p_clock)
+{
+    int64_t baseline = (int64_t)BUTTON_AGGREGATOR_SKEW_EPOCHS * p_agg->epoch_ticks;
+    button_aggregator_epoch_t now;
+    now.x = p_clock->ref_x;
+    now.residual = p_clock->offset;
+    if (0 == p_clock->anchors)
+    {
+        p_clock->anchor[0] = now;
+        p_clock->anchors = 1;
+    }
+    else if ((1 == p_clock->anchors) && ((now.x - p_clock->anchor[0].x) >= baseline / 2))
+    {
+        p_clock->anchor[1] = now;
+        p_clock->anchors = 2;
+    }
+    else if ((2 == p_clock->anchors) && ((now.x - p_clock->anchor[0].x) >= baseline))
+    {
+        p_clock->anchor[0] = p_clock->anchor[1];
+        p_clock->anchor[1] = now;
+    }
+}
+
+/**
+ * @fn     node_restarted
+ * @brief  Tell whether a frame comes from a node that restarted since the last one.
+ *
+ * A restarted node begins its sequence at 0 again, and usually its tick source
+ * too. A frame is taken as a restart when its sequence number is 0 without
+ * following 255, or when its offset is more than one epoch away from what the
+ * clock model predicts (far beyond any link latency). Losing the frames just
+ * before a sequence wrap looks the same and costs only a re-learned clock.
+ *
+ * @param  p_agg       Aggregator state.
+ * @param  p_clock     Clock state of the sending node (valid).
+ * @param  seq         Sequence number of the frame.
+ * @param  node_tick   Node tick carried by the frame.
+ * @param  local_time  Unwrapped local time at arrival.
+ * @return 1 if the node restarted, 0 otherwise.
+ */
+
+static uint8_t node_restarted(const button_aggregator_t * p_agg, const button_aggregator_clock_t * p_clock,
+                              uint8_t seq, uint32_t node_tick, int64_t local_time)
+{
+    int64_t node_time = p_clock->node_time + (int32_t)(node_tick - p_clock->last_node_tick);
+    int64_t error = (local_time - node_time) - predict(p_clock, node_time);
+    return ((0 == seq) && (255 != p_clock->last_seq))
+           || (error > (int64_t)p_agg->epoch_ticks) || (error < -(int64_t)p_agg->epoch_ticks);
+}
+
+/**
+ * @fn     update_clock
+ * @brief  Add one (node tick, local arrival time) sample to a node's clock estimate.
+ *
+ * A node found to have restarted starts over with a fresh estimate; the restart
+ * is counted in node_restarts.
+ *
+ * @param  p_agg       Aggregator state.
+ * @param  p_clock     Clock state of the sending node.
+ * @param  seq         Sequence number of the frame.
+ * @param  node_tick   Node tick carried by the frame.
+ * @param  local_time  Unwrapped local time at arrival.
+ */
+
+static void update_clock(button_aggregator_t * p_agg, button_aggregator_clock_t * p_clock,
+                         uint8_t seq, uint32_t node_tick, int64_t local_time)
+{
+    int64_t residual = 0;
+    uint8_t completed = 0;
+    if ((p_clock->valid) && (node_restarted(p_agg, p_clock, seq, node_tick, local_time)))
+    {
+        p_agg->node_restarts++;
+        p_clock->valid = 0;
+    }
+    if (p_clock->valid)
+    {
+        p_clock->node_time += (int32_t)(node_tick - p_clock->last_node_tick);
+    }
+    else
+    {
+        memset(p_clock, 0, sizeof(*p_clock));
+        p_clock->node_time = node_tick;
+        p_clock->valid = 1;
+    }
+    p_clock->last_node_tick = node_tick;
+    p_clock->last_seq = seq;
+    residual = local_time - p_clock->node_time;
+
+    if ((0 == p_clock->epochs)
+        || ((p_clock->node_time / p_agg->epoch_ticks) != (p_clock->epoch[p_clock->head].x / p_agg->epoch_ticks)))
+    {
+        if (0 != p_clock->epochs)
+        {
+            p_clock->head = (uint8_t)((p_clock->head + 1) % BUTTON_AGGREGATOR_EPOCHS);
+            completed = 1;
+        }
+        if (p_clock->epochs < BUTTON_AGGREGATOR_EPOCHS)
+        {
+            p_clock->epochs++;
+        }
+        p_clock->epoch[p_clock->head].x = p_clock->node_time;
+        p_clock->epoch[p_clock->head].residual = residual;
+    }
+    else if (residual < p_clock->epoch[p_clock->head].residual)
+    {
+        p_clock->epoch[p_clock->head].x = p_clock->node_time;
+        p_clock->epoch[p_clock->head].residual = residual;
+    }
+    fit_clock(p_agg, p_clock);
+    if ((completed) && (BUTTON_AGGREGATOR_EPOCHS == p_clock->epochs))
+    {
+        advance_anchors(p_agg, p_clock);
+    }
+}
+
+/**
+ * @fn     release_head
+ * @brief  Deliver and remove the oldest queued event.
+ *
+ * @param  p_agg  Aggregator state.
+ */
+
+static void release_head(button_aggregator_t * p_agg)
+{
+    button_aggregator_event_t event = p_agg->queue[0].event;
+    p_agg->released_time = p_agg->queue[0].time;
+    p_agg->queued--;
+    memmove(&p_agg->queue[0], &p_agg->queue[1], p_agg->queued * sizeof(p_agg->queue[0]));
+    if (NULL != p_agg->fp_event_callback)
+    {
+        p_agg->fp_event_callback(&event);
+    }
+}
+
+/**
+ * @fn     enqueue
+ * @brief  Insert an aligned event into the time ordered release queue.
+ *
+ * Events older than the last released one cannot be merged in order any more;
+ * they are delivered immediately and counted in late_events. A full queue
+ * releases its oldest event early, counted in early_releases.
+ *
+ * @param  p_agg    Aggregator state.
+ * @param  time     Aligned event time on the unwrapped local timeline.
+ * @param  p_event  Event to insert.
+ */
+
+static void enqueue(button_aggregator_t * p_agg, int64_t time, const button_aggregator_event_t * p_event)
+{
+    uint16_t pos = 0;
+    if (time < p_agg->released_time)
+    {
+        p_agg->late_events++;
+        if (NULL != p_agg->fp_event_callback)
+        {
+            p_agg->fp_event_callback(p_event);
+        }
+        return;
+    }
+    if (BUTTON_AGGREGATOR_QUEUE == p_agg->queued)
+    {
+        p_agg->early_releases++;
+        release_head(p_agg);
+    }
+    pos = p_agg->queued;
+    while ((pos > 0) && (p_agg->queue[pos - 1].time > time))
+    {
+        p_agg->queue[pos] = p_agg->queue[pos - 1];
+        pos--;
+    }
+    p_agg->queue[pos].time = time;
+    p_agg->queue[pos].event = *p_event;
+    p_agg->queued++;
+}
+
+/**
+ * @fn     button_aggregator_init
+ * @brief  Prepare an aggregator.
+ *
+ * @param  p_agg              Aggregator state to initialize.
+ * @param  epoch_ticks        Node ticks per clock estimation epoch; one offset
+ *                            minimum is kept per epoch (e.g. 1 s worth of ticks).
+ * @param  hold_ticks         Local ticks an event is held back for reordering;
+ *                            should exceed the worst link and batching latency.
+ * @param  fp_event_callback  Receives the merged events in common time order.
+ */
+
+void button_aggregator_init(button_aggregator_t * p_agg, uint32_t epoch_ticks, uint32_t hold_ticks,
+                            void (* fp_event_callback)(const button_aggregator_event_t * p_event))
+{
+    if (NULL != p_agg)
+    {
+        memset(p_agg, 0, sizeof(*p_agg));
+        p_agg->epoch_ticks = (0 != epoch_ticks) ? epoch_ticks : 1;
+        p_agg->hold_ticks = hold_ticks;
+        p_agg->released_time = INT64_MIN;
+        p_agg->fp_event_callback = fp_event_callback;
+    }
+}
+
+/**
+ * @fn     button_aggregator_frame
+ * @brief  Account a received frame: update the node clock and queue its events.
+ *
+ * Call from the button_link frame callback with the local tick at which the frame
+ * was received. Frames from nodes with an id of BUTTON_AGGREGATOR_MAX_NODES or more
+ * are ignored.
+ *
+ * @param  p_agg       Aggregator state.
+ * @param  p_frame     Decoded frame.
+ * @param  local_tick  Local tick at reception.
+ */
+
+void button_aggregator_frame(button_aggregator_t * p_agg, const button_link_frame_t * p_frame, uint32_t local_tick)
+{
+    if ((NULL != p_agg) && (NULL != p_frame) && (p_frame->node_id < BUTTON_AGGREGATOR_MAX_NODES))
+    {
+        button_aggregator_clock_t * p_clock = &p_agg->clock[p_frame->node_id];
+        int64_t local_time = unwrap_local(p_agg, local_tick);
+        uint8_t i = 0;
+        update_clock(p_agg, p_clock, p_frame->seq, p_frame->base_tick, local_time);
+        for (i=0; i<p_frame->count; i++)
+        {
+            button_aggregator_event_t event;
+            int64_t node_time = p_clock->node_time - (int64_t)(uint32_t)(p_frame->base_tick - p_frame->events[i].tick);
+            int64_t time = node_time + predict(p_clock, node_time);
+            event.node_id = p_frame->node_id;
+            event.kind = p_frame->events[i].kind;
+            event.button = p_frame->events[i].button;
+            event.node_tick = p_frame->events[i].tick;
+            event.tick = (uint32_t)time;
+            enqueue(p_agg, time, &event);
+        }
+        button_aggregator_poll(p_agg, local_tick);
+    }
+}
+
+/**
+ * @fn     button_aggregator_poll
+ * @brief  Release every queued event older than the hold time.
+ *
+ * Call periodically so events are delivered even when no further frames arrive.
+ *
+ * @param  p_agg       Aggregator state.
+ * @param  local_tick  Current local tick.
+ */
+
+void button_aggregator_poll(button_aggregator_t * p_agg, uint32_t local_tick)
+{
+    if (NULL != p_agg)
+    {
+        int64_t now = unwrap_local(p_agg, local_tick);
+        while ((p_agg->queued > 0) && (p_agg->queue[0].time <= now - (int64_t)p_agg->hold_ticks))
+        {
+            release_head(p_agg);
+        }
+    }
+}
+
+/**
+ * @fn     button_aggregator_get_clock
+ * @brief  Report the current clock estimate of a node.
+ *
+ * @param  p_agg          Aggregator state.
+ * @param  node_id        Node to query.
+ * @param  p_offset_tick  Receives local - node tick at the node's latest frame
+ *                        (includes the minimum link latency). May be NULL.
+ * @param  p_skew_ppb     Receives how much faster the local clock runs, in parts
+ *                        per billion. May be NULL.
+ * @return 0 on success; -1 if the node is unknown.
+ */
+
+int button_aggregator_get_clock(const button_aggregator_t * p_agg, uint16_t node_id,
+                                int64_t * p_offset_tick, int32_t * p_skew_ppb)
+{
+    int ret = -1;
+    if ((NULL != p_agg) && (node_id < BUTTON_AGGREGATOR_MAX_NODES) && (p_agg->clock[node_id].valid))
+    {
+        const button_aggregator_clock_t * p_clock = &p_agg->clock[node_id];
+        if (NULL != p_offset_tick)
+        {
+            *p_offset_tick = predict(p_clock, p_clock->node_time);
+        }
+        if (NULL != p_skew_ppb)
+        {
+            *p_skew_ppb = (int32_t)(((int64_t)p_clock->skew * 1000000000LL) / (1LL << 32));
+        }
+        ret = 0;
+    }
+    return ret;
+}
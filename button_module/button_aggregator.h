@@ -0,0 +1,90 @@
+#ifndef BUTTON_AGGREGATOR_H
+#define BUTTON_AGGREGATOR_H
+
+#include <stdint.h>
+#include "button_link.h"
+
+#ifndef BUTTON_AGGREGATOR_MAX_NODES
+#define BUTTON_AGGREGATOR_MAX_NODES     (32)
+#endif
+
+#ifndef BUTTON_AGGREGATOR_EPOCHS
+#define BUTTON_AGGREGATOR_EPOCHS        (8)
+#endif
+
+#ifndef BUTTON_AGGREGATOR_QUEUE
+#define BUTTON_AGGREGATOR_QUEUE         (64)
+#endif
+
+#ifndef BUTTON_AGGREGATOR_SKEW_EPOCHS
+#define BUTTON_AGGREGATOR_SKEW_EPOCHS   (256)
+#endif
+
+/*
+ * All clock arithmetic is integer: times are 64-bit tick counts and the skew is
+ * a signed Q32 fraction (local rate / node rate - 1, scaled by 2^32), so the
+ * aggregator needs no floating point on targets without a double precision FPU.
+ */
+
+typedef struct
+{
+    uint16_t node_id;
+    uint8_t kind;
+    uint8_t button;
+    uint32_t node_tick;
+    uint32_t tick;
+} button_aggregator_event_t;
+
+typedef struct
+{
+    int64_t x;
+    int64_t residual;
+} button_aggregator_epoch_t;
+
+typedef struct
+{
+    uint8_t valid;
+    uint8_t epochs;
+    uint8_t head;
+    uint8_t anchors;
+    uint8_t last_seq;
+    uint32_t last_node_tick;
+    int64_t node_time;
+    int64_t ref_x;
+    int64_t offset;
+    int32_t skew;
+    button_aggregator_epoch_t anchor[2];
+    button_aggregator_epoch_t epoch[BUTTON_AGGREGATOR_EPOCHS];
+} button_aggregator_clock_t;
+
+typedef struct
+{
+    int64_t time;
+    button_aggregator_event_t event;
+} button_aggregator_slot_t;
+
+typedef struct
+{
+    uint32_t epoch_ticks;
+    uint32_t hold_ticks;
+    uint32_t last_local_tick;
+    int64_t local_time;
+    uint8_t local_valid;
+    uint16_t queued;
+    int64_t released_time;
+    uint32_t late_events;
+    uint32_t early_releases;
+    uint32_t node_restarts;
+    button_aggregator_clock_t clock[BUTTON_AGGREGATOR_MAX_NODES];
+    button_aggregator_slot_t queue[BUTTON_AGGREGATOR_QUEUE];
+    void (* fp_event_callback)(const button_aggregator_event_t * p_event);
+} button_aggregator_t;
+
+extern void button_aggregator_init(button_aggregator_t * p_agg, uint32_t epoch_ticks, uint32_t hold_ticks,
+                                   void (* fp_event_callback)(const button_aggregator_event_t * p_event));
+extern void button_aggregator_frame(button_aggregator_t * p_agg, const button_link_frame_t * p_frame, uint32_t local_tick);
+extern void button_aggregator_poll(button_aggregator_t * p_agg, uint32_t local_tick);
+extern int button_aggregator_get_clock(const button_aggregator_t * p_agg, uint16_t node_id,
+                                       int64_t * p_offset_tick, int32_t * p_skew_ppb);
+
+#endif // BUTTON_AGGREGATOR_H
@@ -0,0 +1,223 @@
+/**************************************************
+ * @file    button_co.hpp                         *
+ * @brief   C++20 coroutine interface for the     *
+ *          button driver                         *
+ *                                                *
+ * Description:                                   *
+ * Lets sequential UI flows be written as         *
+ * coroutines instead of state machines around    *
+ * fp_event_callback:                             *
+ *                                                *
+ *   auto ev = co_await buttons.next(BUTTON_1);   *
+ *   auto ev2 = co_await buttons.any_of(mask,     *
+ *                                      timeout); *
+ *                                                *
+ * Waiters live in a fixed table and are resumed  *
+ * from the driver's event callback (events) or   *
+ * from poll() (timeouts), on the thread that     *
+ * runs button_process(); no thread per waiter.   *
+ *                                                *
+ **************************************************/
+
+#ifndef BUTTON_CO_HPP
+#define BUTTON_CO_HPP
+
+#include <stdint.h>
+#include <coroutine>
+#include <exception>
+#include "button.h"
+
+#ifndef BUTTON_CO_MAX_WAITERS
+#define BUTTON_CO_MAX_WAITERS   (8)
+#endif
+
+namespace button
+{
+
+enum class wait_status : uint8_t
+{
+    event,
+    timeout,
+    overflow,
+};
+
+struct event
+{
+    wait_status status;
+    button_pressed_types_t type;
+    button_enum id;
+    uint32_t tick;
+};
+
+/**
+ * @brief  Fire-and-forget coroutine type for button flows.
+ *
+ * The coroutine starts running immediately and its frame is released when it
+ * finishes. Flows normally loop forever, suspended in co_await between events.
+ */
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+class co_buttons
+{
+public:
+    class awaiter
+    {
+    public:
+        awaiter(co_buttons & owner, uint32_t mask, uint32_t timeout_us) noexcept
+            : owner_(owner), mask_(mask), timeout_us_(timeout_us)
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            handle_ = handle;
+            return owner_.add_waiter(this);
+        }
+
+        event await_resume() const noexcept { return result_; }
+
+    private:
+        friend class co_buttons;
+
+        co_buttons & owner_;
+        uint32_t mask_;
+        uint32_t timeout_us_;
+        uint32_t start_tick_ = 0;
+        std::coroutine_handle<> handle_;
+        event result_ = {wait_status::overflow, BUTTON_NORMAL_PRESS, BUTTON_1, 0};
+    };
+
+    /**
+     * @brief  Bind the coroutine layer to a driver configuration.
+     *
+     * Only one instance may exist; it becomes the target of on_event(). Set
+     * api.fp_event_callback = button::co_buttons::on_event before
+     * button_initialize(), or call dispatch() from your own callback.
+     */
+    explicit co_buttons(const button_api_t & api) noexcept : api_(api)
+    {
+        instance_ = this;
+    }
+
+    ~co_buttons()
+    {
+        if (this == instance_)
+        {
+            instance_ = nullptr;
+        }
+    }
+
+    co_buttons(const co_buttons &) = delete;
+    co_buttons & operator=(const co_buttons &) = delete;
+
+    /** Wait for the next event of one button; timeout_us = 0 waits forever. */
+    awaiter next(button_enum id, uint32_t timeout_us = 0) noexcept
+    {
+        return awaiter(*this, 1UL << id, timeout_us);
+    }
+
+    /** Wait for the next event of any button in mask (bit n = button n). */
+    awaiter any_of(uint32_t mask, uint32_t timeout_us = 0) noexcept
+    {
+        return awaiter(*this, mask, timeout_us);
+    }
+
+    /** C-compatible event callback forwarding to the bound instance. */
+    static void on_event(button_pressed_types_t type, button_enum button_id)
+    {
+        if (nullptr != instance_)
+        {
+            instance_->dispatch(type, button_id);
+        }
+    }
+
+    /**
+     * @brief  Resume every waiter interested in this event.
+     *
+     * Matching waiters are collected before any of them is resumed, so a flow
+     * that immediately waits again is not woken by the same event.
+     */
+    void dispatch(button_pressed_types_t type, button_enum button_id)
+    {
+        awaiter * ready[BUTTON_CO_MAX_WAITERS];
+        uint8_t count = 0;
+        uint32_t tick = api_.fp_get_current_tick();
+        for (awaiter *& p_waiter : waiters_)
+        {
+            if ((nullptr != p_waiter) && (0 != (p_waiter->mask_ & (1UL << button_id))))
+            {
+                p_waiter->result_ = {wait_status::event, type, button_id, tick};
+                ready[count++] = p_waiter;
+                p_waiter = nullptr;
+            }
+        }
+        resume(ready, count);
+    }
+
+    /**
+     * @brief  Resume waiters whose timeout expired.
+     *
+     * Call periodically, e.g. right after button_process().
+     */
+    void poll()
+    {
+        awaiter * ready[BUTTON_CO_MAX_WAITERS];
+        uint8_t count = 0;
+        uint32_t tick = api_.fp_get_current_tick();
+        for (awaiter *& p_waiter : waiters_)
+        {
+            if ((nullptr != p_waiter) && (0 != p_waiter->timeout_us_)
+                && (api_.fp_tick_elapsed(p_waiter->start_tick_, tick) >= p_waiter->timeout_us_ * api_.tick_count_in_1us))
+            {
+                p_waiter->result_ = {wait_status::timeout, BUTTON_NORMAL_PRESS, BUTTON_1, tick};
+                ready[count++] = p_waiter;
+                p_waiter = nullptr;
+            }
+        }
+        resume(ready, count);
+    }
+
+private:
+    bool add_waiter(awaiter * p_new) noexcept
+    {
+        for (awaiter *& p_waiter : waiters_)
+        {
+            if (nullptr == p_waiter)
+            {
+                p_new->start_tick_ = api_.fp_get_current_tick();
+                p_waiter = p_new;
+                return true;
+            }
+        }
+        // No free slot: do not suspend, await_resume() reports wait_status::overflow.
+        return false;
+    }
+
+    static void resume(awaiter * const * pp_ready, uint8_t count)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            pp_ready[i]->handle_.resume();
+        }
+    }
+
+    const button_api_t & api_;
+    awaiter * waiters_[BUTTON_CO_MAX_WAITERS] = {};
+    static inline co_buttons * instance_ = nullptr;
+};
+
+} // namespace button
+
+#endif // BUTTON_CO_HPP
@@ -0,0 +1,359 @@
+/**************************************************
+ * @file    button_history.c                      *
+ * @brief   Event history ring with time-range    *
+ *          and per-button queries                *
+ *                                                *
+ * Description:                                   *
+ * Keeps the last BUTTON_HISTORY_SIZE events      *
+ * emitted by the driver for diagnostics, crash   *
+ * dumps and gesture logic that needs "what       *
+ * happened in the last N seconds". Range queries *
+ * are a binary search over the time-ordered      *
+ * ring, per-button queries follow a chain of     *
+ * back distances, so neither scans the ring.     *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "button_history.h"
+
+#if (BUTTON_HISTORY_SIZE > 0)
+
+#define HISTORY_MAGIC       (0x48495332UL)
+#define HISTORY_TIME_MASK   ((1ULL << 40) - 1)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t written;
+    uint32_t expired;
+    uint32_t last_tick;
+    uint8_t epoch;
+    uint32_t newest_seq[BUTTON_MAX];
+    uint32_t tick[BUTTON_HISTORY_SIZE];
+    uint8_t epoch_of[BUTTON_HISTORY_SIZE];
+    uint8_t code[BUTTON_HISTORY_SIZE];
+    uint8_t back[BUTTON_HISTORY_SIZE];
+} history_t;
+
+static BUTTON_HISTORY_ATTR history_t history;
+
+/**
+ * @fn     ensure_valid
+ * @brief  Start from an empty ring if the storage does not hold a valid history.
+ */
+
+static void ensure_valid(void)
+{
+    if (HISTORY_MAGIC != history.magic)
+    {
+        button_history_clear();
+    }
+}
+
+/**
+ * @fn     oldest_seq
+ * @brief  Sequence number of the oldest entry still held.
+ */
+
+static uint32_t oldest_seq(void)
+{
+    uint32_t overwritten = (history.written > BUTTON_HISTORY_SIZE) ? (history.written - BUTTON_HISTORY_SIZE) : 0;
+    return (history.expired > overwritten) ? history.expired : overwritten;
+}
+
+/**
+ * @fn     advance_to
+ * @brief  Follow the tick to now, counting a wrap when it went backwards.
+ *
+ * A new wrap count makes the 8-bit count of entries recorded 256 wraps
+ * ago ambiguous, so those entries (always the oldest ones) are expired.
+ * A wrap is the 32-bit tick going backwards; narrower counters are not
+ * supported (see button_history.h).
+ */
+
+static void advance_to(uint32_t now)
+{
+    if (now < history.last_tick)
+    {
+        uint32_t seq = oldest_seq();
+        history.epoch++;
+        while ((seq < history.written) && (history.epoch_of[seq % BUTTON_HISTORY_SIZE] == history.epoch))
+        {
+            seq++;
+        }
+        history.expired = seq;
+    }
+    history.last_tick = now;
+}
+
+/**
+ * @fn     age_of
+ * @brief  Age in ticks of an entry, counting tick wraps between it and now.
+ *
+ * Times are extended to 40 bits with the wrap count kept per entry. The count
+ * advances at every record and at every scan (button_history_advance), so ages
+ * stay correct across any number of wraps as long as scans are less than one
+ * wrap apart. The age is taken at the last tick seen, where it is below 256
+ * wraps for every entry held, and then moved to now, which must lie within half
+ * a wrap of the last tick seen. A now behind it (read before the latest scan,
+ * possibly across a wrap) counts as age 0 for newer entries.
+ *
+ * @param  seq  Sequence number of the entry.
+ * @param  now  Current tick.
+ * @return Age in ticks.
+ */
+
+static uint64_t age_of(uint32_t seq, uint32_t now)
+{
+    uint16_t slot = (uint16_t)(seq % BUTTON_HISTORY_SIZE);
+    uint64_t last_ext = ((uint64_t)history.epoch << 32) | history.last_tick;
+    uint64_t then_ext = ((uint64_t)history.epoch_of[slot] << 32) | history.tick[slot];
+    uint64_t age = (last_ext - then_ext) & HISTORY_TIME_MASK;
+    uint32_t ahead = now - history.last_tick;
+    if (ahead < 0x80000000UL)
+    {
+        age += ahead;
+    }
+    else
+    {
+        uint32_t behind = history.last_tick - now;
+        age = (age > behind) ? (age - behind) : 0;
+    }
+    return age;
+}
+
+/**
+ * @fn     fill_entry
+ * @brief  Unpack the entry with the given sequence number.
+ */
+
+static void fill_entry(uint32_t seq, button_history_entry_t * p_entry)
+{
+    uint16_t slot = (uint16_t)(seq % BUTTON_HISTORY_SIZE);
+    p_entry->tick = history.tick[slot];
+    p_entry->type = (button_pressed_types_t)(history.code[slot] >> 4);
+    p_entry->button_id = (button_enum)(history.code[slot] & 0x0F);
+}
+
+/**
+ * @fn     button_history_record
+ * @brief  Append an emitted event; the oldest entry is overwritten when full.
+ *
+ * Called by the driver for every event it emits. Ticks must be non-decreasing
+ * (modulo wrap), which emission ticks are.
+ *
+ * @param  type       Event type.
+ * @param  button_id  Button that produced the event.
+ * @param  tick       Tick at emission.
+ */
+
+void button_history_record(button_pressed_types_t type, button_enum button_id, uint32_t tick)
+{
+    uint16_t slot = 0;
+    ensure_valid();
+    if (button_id < BUTTON_MAX)
+    {
+        if (history.written > 0)
+        {
+            advance_to(tick);
+        }
+        slot = (uint16_t)(history.written % BUTTON_HISTORY_SIZE);
+        history.tick[slot] = tick;
+        history.epoch_of[slot] = history.epoch;
+        history.code[slot] = (uint8_t)(((uint8_t)type << 4) | (uint8_t)button_id);
+        history.back[slot] = 0;
+        if (0 != history.newest_seq[button_id])
+        {
+            uint32_t distance = history.written - (history.newest_seq[button_id] - 1);
+            if ((distance < BUTTON_HISTORY_SIZE) && (distance <= UINT8_MAX))
+            {
+                history.back[slot] = (uint8_t)distance;
+            }
+        }
+        history.newest_seq[button_id] = history.written + 1;
+        history.last_tick = tick;
+        history.written++;
+    }
+}
+
+/**
+ * @fn     button_history_advance
+ * @brief  Let the ring see the current tick, so it counts wraps between events.
+ *
+ * Called by the driver at every scan of the built-in instance.
+ *
+ * @param  now  Current tick.
+ */
+
+void button_history_advance(uint32_t now)
+{
+    ensure_valid();
+    if (history.written > 0)
+    {
+        advance_to(now);
+    }
+}
+
+/**
+ * @fn     button_history_clear
+ * @brief  Drop every entry and mark the storage as valid.
+ */
+
+void button_history_clear(void)
+{
+    memset(&history, 0, sizeof(history));
+    history.magic = HISTORY_MAGIC;
+}
+
+/**
+ * @fn     button_history_count
+ * @brief  Number of entries currently held.
+ */
+
+uint16_t button_history_count(void)
+{
+    ensure_valid();
+    return (uint16_t)(history.written - oldest_seq());
+}
+
+/**
+ * @fn     button_history_get
+ * @brief  Read an entry by age order.
+ *
+ * @param  age_index  0 for the newest entry, count-1 for the oldest.
+ * @param  p_entry    Receives the entry.
+ * @return 0 on success; -1 if age_index is out of range or p_entry is NULL.
+ */
+
+int button_history_get(uint16_t age_index, button_history_entry_t * p_entry)
+{
+    int ret = -1;
+    if ((NULL != p_entry) && (age_index < button_history_count()))
+    {
+        fill_entry(history.written - 1 - age_index, p_entry);
+        ret = 0;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_history_count_since
+ * @brief  Number of entries not older than window_tick, found by binary search.
+ *
+ * The result k means entries with age_index 0..k-1 fall in the window, so they
+ * can be read with button_history_get().
+ *
+ * @param  now          Current tick.
+ * @param  window_tick  Window length in ticks.
+ * @return Number of entries inside the window.
+ */
+
+uint16_t button_history_count_since(uint32_t now, uint32_t window_tick)
+{
+    uint16_t low = 0;
+    uint16_t high = button_history_count();
+    while (low < high)
+    {
+        uint16_t mid = (uint16_t)((low + high) / 2);
+        if (age_of(history.written - 1 - mid, now) <= window_tick)
+        {
+            low = (uint16_t)(mid + 1);
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @fn     button_history_query_button
+ * @brief  Copy the events of one button inside a time window, newest first.
+ *
+ * Follows the button's chain of entries, so the cost is proportional to the
+ * number of results rather than to the ring size.
+ *
+ * @param  button_id    Button to query.
+ * @param  now          Current tick.
+ * @param  window_tick  Window length in ticks.
+ * @param  p_entries    Output array.
+ * @param  max_entries  Capacity of p_entries.
+ * @return Number of entries copied.
+ */
+
+uint16_t button_history_query_button(button_enum button_id, uint32_t now, uint32_t window_tick,
+                                     button_history_entry_t * p_entries, uint16_t max_entries)
+{
+    uint16_t found = 0;
+    ensure_valid();
+    if ((button_id < BUTTON_MAX) && (NULL != p_entries) && (0 != history.newest_seq[button_id]))
+    {
+        uint32_t oldest = oldest_seq();
+        uint32_t seq = history.newest_seq[button_id] - 1;
+        while ((found < max_entries) && (seq >= oldest) && (age_of(seq, now) <= window_tick))
+        {
+            uint8_t back = history.back[seq % BUTTON_HISTORY_SIZE];
+            fill_entry(seq, &p_entries[found++]);
+            if ((0 == back) || (back > (seq - oldest)))
+            {
+                break;
+            }
+            seq -= back;
+        }
+    }
+    return found;
+}
+
+#else
+
+void button_history_record(button_pressed_types_t type, button_enum button_id, uint32_t tick)
+{
+    (void)type;
+    (void)button_id;
+    (void)tick;
+}
+
+void button_history_advance(uint32_t now)
+{
+    (void)now;
+}
+
+void button_history_clear(void)
+{
+}
+
+uint16_t button_history_count(void)
+{
+    return 0;
+}
+
+int button_history_get(uint16_t age_index, button_history_entry_t * p_entry)
+{
+    (void)age_index;
+    (void)p_entry;
+    return -1;
+}
+
+uint16_t button_history_count_since(uint32_t now, uint32_t window_tick)
+{
+    (void)now;
+    (void)window_tick;
+    return 0;
+}
+
+uint16_t button_history_query_button(button_enum button_id, uint32_t now, uint32_t window_tick,
+                                     button_history_entry_t * p_entries, uint16_t max_entries)
+{
+    (void)button_id;
+    (void)now;
+    (void)window_tick;
+    (void)p_entries;
+    (void)max_entries;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef BUTTON_HISTORY_H
+#define BUTTON_HISTORY_H
+
+#include <stdint.h>
+#include "button.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-size ring of the last BUTTON_HISTORY_SIZE emitted events (0 disables it).
+ * Each entry takes 7 bytes: tick, tick wrap count, packed button/type, and the
+ * distance back to the previous entry of the same button. Entries are stored in
+ * emission order, so the ring is its own time index: range queries binary-search
+ * it and per-button queries follow the per-button chain, never scanning the ring.
+ *
+ * The driver reports the tick at every scan (button_history_advance), so wraps
+ * are counted while no events arrive as long as scans are less than one wrap
+ * apart. Entries expire once they are 256 wraps old. The now passed to the
+ * queries must be within half a wrap of the last scan.
+ *
+ * Ages are computed on the raw ticks, not through fp_tick_elapsed, so the ring
+ * needs a free-running 32-bit tick (e.g. a gptimer or DWT count). With a
+ * narrower counter (a 24-bit SysTick) wraps are missed and ranges come out
+ * wrong; keep BUTTON_HISTORY_SIZE at 0 for such tick sources.
+ *
+ * There is one ring per program, without locking: the driver records the events
+ * of its built-in instance only (see button_instance_t).
+ *
+ * Define BUTTON_HISTORY_ATTR (e.g. RTC_NOINIT_ATTR or a .noinit section) to keep
+ * the ring across a reset for crash dumps; a magic word detects garbage at cold boot.
+ */
+
+#ifndef BUTTON_HISTORY_SIZE
+#define BUTTON_HISTORY_SIZE     (0)
+#endif
+
+#ifndef BUTTON_HISTORY_ATTR
+#define BUTTON_HISTORY_ATTR
+#endif
+
+#if (BUTTON_HISTORY_SIZE > 256)
+#error "BUTTON_HISTORY_SIZE must not exceed 256"
+#endif
+
+typedef struct
+{
+    uint32_t tick;
+    button_pressed_types_t type;
+    button_enum button_id;
+} button_history_entry_t;
+
+extern void button_history_record(button_pressed_types_t type, button_enum button_id, uint32_t tick);
+extern void button_history_advance(uint32_t now);
+extern void button_history_clear(void);
+extern uint16_t button_history_count(void);
+extern int button_history_get(uint16_t age_index, button_history_entry_t * p_entry);
+extern uint16_t button_history_count_since(uint32_t now, uint32_t window_tick);
+extern uint16_t button_history_query_button(button_enum button_id, uint32_t now, uint32_t window_tick,
+                                            button_history_entry_t * p_entries, uint16_t max_entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUTTON_HISTORY_H
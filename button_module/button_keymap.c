@@ -0,0 +1,76 @@
+/**************************************************
+ * @file    button_keymap.c                       *
+ * @brief   Keymap and layer stage for button     *
+ *          events                                *
+ *                                                *
+ * Description:                                   *
+ * Maps (button, event type, active layer) to an  *
+ * application action code using flat tables      *
+ * built at compile time. Layers are selected by  *
+ * holding modifier buttons, as in keyboard       *
+ * firmware. Both the layer and the action are    *
+ * single table reads, so the cost per event is   *
+ * constant regardless of panel size.             *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "button_keymap.h"
+
+_Static_assert(BUTTON_KEYMAP_MASKS == 32, "BUTTON_KEYMAP_LAYER_TABLE expands to 32 entries; adjust it to BUTTON_MAX");
+
+/**
+ * @fn     button_keymap_active_layer
+ * @brief  Return the layer selected by the modifiers held when the button's press began.
+ *
+ * The layer resolves at the press, as in keyboard firmware: a modifier released
+ * before the event is delivered (a normal press waits out the multi-press
+ * window) still counts. The button that produced the event is left out of the
+ * held mask, so a modifier can still have actions of its own on the base layer.
+ *
+ * @param  p_keymap   Keymap with its layer-of-mask table.
+ * @param  button_id  Button the event belongs to.
+ * @return Active layer, 0 if none or if the table selects a missing layer.
+ */
+
+uint8_t button_keymap_active_layer(const button_keymap_t * p_keymap, button_enum button_id)
+{
+    uint8_t layer = 0;
+    if ((NULL != p_keymap) && (NULL != p_keymap->p_layer_of_mask))
+    {
+        uint32_t mask = button_get_press_modifiers(button_id) & (BUTTON_KEYMAP_MASKS - 1);
+        layer = p_keymap->p_layer_of_mask[mask];
+        if (layer >= p_keymap->layer_count)
+        {
+            layer = 0;
+        }
+    }
+    return layer;
+}
+
+/**
+ * @fn     button_keymap_lookup
+ * @brief  Translate a button event into the application action of the active layer.
+ *
+ * Intended to replace the switch in fp_event_callback:
+ *
+ *   run_action(button_keymap_lookup(&keymap, type, button_id));
+ *
+ * @param  p_keymap   Keymap tables.
+ * @param  type       Event type.
+ * @param  button_id  Button that produced the event.
+ * @return Action code, or BUTTON_ACTION_NONE if unmapped or arguments are invalid.
+ */
+
+button_action_t button_keymap_lookup(const button_keymap_t * p_keymap, button_pressed_types_t type, button_enum button_id)
+{
+    button_action_t action = BUTTON_ACTION_NONE;
+    if ((NULL != p_keymap) && (NULL != p_keymap->p_actions)
+        && (button_id < BUTTON_MAX) && (type < BUTTON_PRESS_TYPE_MAX))
+    {
+        uint8_t layer = button_keymap_active_layer(p_keymap, button_id);
+        action = p_keymap->p_actions[BUTTON_KEYMAP_INDEX(layer, button_id, type)];
+    }
+    return action;
+}
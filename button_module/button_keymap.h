@@ -0,0 +1,64 @@
+#ifndef BUTTON_KEYMAP_H
+#define BUTTON_KEYMAP_H
+
+#include <stdint.h>
+#include "button.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Flat keymap: one action code per (layer, button, event type), laid out as
+ * actions[BUTTON_KEYMAP_INDEX(layer, button, type)]. The active layer comes from
+ * a table indexed by the mask of held buttons, so both lookups are O(1).
+ *
+ * Layer tables are built at compile time from up to three modifier sets; the
+ * highest layer whose modifiers are all held wins, so a chord of two modifiers
+ * can select its own layer:
+ *
+ *   static const uint8_t layers[BUTTON_KEYMAP_MASKS] =
+ *       BUTTON_KEYMAP_LAYER_TABLE(1UL << BUTTON_4, 1UL << BUTTON_5, (1UL << BUTTON_4) | (1UL << BUTTON_5));
+ *   static const button_action_t actions[BUTTON_KEYMAP_SIZE(4)] = {
+ *       [BUTTON_KEYMAP_INDEX(0, BUTTON_1, BUTTON_NORMAL_PRESS)] = ACTION_PLAY,
+ *       [BUTTON_KEYMAP_INDEX(1, BUTTON_1, BUTTON_NORMAL_PRESS)] = ACTION_NEXT,
+ *   };
+ */
+
+typedef uint16_t button_action_t;
+
+#define BUTTON_ACTION_NONE                  (0)
+#define BUTTON_KEYMAP_MAX_LAYERS            (4)
+#define BUTTON_KEYMAP_MASKS                 (1UL << BUTTON_MAX)
+#define BUTTON_KEYMAP_INDEX(layer, button, type) \
+    ((((layer) * BUTTON_MAX) + (button)) * BUTTON_PRESS_TYPE_MAX + (type))
+#define BUTTON_KEYMAP_SIZE(layers)          ((layers) * BUTTON_MAX * BUTTON_PRESS_TYPE_MAX)
+
+#define BUTTON_KEYMAP_LAYER_FOR(mask, m1, m2, m3) \
+    (uint8_t)(((0 != (m3)) && (((mask) & (m3)) == (m3))) ? 3 : \
+              ((0 != (m2)) && (((mask) & (m2)) == (m2))) ? 2 : \
+              ((0 != (m1)) && (((mask) & (m1)) == (m1))) ? 1 : 0)
+#define BUTTON_KEYMAP_LT4(b, m1, m2, m3) \
+    BUTTON_KEYMAP_LAYER_FOR((b) + 0, m1, m2, m3), BUTTON_KEYMAP_LAYER_FOR((b) + 1, m1, m2, m3), \
+    BUTTON_KEYMAP_LAYER_FOR((b) + 2, m1, m2, m3), BUTTON_KEYMAP_LAYER_FOR((b) + 3, m1, m2, m3)
+#define BUTTON_KEYMAP_LT16(b, m1, m2, m3) \
+    BUTTON_KEYMAP_LT4((b) + 0, m1, m2, m3), BUTTON_KEYMAP_LT4((b) + 4, m1, m2, m3), \
+    BUTTON_KEYMAP_LT4((b) + 8, m1, m2, m3), BUTTON_KEYMAP_LT4((b) + 12, m1, m2, m3)
+#define BUTTON_KEYMAP_LAYER_TABLE(m1, m2, m3) \
+    { BUTTON_KEYMAP_LT16(0, m1, m2, m3), BUTTON_KEYMAP_LT16(16, m1, m2, m3) }
+
+typedef struct
+{
+    const button_action_t * p_actions;
+    const uint8_t * p_layer_of_mask;
+    uint8_t layer_count;
+} button_keymap_t;
+
+extern uint8_t button_keymap_active_layer(const button_keymap_t * p_keymap, button_enum button_id);
+extern button_action_t button_keymap_lookup(const button_keymap_t * p_keymap, button_pressed_types_t type, button_enum button_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUTTON_KEYMAP_H
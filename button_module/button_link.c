@@ -0,0 +1,346 @@
+/**************************************************
+ * @file    button_link.c                         *
+ * @brief   Batched binary frames for remote      *
+ *          button panels                         *
+ *                                                *
+ * Description:                                   *
+ * Packs the button events of a remote node       *
+ * into compact, CRC protected, sequenced         *
+ * frames for a UART/RS-485 link, and parses      *
+ * the byte stream back into frames on the        *
+ * receiving side. The transport is abstracted    *
+ * behind a write function so the same code runs  *
+ * over a serial port, a pty or a pipe.           *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "button_link.h"
+
+#define VARINT_MAX_BYTES    (5)
+
+/**
+ * @fn     button_link_crc16
+ * @brief  Compute CRC-16/CCITT (poly 0x1021, init 0xFFFF) over a buffer.
+ *
+ * @param  p_data  Bytes to checksum.
+ * @param  len     Number of bytes.
+ * @return The 16-bit CRC.
+ */
+
+uint16_t button_link_crc16(const uint8_t * p_data, uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint16_t i = 0;
+    uint8_t bit = 0;
+    for (i=0; i<len; i++)
+    {
+        crc ^= (uint16_t)((uint16_t)p_data[i] << 8);
+        for (bit=0; bit<8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @fn     button_link_tx_init
+ * @brief  Prepare a transmitter for one node.
+ *
+ * @param  p_tx      Transmitter state to initialize.
+ * @param  node_id   Identifier of this node on the link.
+ * @param  fp_write  Function writing raw bytes to the link; returns the number of
+ *                   bytes written or a negative value on error.
+ */
+
+void button_link_tx_init(button_link_tx_t * p_tx, uint16_t node_id,
+                         int32_t (* fp_write)(const uint8_t * p_data, uint16_t len))
+{
+    if (NULL != p_tx)
+    {
+        memset(p_tx, 0, sizeof(*p_tx));
+        p_tx->node_id = node_id;
+        p_tx->fp_write = fp_write;
+    }
+}
+
+/**
+ * @fn     button_link_tx_push
+ * @brief  Queue one event for the next frame.
+ *
+ * When the batch is already full it is flushed first, using the tick of the new
+ * entry as the frame base tick.
+ *
+ * @param  p_tx    Transmitter state.
+ * @param  type    Type of the event.
+ * @param  button  Button that produced the event.
+ * @param  tick    Node tick of the event.
+ * @return 0 on success; -1 on invalid arguments or if the forced flush failed.
+ */
+
+int button_link_tx_push(button_link_tx_t * p_tx, button_pressed_types_t type, button_enum button, uint32_t tick)
+{
+    int ret = -1;
+    if ((NULL != p_tx) && (type < BUTTON_PRESS_TYPE_MAX) && (button < BUTTON_MAX))
+    {
+        ret = 0;
+        if (BUTTON_LINK_MAX_EVENTS == p_tx->count)
+        {
+            ret = (button_link_tx_flush(p_tx, tick) < 0) ? -1 : 0;
+        }
+        if (0 == ret)
+        {
+            p_tx->events[p_tx->count].kind = (uint8_t)type;
+            p_tx->events[p_tx->count].button = (uint8_t)button;
+            p_tx->events[p_tx->count].tick = tick;
+            p_tx->count++;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_link_tx_flush
+ * @brief  Encode the queued entries into one frame and write it to the link.
+ *
+ * An empty batch still produces a frame; such heartbeat frames carry the node tick
+ * and keep the receiver's sequence and clock tracking alive.
+ *
+ * @param  p_tx  Transmitter state.
+ * @param  now   Current node tick, stored as the frame base tick.
+ * @return Number of bytes written, or -1 if the write failed.
+ */
+
+int button_link_tx_flush(button_link_tx_t * p_tx, uint32_t now)
+{
+    int ret = -1;
+    if ((NULL != p_tx) && (NULL != p_tx->fp_write))
+    {
+        uint8_t frame[BUTTON_LINK_MAX_FRAME];
+        uint16_t pos = BUTTON_LINK_HEADER_SIZE;
+        uint16_t crc = 0;
+        uint8_t i = 0;
+        for (i=0; i<p_tx->count; i++)
+        {
+            uint32_t age = now - p_tx->events[i].tick;
+            frame[pos++] = (uint8_t)((p_tx->events[i].kind << 4) | p_tx->events[i].button);
+            while (age >= 0x80)
+            {
+                frame[pos++] = (uint8_t)(age | 0x80);
+                age >>= 7;
+            }
+            frame[pos++] = (uint8_t)age;
+        }
+        frame[0] = BUTTON_LINK_SOF;
+        frame[1] = (uint8_t)(pos - BUTTON_LINK_HEADER_SIZE);
+        frame[2] = (uint8_t)p_tx->node_id;
+        frame[3] = (uint8_t)(p_tx->node_id >> 8);
+        frame[4] = p_tx->seq;
+        frame[5] = p_tx->count;
+        frame[6] = (uint8_t)now;
+        frame[7] = (uint8_t)(now >> 8);
+        frame[8] = (uint8_t)(now >> 16);
+        frame[9] = (uint8_t)(now >> 24);
+        crc = button_link_crc16(&frame[1], (uint16_t)(pos - 1));
+        frame[pos++] = (uint8_t)crc;
+        frame[pos++] = (uint8_t)(crc >> 8);
+
+        if (p_tx->fp_write(frame, pos) == (int32_t)pos)
+        {
+            ret = pos;
+        }
+        p_tx->seq++;
+        p_tx->count = 0;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_link_rx_init
+ * @brief  Prepare a receiver.
+ *
+ * @param  p_rx               Receiver state to initialize.
+ * @param  fp_frame_callback  Invoked for every frame that passes the CRC check.
+ */
+
+void button_link_rx_init(button_link_rx_t * p_rx, void (* fp_frame_callback)(const button_link_frame_t * p_frame))
+{
+    if (NULL != p_rx)
+    {
+        memset(p_rx, 0, sizeof(*p_rx));
+        p_rx->fp_frame_callback = fp_frame_callback;
+    }
+}
+
+/**
+ * @fn     decode_frame
+ * @brief  Validate and unpack the complete frame held in the receive buffer.
+ *
+ * @param  p_rx  Receiver state; p_rx->buf holds exactly one candidate frame.
+ * @param  size  Size of the candidate frame in bytes.
+ * @return 1 if the frame is valid and was unpacked into p_rx->frame, 0 otherwise.
+ */
+
+static int decode_frame(button_link_rx_t * p_rx, uint16_t size)
+{
+    const uint8_t * p = p_rx->buf;
+    uint16_t end = (uint16_t)(size - BUTTON_LINK_CRC_SIZE);
+    uint16_t crc = (uint16_t)(p[end] | (p[end + 1] << 8));
+    uint16_t pos = BUTTON_LINK_HEADER_SIZE;
+    uint8_t i = 0;
+    int valid = (crc == button_link_crc16(&p[1], (uint16_t)(end - 1))) && (p[5] <= BUTTON_LINK_MAX_EVENTS);
+
+    if (valid)
+    {
+        p_rx->frame.node_id = (uint16_t)(p[2] | (p[3] << 8));
+        p_rx->frame.seq = p[4];
+        p_rx->frame.count = p[5];
+        p_rx->frame.base_tick = (uint32_t)p[6] | ((uint32_t)p[7] << 8) | ((uint32_t)p[8] << 16) | ((uint32_t)p[9] << 24);
+        for (i=0; (i<p_rx->frame.count) && valid; i++)
+        {
+            uint32_t age = 0;
+            uint8_t shift = 0;
+            uint8_t byte = 0x80;
+            valid = (pos < end);
+            if (valid)
+            {
+                p_rx->frame.events[i].kind = (uint8_t)(p[pos] >> 4);
+                p_rx->frame.events[i].button = (uint8_t)(p[pos] & 0x0F);
+                valid = (p_rx->frame.events[i].kind < BUTTON_PRESS_TYPE_MAX) && (p_rx->frame.events[i].button < BUTTON_MAX);
+                pos++;
+            }
+            while (valid && (byte & 0x80))
+            {
+                valid = (pos < end) && (shift < 7 * VARINT_MAX_BYTES);
+                if (valid)
+                {
+                    byte = p[pos++];
+                    age |= (uint32_t)(byte & 0x7F) << shift;
+                    shift = (uint8_t)(shift + 7);
+                }
+            }
+            p_rx->frame.events[i].tick = p_rx->frame.base_tick - age;
+        }
+        valid = valid && (pos == end);
+    }
+    return valid;
+}
+
+/**
+ * @fn     track_sequence
+ * @brief  Count frames missing from a node's sequence and spot repeated frames.
+ *
+ * A frame with the same sequence number as the node's previous one is a repeat
+ * (e.g. a retransmission), not a gap of 255 frames.
+ *
+ * @param  p_rx  Receiver state.
+ * @return 1 if the frame repeats the node's previous frame, 0 otherwise.
+ */
+
+static uint8_t track_sequence(button_link_rx_t * p_rx)
+{
+    uint16_t node = p_rx->frame.node_id;
+    uint8_t duplicate = 0;
+    if (node < BUTTON_LINK_MAX_NODES)
+    {
+        uint8_t mask = (uint8_t)(1U << (node & 7));
+        if (p_rx->seq_valid[node >> 3] & mask)
+        {
+            if (p_rx->frame.seq == p_rx->last_seq[node])
+            {
+                p_rx->duplicate_frames++;
+                duplicate = 1;
+            }
+            else
+            {
+                p_rx->lost_frames += (uint8_t)(p_rx->frame.seq - p_rx->last_seq[node] - 1);
+            }
+        }
+        p_rx->seq_valid[node >> 3] |= mask;
+        p_rx->last_seq[node] = p_rx->frame.seq;
+    }
+    return duplicate;
+}
+
+/**
+ * @fn     resync
+ * @brief  Drop the buffered bytes before the first SOF at or after an offset.
+ *
+ * @param  p_rx  Receiver state.
+ * @param  from  First buffer offset that may start the next frame.
+ */
+
+static void resync(button_link_rx_t * p_rx, uint16_t from)
+{
+    uint8_t * p_sof = NULL;
+    if (from < p_rx->fill)
+    {
+        p_sof = memchr(&p_rx->buf[from], BUTTON_LINK_SOF, (size_t)(p_rx->fill - from));
+    }
+    if (NULL != p_sof)
+    {
+        p_rx->fill = (uint16_t)(p_rx->fill - (p_sof - p_rx->buf));
+        memmove(p_rx->buf, p_sof, p_rx->fill);
+    }
+    else
+    {
+        p_rx->fill = 0;
+    }
+}
+
+/**
+ * @fn     button_link_rx_feed
+ * @brief  Feed received link bytes into the frame parser.
+ *
+ * Bytes may arrive in any fragmentation. Data before a start-of-frame byte is
+ * skipped; when a candidate frame fails its CRC the parser resynchronizes on the
+ * next start-of-frame byte inside it, so a corrupted frame costs only itself.
+ * A false candidate (a corrupted length, or noise containing SOF) may hold the
+ * following frames in the buffer until it is complete; they are parsed from
+ * there, so they arrive late but are not lost.
+ *
+ * @param  p_rx    Receiver state.
+ * @param  p_data  Received bytes.
+ * @param  len     Number of received bytes.
+ */
+
+void button_link_rx_feed(button_link_rx_t * p_rx, const uint8_t * p_data, uint16_t len)
+{
+    uint16_t i = 0;
+    if ((NULL == p_rx) || (NULL == p_data))
+    {
+        return;
+    }
+    for (i=0; i<len; i++)
+    {
+        if ((0 == p_rx->fill) && (BUTTON_LINK_SOF != p_data[i]))
+        {
+            continue;
+        }
+        p_rx->buf[p_rx->fill++] = p_data[i];
+        while (p_rx->fill >= 2)
+        {
+            uint16_t size = (uint16_t)(BUTTON_LINK_HEADER_SIZE + p_rx->buf[1] + BUTTON_LINK_CRC_SIZE);
+            if (p_rx->fill < size)
+            {
+                break;
+            }
+            if (decode_frame(p_rx, size))
+            {
+                p_rx->frames++;
+                if ((0 == track_sequence(p_rx)) && (NULL != p_rx->fp_frame_callback))
+                {
+                    p_rx->fp_frame_callback(&p_rx->frame);
+                }
+                resync(p_rx, size);
+            }
+            else
+            {
+                p_rx->crc_errors++;
+                resync(p_rx, 1);
+            }
+        }
+    }
+}
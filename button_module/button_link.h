@@ -0,0 +1,97 @@
+#ifndef BUTTON_LINK_H
+#define BUTTON_LINK_H
+
+#include <stdint.h>
+#include "button.h"
+
+/*
+ * Frame layout (little endian), one frame per flush:
+ *
+ *   0      SOF (0xA5)
+ *   1      payload length in bytes
+ *   2..3   node id
+ *   4      sequence number (per node, wraps at 256)
+ *   5      number of entries
+ *   6..9   node tick at flush (base tick)
+ *   10..   entries: code byte ((kind << 4) | button) followed by the
+ *          LEB128 varint age of the entry (base tick - entry tick)
+ *   last 2 CRC-16/CCITT (poly 0x1021, init 0xFFFF) over bytes 1..end of payload
+ *
+ * kind is the button_pressed_types_t value of a classified event. Raw edges are
+ * not carried: the receiving driver has no pin to apply them to.
+ *
+ * An entry takes at most BUTTON_LINK_MAX_ENTRY_SIZE bytes (code byte and a 5-byte
+ * varint), so BUTTON_LINK_MAX_EVENTS entries must fit the one-byte payload length.
+ */
+
+#ifndef BUTTON_LINK_MAX_EVENTS
+#define BUTTON_LINK_MAX_EVENTS      (32)
+#endif
+
+#ifndef BUTTON_LINK_MAX_NODES
+#define BUTTON_LINK_MAX_NODES       (256)
+#endif
+
+#define BUTTON_LINK_SOF             (0xA5)
+#define BUTTON_LINK_HEADER_SIZE     (10)
+#define BUTTON_LINK_CRC_SIZE        (2)
+#define BUTTON_LINK_MAX_PAYLOAD     (255)
+#define BUTTON_LINK_MAX_FRAME       (BUTTON_LINK_HEADER_SIZE + BUTTON_LINK_MAX_PAYLOAD + BUTTON_LINK_CRC_SIZE)
+#define BUTTON_LINK_MAX_ENTRY_SIZE  (6)
+
+#if (BUTTON_LINK_MAX_EVENTS < 1) || (BUTTON_LINK_MAX_EVENTS > 255)
+#error "BUTTON_LINK_MAX_EVENTS must be 1..255 (one-byte entry count)"
+#endif
+
+#if ((BUTTON_LINK_MAX_EVENTS * BUTTON_LINK_MAX_ENTRY_SIZE) > BUTTON_LINK_MAX_PAYLOAD)
+#error "BUTTON_LINK_MAX_EVENTS full-size entries exceed the 255-byte payload (at most 42)"
+#endif
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t button;
+    uint32_t tick;
+} button_link_event_t;
+
+typedef struct
+{
+    uint16_t node_id;
+    uint8_t seq;
+    uint8_t count;
+    uint32_t base_tick;
+    button_link_event_t events[BUTTON_LINK_MAX_EVENTS];
+} button_link_frame_t;
+
+typedef struct
+{
+    uint16_t node_id;
+    uint8_t seq;
+    uint8_t count;
+    button_link_event_t events[BUTTON_LINK_MAX_EVENTS];
+    int32_t (* fp_write)(const uint8_t * p_data, uint16_t len);
+} button_link_tx_t;
+
+typedef struct
+{
+    uint8_t buf[BUTTON_LINK_MAX_FRAME];
+    uint16_t fill;
+    button_link_frame_t frame;
+    uint8_t last_seq[BUTTON_LINK_MAX_NODES];
+    uint8_t seq_valid[(BUTTON_LINK_MAX_NODES + 7) / 8];
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t lost_frames;
+    uint32_t duplicate_frames;          // repeats of a node's previous frame, not delivered
+    void (* fp_frame_callback)(const button_link_frame_t * p_frame);
+} button_link_rx_t;
+
+extern uint16_t button_link_crc16(const uint8_t * p_data, uint16_t len);
+extern void button_link_tx_init(button_link_tx_t * p_tx, uint16_t node_id,
+                                int32_t (* fp_write)(const uint8_t * p_data, uint16_t len));
+extern int button_link_tx_push(button_link_tx_t * p_tx, button_pressed_types_t type, button_enum button, uint32_t tick);
+extern int button_link_tx_flush(button_link_tx_t * p_tx, uint32_t now);
+extern void button_link_rx_init(button_link_rx_t * p_rx, void (* fp_frame_callback)(const button_link_frame_t * p_frame));
+extern void button_link_rx_feed(button_link_rx_t * p_rx, const uint8_t * p_data, uint16_t len);
+
+#endif // BUTTON_LINK_H
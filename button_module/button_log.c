@@ -0,0 +1,310 @@
+/**************************************************
+ * @file    button_log.c                          *
+ * @brief   Delta-encoded in-RAM event log        *
+ *                                                *
+ * Description:                                   *
+ * Compact always-on log of the events emitted by *
+ * the driver, for post-mortem analysis. Each     *
+ * record packs type and button with the low bit  *
+ * of a varint time delta, so most events take    *
+ * 1-3 bytes. Recording is a few shifts and byte  *
+ * stores, cheap enough for the button_process()  *
+ * path. button_log_decode() is plain C and is    *
+ * also used by the host-side decoder.            *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "button_log.h"
+
+#if (BUTTON_LOG_TICK_SHIFT == 0)
+#define LOG_UNIT_MASK   (0xFFFFFFFFUL)
+#else
+#define LOG_UNIT_MASK   ((1UL << (32 - BUTTON_LOG_TICK_SHIFT)) - 1)
+#endif
+
+/**
+ * @fn     put_u32
+ * @brief  Store a little endian 32-bit value.
+ */
+
+static void put_u32(uint8_t * p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @fn     get_u32
+ * @brief  Load a little endian 32-bit value.
+ */
+
+static uint32_t get_u32(const uint8_t * p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#if (BUTTON_LOG_SIZE > 0)
+
+static uint8_t log_buf[BUTTON_LOG_SIZE];
+static uint16_t log_head = 0;
+static uint16_t log_tail = 0;
+static uint16_t log_used = 0;
+static uint32_t log_base_units = 0;
+static uint32_t log_last_tick = 0;
+static uint32_t log_pending_units = 0;
+static uint8_t log_started = 0;
+
+/**
+ * @fn     advance_to
+ * @brief  Add the time units from the last tick seen to now to the pending delta.
+ *
+ * Seeing the tick at every scan keeps each step below one wrap, so the units
+ * masked to the tick width are exact; the sum saturates instead of aliasing.
+ */
+
+static void advance_to(uint32_t now)
+{
+    uint32_t units = ((now >> BUTTON_LOG_TICK_SHIFT) - (log_last_tick >> BUTTON_LOG_TICK_SHIFT)) & LOG_UNIT_MASK;
+    log_pending_units = (log_pending_units > (UINT32_MAX - units)) ? UINT32_MAX : (log_pending_units + units);
+    log_last_tick = now;
+}
+
+/**
+ * @fn     evict_oldest
+ * @brief  Drop the oldest record, folding its delta into the base time.
+ */
+
+static void evict_oldest(void)
+{
+    uint8_t byte = log_buf[log_tail];
+    uint32_t delta = byte & 0x01;
+    uint8_t shift = 1;
+    log_tail = (uint16_t)((log_tail + 1) % BUTTON_LOG_SIZE);
+    log_used--;
+    while (byte & 0x80)
+    {
+        byte = log_buf[log_tail];
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        shift = (uint8_t)(shift + 7);
+        log_tail = (uint16_t)((log_tail + 1) % BUTTON_LOG_SIZE);
+        log_used--;
+    }
+    log_base_units += delta;
+}
+
+/**
+ * @fn     button_log_record
+ * @brief  Append one event to the log, dropping the oldest records if needed.
+ *
+ * Called by the driver for every event it emits.
+ *
+ * @param  type       Event type (0..7).
+ * @param  button_id  Button that produced the event (0..7).
+ * @param  tick       Tick at emission.
+ */
+
+void button_log_record(button_pressed_types_t type, button_enum button_id, uint32_t tick)
+{
+    uint8_t record[BUTTON_LOG_RECORD_MAX];
+    uint8_t len = 1;
+    uint8_t i = 0;
+    uint32_t delta = 0;
+    if (log_started)
+    {
+        advance_to(tick);
+        delta = log_pending_units;
+    }
+    record[0] = (uint8_t)((((uint8_t)type & 0x07) << 4) | (((uint8_t)button_id & 0x07) << 1) | (delta & 0x01));
+    delta >>= 1;
+    if (0 != delta)
+    {
+        record[0] |= 0x80;
+        while (delta >= 0x80)
+        {
+            record[len++] = (uint8_t)(delta | 0x80);
+            delta >>= 7;
+        }
+        record[len++] = (uint8_t)delta;
+    }
+    while ((BUTTON_LOG_SIZE - log_used) < len)
+    {
+        evict_oldest();
+    }
+    for (i=0; i<len; i++)
+    {
+        log_buf[log_head] = record[i];
+        log_head = (uint16_t)((log_head + 1) % BUTTON_LOG_SIZE);
+    }
+    log_used = (uint16_t)(log_used + len);
+    log_last_tick = tick;
+    log_pending_units = 0;
+    log_started = 1;
+}
+
+/**
+ * @fn     button_log_advance
+ * @brief  Let the log see the current tick, so it counts wraps between events.
+ *
+ * Called by the driver at every scan of the built-in instance.
+ *
+ * @param  now  Current tick.
+ */
+
+void button_log_advance(uint32_t now)
+{
+    if (log_started)
+    {
+        advance_to(now);
+    }
+}
+
+/**
+ * @fn     button_log_clear
+ * @brief  Drop every record.
+ */
+
+void button_log_clear(void)
+{
+    log_head = 0;
+    log_tail = 0;
+    log_used = 0;
+    log_base_units = 0;
+    log_pending_units = 0;
+    log_started = 0;
+}
+
+/**
+ * @fn     button_log_used
+ * @brief  Number of record bytes currently held.
+ */
+
+uint16_t button_log_used(void)
+{
+    return log_used;
+}
+
+/**
+ * @fn     button_log_snapshot
+ * @brief  Serialize the log, oldest record first, for transfer to a host.
+ *
+ * @param  p_out    Output buffer.
+ * @param  max_len  Capacity of p_out; BUTTON_LOG_HEADER_SIZE + BUTTON_LOG_SIZE always fits.
+ * @return Snapshot length in bytes, or 0 if p_out is NULL or too small.
+ */
+
+uint16_t button_log_snapshot(uint8_t * p_out, uint16_t max_len)
+{
+    uint16_t len = 0;
+    uint16_t i = 0;
+    if ((NULL != p_out) && (max_len >= (uint32_t)BUTTON_LOG_HEADER_SIZE + log_used))
+    {
+        put_u32(&p_out[0], BUTTON_LOG_MAGIC);
+        p_out[4] = BUTTON_LOG_VERSION;
+        p_out[5] = BUTTON_LOG_TICK_SHIFT;
+        p_out[6] = (uint8_t)log_used;
+        p_out[7] = (uint8_t)(log_used >> 8);
+        put_u32(&p_out[8], log_base_units);
+        for (i=0; i<log_used; i++)
+        {
+            p_out[BUTTON_LOG_HEADER_SIZE + i] = log_buf[(log_tail + i) % BUTTON_LOG_SIZE];
+        }
+        len = (uint16_t)(BUTTON_LOG_HEADER_SIZE + log_used);
+    }
+    return len;
+}
+
+#else
+
+void button_log_record(button_pressed_types_t type, button_enum button_id, uint32_t tick)
+{
+    (void)type;
+    (void)button_id;
+    (void)tick;
+}
+
+void button_log_advance(uint32_t now)
+{
+    (void)now;
+}
+
+void button_log_clear(void)
+{
+}
+
+uint16_t button_log_used(void)
+{
+    return 0;
+}
+
+uint16_t button_log_snapshot(uint8_t * p_out, uint16_t max_len)
+{
+    (void)p_out;
+    (void)max_len;
+    (void)put_u32;
+    return 0;
+}
+
+#endif
+
+/**
+ * @fn     button_log_decode
+ * @brief  Walk the records of a snapshot, oldest first.
+ *
+ * Time is reported in log units (2^tick_shift ticks, as stored in the snapshot)
+ * relative to an arbitrary origin; differences between records are exact to one unit.
+ *
+ * @param  p_snapshot  Snapshot produced by button_log_snapshot().
+ * @param  len         Snapshot length.
+ * @param  fp_record   Invoked for each record; may be NULL to only validate.
+ * @return Number of records, or -1 if the snapshot is malformed.
+ */
+
+int32_t button_log_decode(const uint8_t * p_snapshot, uint32_t len,
+                          void (* fp_record)(button_pressed_types_t type, button_enum button_id, uint32_t time_units))
+{
+    int32_t count = -1;
+    if ((NULL != p_snapshot) && (len >= BUTTON_LOG_HEADER_SIZE)
+        && (BUTTON_LOG_MAGIC == get_u32(p_snapshot)) && (BUTTON_LOG_VERSION == p_snapshot[4])
+        && (len >= (uint32_t)BUTTON_LOG_HEADER_SIZE + (uint32_t)(p_snapshot[6] | (p_snapshot[7] << 8))))
+    {
+        uint32_t end = BUTTON_LOG_HEADER_SIZE + (uint32_t)(p_snapshot[6] | (p_snapshot[7] << 8));
+        uint32_t time = get_u32(&p_snapshot[8]);
+        uint32_t pos = BUTTON_LOG_HEADER_SIZE;
+        count = 0;
+        while ((pos < end) && (count >= 0))
+        {
+            uint8_t head = p_snapshot[pos++];
+            uint8_t byte = head;
+            uint32_t delta = head & 0x01;
+            uint8_t shift = 1;
+            while ((byte & 0x80) && (count >= 0))
+            {
+                if ((pos >= end) || (shift > 29))
+                {
+                    count = -1;
+                }
+                else
+                {
+                    byte = p_snapshot[pos++];
+                    delta |= (uint32_t)(byte & 0x7F) << shift;
+                    shift = (uint8_t)(shift + 7);
+                }
+            }
+            if (count >= 0)
+            {
+                time += delta;
+                count++;
+                if (NULL != fp_record)
+                {
+                    fp_record((button_pressed_types_t)((head >> 4) & 0x07), (button_enum)((head >> 1) & 0x07), time);
+                }
+            }
+        }
+    }
+    return count;
+}
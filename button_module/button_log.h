@@ -0,0 +1,71 @@
+#ifndef BUTTON_LOG_H
+#define BUTTON_LOG_H
+
+#include <stdint.h>
+#include "button.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Always-on event log in a circular byte buffer of BUTTON_LOG_SIZE bytes
+ * (0 disables it; the ESP-IDF component enables 512 bytes). Time is kept in
+ * units of 2^BUTTON_LOG_TICK_SHIFT ticks.
+ * Record layout:
+ *
+ *   byte 0   bit 7     more bytes follow
+ *            bits 6-4  event type
+ *            bits 3-1  button id
+ *            bit 0     delta bit 0
+ *   byte 1.. LEB128 of (delta >> 1)
+ *
+ * where delta is the number of time units since the previous record. Events less
+ * than 2 units apart take 1 byte, up to 256 units 2 bytes, up to 32768 units 3 bytes.
+ *
+ * Tick wraps are counted the way the history ring counts them: the driver
+ * reports the tick at every scan (button_log_advance), so the time since the
+ * previous record is accumulated across any number of wraps as long as scans
+ * are less than one wrap apart. Deltas saturate at 2^32 - 1 units (over 80 days
+ * at 40 ticks/us with the default shift).
+ * When the buffer is full the oldest whole records are dropped. There is one log
+ * per program, without locking: the driver records the events of its built-in
+ * instance only (see button_instance_t).
+ *
+ * Snapshot layout (little endian), decoded by button_log_decode():
+ *
+ *   0..3  magic "BLOG"     4  version (1)     5  tick shift
+ *   6..7  record bytes     8..11  time of the record before the first one, in units
+ *   12..  records, oldest first
+ */
+
+#ifndef BUTTON_LOG_SIZE
+#define BUTTON_LOG_SIZE         (0)
+#endif
+
+#ifndef BUTTON_LOG_TICK_SHIFT
+#define BUTTON_LOG_TICK_SHIFT   (16)
+#endif
+
+#define BUTTON_LOG_MAGIC        (0x474F4C42UL)
+#define BUTTON_LOG_VERSION      (1)
+#define BUTTON_LOG_HEADER_SIZE  (12)
+#define BUTTON_LOG_RECORD_MAX   (6)
+
+#if (BUTTON_LOG_SIZE > 0) && ((BUTTON_LOG_SIZE < BUTTON_LOG_RECORD_MAX) || (BUTTON_LOG_SIZE > 65535))
+#error "BUTTON_LOG_SIZE must be 6..65535 bytes"
+#endif
+
+extern void button_log_record(button_pressed_types_t type, button_enum button_id, uint32_t tick);
+extern void button_log_advance(uint32_t now);
+extern void button_log_clear(void);
+extern uint16_t button_log_used(void);
+extern uint16_t button_log_snapshot(uint8_t * p_out, uint16_t max_len);
+extern int32_t button_log_decode(const uint8_t * p_snapshot, uint32_t len,
+                                 void (* fp_record)(button_pressed_types_t type, button_enum button_id, uint32_t time_units));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUTTON_LOG_H
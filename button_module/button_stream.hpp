@@ -0,0 +1,305 @@
+/**************************************************
+ * @file    button_stream.hpp                     *
+ * @brief   Composable operators over the button  *
+ *          event stream                          *
+ *                                                *
+ * Description:                                   *
+ * Header-only, allocation-free pipelines for     *
+ * post-processing driver events:                 *
+ *                                                *
+ *   static auto pipeline =                       *
+ *         stream::filter(is_button_1)            *
+ *       | stream::throttle(USEC_TO_TICK(200000)) *
+ *       | stream::map(to_action)                 *
+ *       | stream::sink(run_action);              *
+ *                                                *
+ * Every stage is a value type stored inside the  *
+ * pipeline object and stages hand values to the  *
+ * next one through lambdas, so the compiler      *
+ * fuses the whole chain into one inlined call    *
+ * per event: no queues, no virtual dispatch.     *
+ *                                                *
+ **************************************************/
+
+#ifndef BUTTON_STREAM_HPP
+#define BUTTON_STREAM_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "button.h"
+
+namespace button
+{
+namespace stream
+{
+
+struct event
+{
+    button_pressed_types_t type;
+    button_enum id;
+    uint32_t tick;
+};
+
+template <typename T, size_t N>
+struct batch
+{
+    T items[N];
+    size_t count;
+};
+
+/** Base of every stage; only stage types take part in operator|. */
+struct stage_tag
+{
+};
+
+template <typename T>
+inline constexpr bool is_stage_v = std::is_base_of_v<stage_tag, std::remove_cvref_t<T>>;
+
+/* ---------------------------------------------------------------- stages */
+
+template <typename Pred>
+struct filter_stage : stage_tag
+{
+    Pred pred;
+
+    template <typename T, typename Next>
+    void on(const T & value, Next && next)
+    {
+        if (pred(value))
+        {
+            next(value);
+        }
+    }
+};
+
+template <typename Fn>
+struct map_stage : stage_tag
+{
+    Fn fn;
+
+    template <typename T, typename Next>
+    void on(const T & value, Next && next)
+    {
+        next(fn(value));
+    }
+};
+
+/** Passes at most one event per window, across all buttons. */
+struct throttle_stage : stage_tag
+{
+    uint32_t window_ticks;
+    uint32_t last_tick = 0;
+    bool armed = false;
+
+    template <typename Next>
+    void on(const event & value, Next && next)
+    {
+        if ((!armed) || ((uint32_t)(value.tick - last_tick) >= window_ticks))
+        {
+            armed = true;
+            last_tick = value.tick;
+            next(value);
+        }
+    }
+};
+
+/** Drops an event when the same button reported the same type within the window. */
+struct debounce_by_type_stage : stage_tag
+{
+    uint32_t window_ticks;
+    uint32_t last_tick[BUTTON_MAX][BUTTON_PRESS_TYPE_MAX] = {};
+    bool seen[BUTTON_MAX][BUTTON_PRESS_TYPE_MAX] = {};
+
+    template <typename Next>
+    void on(const event & value, Next && next)
+    {
+        if ((value.id < BUTTON_MAX) && (value.type < BUTTON_PRESS_TYPE_MAX))
+        {
+            bool pass = (!seen[value.id][value.type])
+                        || ((uint32_t)(value.tick - last_tick[value.id][value.type]) >= window_ticks);
+            seen[value.id][value.type] = true;
+            last_tick[value.id][value.type] = value.tick;
+            if (pass)
+            {
+                next(value);
+            }
+        }
+    }
+};
+
+/**
+ * Collects up to N values and emits them as one batch<T, N> when full, or,
+ * with a non-zero window, once the oldest value is window_ticks old (checked on
+ * every new value and from poll()).
+ */
+template <typename T, size_t N>
+struct buffer_stage : stage_tag
+{
+    uint32_t window_ticks;
+    uint32_t first_tick = 0;
+    batch<T, N> pending = {};
+
+    template <typename Next>
+    void on(const T & value, Next && next)
+    {
+        if (0 == pending.count)
+        {
+            first_tick = value.tick;
+        }
+        pending.items[pending.count++] = value;
+        if ((N == pending.count)
+            || ((0 != window_ticks) && ((uint32_t)(value.tick - first_tick) >= window_ticks)))
+        {
+            flush(next);
+        }
+    }
+
+    template <typename Next>
+    void poll(uint32_t now, Next && next)
+    {
+        if ((0 != pending.count) && (0 != window_ticks) && ((uint32_t)(now - first_tick) >= window_ticks))
+        {
+            flush(next);
+        }
+    }
+
+    template <typename Next>
+    void flush(Next && next)
+    {
+        next(static_cast<const batch<T, N> &>(pending));
+        pending.count = 0;
+    }
+};
+
+template <typename Fn>
+struct sink_stage : stage_tag
+{
+    Fn fn;
+
+    template <typename T, typename Next>
+    void on(const T & value, Next &&)
+    {
+        fn(value);
+    }
+};
+
+/* ------------------------------------------------------------- factories */
+
+template <typename Pred>
+constexpr filter_stage<Pred> filter(Pred pred)
+{
+    return {{}, pred};
+}
+
+template <typename Fn>
+constexpr map_stage<Fn> map(Fn fn)
+{
+    return {{}, fn};
+}
+
+constexpr throttle_stage throttle(uint32_t window_ticks)
+{
+    return {{}, window_ticks};
+}
+
+constexpr debounce_by_type_stage debounce_by_type(uint32_t window_ticks)
+{
+    return {{}, window_ticks};
+}
+
+template <size_t N, typename T = event>
+constexpr buffer_stage<T, N> buffer(uint32_t window_ticks = 0)
+{
+    static_assert(N > 0, "buffer size must be positive");
+    return {{}, window_ticks};
+}
+
+template <typename Fn>
+constexpr sink_stage<Fn> sink(Fn fn)
+{
+    return {{}, fn};
+}
+
+/* -------------------------------------------------------------- pipeline */
+
+template <typename... Stages>
+class pipeline
+{
+public:
+    constexpr explicit pipeline(Stages... stages) : stages_(std::move(stages)...)
+    {
+    }
+
+    /** Push one driver event through every stage. */
+    void push(const event & value)
+    {
+        run<0>(value);
+    }
+
+    void operator()(button_pressed_types_t type, button_enum id, uint32_t tick)
+    {
+        push(event{type, id, tick});
+    }
+
+    /** Let time-based stages (buffer with a window) emit; call after button_process(). */
+    void poll(uint32_t now)
+    {
+        poll_from<0>(now);
+    }
+
+    template <typename Stage>
+    constexpr auto append(Stage stage) &&
+    {
+        return std::apply([&](Stages &... current)
+                          { return pipeline<Stages..., Stage>(std::move(current)..., std::move(stage)); },
+                          stages_);
+    }
+
+private:
+    template <size_t I, typename T>
+    void run(const T & value)
+    {
+        if constexpr (I < sizeof...(Stages))
+        {
+            std::get<I>(stages_).on(value, [this](const auto & out) { run<I + 1>(out); });
+        }
+    }
+
+    template <size_t I>
+    void poll_from(uint32_t now)
+    {
+        if constexpr (I < sizeof...(Stages))
+        {
+            auto & stage = std::get<I>(stages_);
+            if constexpr (requires { stage.poll(now, [](const auto &) {}); })
+            {
+                stage.poll(now, [this](const auto & out) { run<I + 1>(out); });
+            }
+            poll_from<I + 1>(now);
+        }
+    }
+
+    std::tuple<Stages...> stages_;
+};
+
+template <typename A, typename B>
+    requires(is_stage_v<A> && is_stage_v<B>)
+constexpr auto operator|(A a, B b)
+{
+    return pipeline<A, B>(std::move(a), std::move(b));
+}
+
+template <typename... Stages, typename B>
+    requires(is_stage_v<B>)
+constexpr auto operator|(pipeline<Stages...> p, B b)
+{
+    return std::move(p).append(std::move(b));
+}
+
+} // namespace stream
+} // namespace button
+
+#endif // BUTTON_STREAM_HPP
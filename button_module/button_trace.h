@@ -0,0 +1,89 @@
+#ifndef BUTTON_TRACE_H
+#define BUTTON_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Static tracepoints on the driver hot paths. BUTTON_TRACE_BACKEND selects what
+ * they become:
+ *
+ *   BUTTON_TRACE_BACKEND_NONE  nothing; arguments are not evaluated (default)
+ *   BUTTON_TRACE_BACKEND_USDT  sys/sdt.h probes in provider "button", for perf,
+ *                              bpftrace or systemtap on a Linux host build
+ *   BUTTON_TRACE_BACKEND_HOOK  calls to button_trace_hook(), supplied by the
+ *                              application; it also runs from button_isr(), so
+ *                              it must be short and ISR-safe
+ *
+ * Every point carries a button index (or the pin for isr_entry) and two values:
+ *
+ *   isr_entry       pin, interrupt mode, 0
+ *   edge            button, BUTTON_TRACE_EDGE_PRESS / _RELEASE, stored edge tick
+ *   decision        button, BUTTON_TRACE_DECISION_*, press count
+ *   emit            button, event type, 0
+ *   callback_begin  button, event type, 0
+ *   callback_end    button, event type, 0
+ *
+ * Since the NONE backend does not evaluate the arguments, they must not have side
+ * effects; compute values first and pass the variables.
+ */
+
+#define BUTTON_TRACE_BACKEND_NONE   (0)
+#define BUTTON_TRACE_BACKEND_USDT   (1)
+#define BUTTON_TRACE_BACKEND_HOOK   (2)
+
+#ifndef BUTTON_TRACE_BACKEND
+#define BUTTON_TRACE_BACKEND        BUTTON_TRACE_BACKEND_NONE
+#endif
+
+typedef enum
+{
+    BUTTON_TRACE_POINT_ISR_ENTRY,
+    BUTTON_TRACE_POINT_EDGE,
+    BUTTON_TRACE_POINT_DECISION,
+    BUTTON_TRACE_POINT_EMIT,
+    BUTTON_TRACE_POINT_CALLBACK_BEGIN,
+    BUTTON_TRACE_POINT_CALLBACK_END,
+} button_trace_point_t;
+
+#define BUTTON_TRACE_EDGE_PRESS         (0)
+#define BUTTON_TRACE_EDGE_RELEASE       (1)
+
+#define BUTTON_TRACE_DECISION_LONG      (0)     // press held past the long press time
+#define BUTTON_TRACE_DECISION_COUNTED   (1)     // short press counted, multi-press window open
+#define BUTTON_TRACE_DECISION_SETTLED   (2)     // multi-press window closed with the given count
+#define BUTTON_TRACE_DECISION_GLITCH    (3)     // press shorter than press_debounce_us, dropped
+
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_USDT)
+
+#include <sys/sdt.h>
+#define BUTTON_TRACE_PROBE(name, point, id, a, b)   DTRACE_PROBE3(button, name, id, a, b)
+
+#elif (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+
+extern void button_trace_hook(button_trace_point_t point, uint8_t id, uint32_t a, uint32_t b);
+#define BUTTON_TRACE_PROBE(name, point, id, a, b)   button_trace_hook(point, (uint8_t)(id), (uint32_t)(a), (uint32_t)(b))
+
+#elif (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_NONE)
+
+#define BUTTON_TRACE_PROBE(name, point, id, a, b)   do { } while (0)
+
+#else
+#error "Unknown BUTTON_TRACE_BACKEND"
+#endif
+
+#define BUTTON_TRACE_ISR_ENTRY(pin, mode)           BUTTON_TRACE_PROBE(isr_entry, BUTTON_TRACE_POINT_ISR_ENTRY, pin, mode, 0)
+#define BUTTON_TRACE_EDGE(id, kind, tick)           BUTTON_TRACE_PROBE(edge, BUTTON_TRACE_POINT_EDGE, id, kind, tick)
+#define BUTTON_TRACE_DECISION(id, kind, count)      BUTTON_TRACE_PROBE(decision, BUTTON_TRACE_POINT_DECISION, id, kind, count)
+#define BUTTON_TRACE_EMIT(id, type)                 BUTTON_TRACE_PROBE(emit, BUTTON_TRACE_POINT_EMIT, id, type, 0)
+#define BUTTON_TRACE_CALLBACK_BEGIN(id, type)       BUTTON_TRACE_PROBE(callback_begin, BUTTON_TRACE_POINT_CALLBACK_BEGIN, id, type, 0)
+#define BUTTON_TRACE_CALLBACK_END(id, type)         BUTTON_TRACE_PROBE(callback_end, BUTTON_TRACE_POINT_CALLBACK_END, id, type, 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUTTON_TRACE_H
@@ -0,0 +1,213 @@
+/**************************************************
+ * @file    aggregator_sim.c                      *
+ * @brief   Simulated drifting nodes for the      *
+ *          multi-node aggregator                 *
+ *                                                *
+ * Description:                                   *
+ * Runs several virtual remote nodes, each with a *
+ * random tick epoch and a clock skew of up to    *
+ * +/-max_ppm, over a link with random latency.   *
+ * Frames go through button_link encode/decode    *
+ * into button_aggregator; the merged output is   *
+ * checked for time order and compared against    *
+ * the true event times. Node 0 reboots halfway   *
+ * through (new tick epoch, sequence from 0),     *
+ * which the aggregator must detect; each node's  *
+ * first WARM_UP_US after start or reboot is left *
+ * out of the error figures.                      *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module aggregator_sim.c  *
+ *       ../button_module/button_aggregator.c     *
+ *       ../button_module/button_link.c           *
+ *       -lm -o aggregator_sim                    *
+ * Usage: ./aggregator_sim [nodes] [seconds]      *
+ *                        [max_ppm]               *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "button_aggregator.h"
+
+#define MAX_SIM_NODES       (BUTTON_AGGREGATOR_MAX_NODES)
+#define FLUSH_PERIOD_US     (50000U)
+#define BASE_LATENCY_US     (300U)
+#define JITTER_US           (3000U)
+#define HOLD_US             (100000U)
+#define SIM_STEP_US         (100U)
+#define MAX_IN_FLIGHT       (4096)
+#define WARM_UP_US          (10000000U)
+
+typedef struct
+{
+    uint32_t epoch;
+    double skew;
+    uint64_t warm_us;                   // errors are counted from this time on
+    button_link_tx_t tx;
+} sim_node_t;
+
+typedef struct
+{
+    uint64_t arrival_us;
+    uint16_t len;
+    uint8_t bytes[BUTTON_LINK_MAX_FRAME];
+} in_flight_t;
+
+static sim_node_t nodes[MAX_SIM_NODES];
+static in_flight_t in_flight[MAX_IN_FLIGHT];
+static uint32_t in_flight_count = 0;
+static button_link_rx_t receiver;
+static button_aggregator_t aggregator;
+static uint64_t sim_time_us = 0;
+static uint32_t rng = 12345;
+static uint16_t sending_node = 0;
+static uint64_t merged = 0;
+static uint64_t unordered = 0;
+static uint64_t warm_events = 0;
+static double error_sum = 0;
+static double error_max = 0;
+static uint32_t last_tick = 0;
+static uint8_t have_last = 0;
+
+static uint32_t next_random(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t node_tick(const sim_node_t * p_node, uint64_t t_us)
+{
+    return p_node->epoch + (uint32_t)(uint64_t)llround((double)t_us * (1.0 + p_node->skew));
+}
+
+static int32_t sim_write(const uint8_t * p_data, uint16_t len)
+{
+    if (in_flight_count < MAX_IN_FLIGHT)
+    {
+        in_flight_t * p = &in_flight[in_flight_count++];
+        p->arrival_us = sim_time_us + BASE_LATENCY_US + (next_random() % JITTER_US);
+        p->len = len;
+        memcpy(p->bytes, p_data, len);
+    }
+    (void)sending_node;
+    return len;
+}
+
+static void on_frame(const button_link_frame_t * p_frame)
+{
+    button_aggregator_frame(&aggregator, p_frame, (uint32_t)sim_time_us);
+}
+
+static void on_event(const button_aggregator_event_t * p_event)
+{
+    const sim_node_t * p_node = &nodes[p_event->node_id];
+    uint32_t age_ticks = node_tick(p_node, sim_time_us) - p_event->node_tick;
+    double true_us = (double)sim_time_us - (double)age_ticks / (1.0 + p_node->skew);
+    double error = fabs((double)(int32_t)(p_event->tick - (uint32_t)llround(true_us)) - BASE_LATENCY_US);
+
+    if (have_last && ((int32_t)(p_event->tick - last_tick) < 0))
+    {
+        unordered++;
+    }
+    last_tick = p_event->tick;
+    have_last = 1;
+    merged++;
+    if (sim_time_us > p_node->warm_us)
+    {
+        warm_events++;
+        error_sum += error;
+        if (error > error_max)
+        {
+            error_max = error;
+        }
+    }
+}
+
+static void deliver_due(void)
+{
+    uint32_t i = 0;
+    while (i < in_flight_count)
+    {
+        if (in_flight[i].arrival_us <= sim_time_us)
+        {
+            button_link_rx_feed(&receiver, in_flight[i].bytes, in_flight[i].len);
+            in_flight[i] = in_flight[--in_flight_count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t node_count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 8;
+    uint32_t seconds = (argc > 2) ? (uint32_t)atoi(argv[2]) : 120;
+    double max_ppm = (argc > 3) ? atof(argv[3]) : 200.0;
+    uint64_t sent = 0;
+    uint32_t n = 0;
+
+    if ((0 == node_count) || (node_count > MAX_SIM_NODES))
+    {
+        fprintf(stderr, "nodes must be 1..%d\n", MAX_SIM_NODES);
+        return 1;
+    }
+    button_link_rx_init(&receiver, on_frame);
+    button_aggregator_init(&aggregator, 1000000U, HOLD_US, on_event);
+    for (n=0; n<node_count; n++)
+    {
+        nodes[n].epoch = next_random();
+        nodes[n].skew = ((double)(next_random() % 20001U) / 10000.0 - 1.0) * max_ppm * 1e-6;
+        nodes[n].warm_us = WARM_UP_US;
+        button_link_tx_init(&nodes[n].tx, (uint16_t)n, sim_write);
+    }
+
+    for (sim_time_us=0; sim_time_us<(uint64_t)seconds*1000000U; sim_time_us+=SIM_STEP_US)
+    {
+        if ((uint64_t)seconds * 500000U == sim_time_us)
+        {
+            nodes[0].epoch = next_random();
+            nodes[0].warm_us = sim_time_us + WARM_UP_US;
+            button_link_tx_init(&nodes[0].tx, 0, sim_write);
+        }
+        for (n=0; n<node_count; n++)
+        {
+            if (0 == (next_random() % 2000U))
+            {
+                button_link_tx_push(&nodes[n].tx, (button_pressed_types_t)(next_random() % 3U), (button_enum)(next_random() % BUTTON_MAX),
+                                    node_tick(&nodes[n], sim_time_us));
+                sent++;
+            }
+            if (0 == ((sim_time_us + n * 7000U) % FLUSH_PERIOD_US))
+            {
+                sending_node = (uint16_t)n;
+                button_link_tx_flush(&nodes[n].tx, node_tick(&nodes[n], sim_time_us));
+            }
+        }
+        deliver_due();
+        button_aggregator_poll(&aggregator, (uint32_t)sim_time_us);
+    }
+
+    printf("nodes %u, %u s simulated, skew up to +/-%.0f ppm\n", node_count, seconds, max_ppm);
+    for (n=0; n<node_count; n++)
+    {
+        int64_t offset = 0;
+        int32_t skew_ppb = 0;
+        button_aggregator_get_clock(&aggregator, (uint16_t)n, &offset, &skew_ppb);
+        printf("  node %2u: true skew %+8.2f ppm, estimated %+8.2f ppm\n", n, -nodes[n].skew / (1.0 + nodes[n].skew) * 1e6,
+               (double)skew_ppb / 1000.0);
+    }
+    printf("node restarts detected: %u of 1\n", aggregator.node_restarts);
+    printf("events: %llu sent, %llu merged, %u late, %llu out of order\n",
+           (unsigned long long)sent, (unsigned long long)merged, aggregator.late_events, (unsigned long long)unordered);
+    printf("alignment error after warm-up: mean %.1f us, max %.1f us\n",
+           (warm_events > 0) ? error_sum / (double)warm_events : 0.0, error_max);
+    return ((0 == unordered) && (error_max < (double)JITTER_US) && (1 == aggregator.node_restarts)) ? 0 : 1;
+}
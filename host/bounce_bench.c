@@ -0,0 +1,356 @@
+/**************************************************
+ * @file    bounce_bench.c                        *
+ * @brief   Driver accuracy and cost on modelled  *
+ *          contact bounce                        *
+ *                                                *
+ * Description:                                   *
+ * Feeds taps, double taps and long presses from  *
+ * every switch model of button_bounce.h through  *
+ * the real driver, on a virtual 1 MHz tick with  *
+ * a 1 ms scan, in each way a pin can be wired:   *
+ *   NONE          polled                         *
+ *   NONE+interp   polled, poll_interpolation     *
+ *   FALLING_EDGE  press edges by interrupt,      *
+ *                 release by polling             *
+ *   BOTH_EDGES    every edge by interrupt        *
+ * Interrupts fire on every level change the      *
+ * model produces, bounce and glitches included.  *
+ *                                                *
+ * Per model and mode it reports how many         *
+ * gestures produced exactly their event, how     *
+ * many produced none or something else, the time *
+ * from the settled release to the event, and     *
+ * the cycles spent per button_process() and      *
+ * button_isr() call (rdtsc, nanoseconds on other *
+ * hosts, timer overhead included). The seed      *
+ * fixes every sequence, so runs can be compared  *
+ * across driver changes. An optional press       *
+ * debounce (pin_config_t press_debounce_us)      *
+ * shows how many glitches a minimum press width  *
+ * rejects.                                       *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module bounce_bench.c    *
+ *       button_bounce.c                          *
+ *       ../button_module/button.c -o bounce      *
+ * Usage: ./bounce [gestures] [seed]              *
+ *                 [press_debounce_us]            *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "button.h"
+#include "button_bounce.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DEBOUNCE_US         (10000U)
+#define LONG_PRESS_US       (1000000U)
+#define SCAN_PERIOD_US      (1000U)
+#define MAX_EDGES           (4096)
+#define MAX_GESTURE_EVENTS  (8)
+
+typedef enum
+{
+    WIRING_POLLED,
+    WIRING_POLLED_INTERP,
+    WIRING_FALLING_EDGE,
+    WIRING_BOTH_EDGES,
+    WIRING_MAX
+} wiring_t;
+
+typedef struct
+{
+    uint64_t gestures;
+    uint64_t ok;
+    uint64_t missed;
+    uint64_t wrong;
+    uint64_t edges;
+    uint64_t latency_total_us;
+    uint64_t latency_max_us;
+    uint64_t scans;
+    uint64_t scan_cycles;
+    uint64_t isr_calls;
+    uint64_t isr_cycles;
+} bench_result_t;
+
+static button_api_t api;
+static uint64_t now_us = 0;
+static uint8_t level = 0;
+static button_pressed_types_t events[MAX_GESTURE_EVENTS];
+static uint64_t event_at[MAX_GESTURE_EVENTS];
+static uint32_t event_count = 0;
+static button_bounce_edge_t edges[MAX_EDGES];
+static uint64_t rng_state = 0;
+static uint32_t press_debounce_us = 0;
+
+static const char * const wiring_names[WIRING_MAX] = {"NONE", "NONE+interp", "FALLING_EDGE", "BOTH_EDGES"};
+
+/**
+ * @fn     cycles_now
+ * @brief  Serialized time stamp counter on x86, nanoseconds elsewhere.
+ */
+
+static inline uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t t = 0;
+    _mm_lfence();
+    t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator for gesture timing.
+ */
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @fn     uniform
+ * @brief  Uniform value in [lo, hi].
+ */
+
+static uint64_t uniform(uint64_t lo, uint64_t hi)
+{
+    return lo + (rng_next() >> 11) % (hi - lo + 1);
+}
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    return (uint32_t)now_us;
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    (void)p_pin;
+    return level ? 0 : 1;
+}
+
+static void event_callback(button_pressed_types_t type, button_enum button_id)
+{
+    (void)button_id;
+    if (event_count < MAX_GESTURE_EVENTS)
+    {
+        events[event_count] = type;
+        event_at[event_count] = now_us;
+    }
+    event_count++;
+}
+
+/**
+ * @fn     wants_isr
+ * @brief  Whether the wiring raises an interrupt for a change to new_level.
+ */
+
+static int wants_isr(wiring_t wiring, uint8_t new_level)
+{
+    return (WIRING_BOTH_EDGES == wiring) || ((WIRING_FALLING_EDGE == wiring) && new_level);
+}
+
+/**
+ * @fn     scan
+ * @brief  One timed button_process() call.
+ */
+
+static void scan(bench_result_t * p_result)
+{
+    uint64_t start = cycles_now();
+    button_process();
+    p_result->scan_cycles += cycles_now() - start;
+    p_result->scans++;
+}
+
+/**
+ * @fn     run_until
+ * @brief  Apply edges[0..count) and scan every SCAN_PERIOD_US until end_us.
+ *
+ * Edges land between scans; those the wiring reports by interrupt call
+ * button_isr() at their own time. Scanning continues past end_us until the
+ * last edge has been seen by a scan.
+ */
+
+static void run_until(wiring_t wiring, uint32_t count, uint64_t end_us, uint64_t * p_next_scan, bench_result_t * p_result)
+{
+    uint32_t next = 0;
+    while ((next < count) || (*p_next_scan < end_us))
+    {
+        while ((next < count) && (edges[next].at_us < *p_next_scan))
+        {
+            now_us = edges[next].at_us;
+            if (edges[next].pressed != level)
+            {
+                level = edges[next].pressed;
+                if (wants_isr(wiring, level))
+                {
+                    uint64_t start = cycles_now();
+                    button_isr(&api.button_pins[0]);
+                    p_result->isr_cycles += cycles_now() - start;
+                    p_result->isr_calls++;
+                }
+            }
+            next++;
+        }
+        now_us = *p_next_scan;
+        scan(p_result);
+        *p_next_scan += SCAN_PERIOD_US;
+    }
+    p_result->edges += count;
+}
+
+/**
+ * @fn     run_gesture
+ * @brief  Play one gesture and the quiet time after it, then score its events.
+ *
+ * A double tap is two presses; the quiet time after the gesture outlasts the
+ * multi-press window, so every gesture has exactly one correct event.
+ */
+
+static void run_gesture(button_bounce_t * p_gen, wiring_t wiring, uint64_t * p_next_scan, bench_result_t * p_result)
+{
+    uint64_t pick = uniform(0, 9);
+    button_pressed_types_t expected = (pick < 6) ? BUTTON_NORMAL_PRESS : ((pick < 8) ? BUTTON_DOUBLE_PRESS : BUTTON_LONG_PRESS);
+    uint64_t at = *p_next_scan + uniform(0, SCAN_PERIOD_US - 1);
+    uint64_t released = 0;
+    uint32_t count = 0;
+    uint32_t taps = (BUTTON_DOUBLE_PRESS == expected) ? 2 : 1;
+    uint32_t i = 0;
+    event_count = 0;
+    for (i=0; i<taps; i++)
+    {
+        uint32_t hold = (uint32_t)((BUTTON_LONG_PRESS == expected) ? uniform(1300000U, 3000000U) : uniform(60000U, 200000U));
+        count = button_bounce_press(p_gen, at, hold, edges, MAX_EDGES);
+        released = edges[count - 1].at_us;
+        run_until(wiring, count, released + 1, p_next_scan, p_result);
+        at = released + uniform(80000U, 140000U);
+    }
+    count = button_bounce_idle(p_gen, released + 1, released + BUTTON_MULTI_PRESS_US + 700000U, edges, MAX_EDGES);
+    run_until(wiring, count, released + BUTTON_MULTI_PRESS_US + 700000U, p_next_scan, p_result);
+    p_result->gestures++;
+    if ((1 == event_count) && (expected == events[0]))
+    {
+        /* A bounce tail may outlast the event; count that as no latency. */
+        uint64_t latency = (event_at[0] > released) ? (event_at[0] - released) : 0;
+        p_result->ok++;
+        p_result->latency_total_us += latency;
+        p_result->latency_max_us = (latency > p_result->latency_max_us) ? latency : p_result->latency_max_us;
+    }
+    else if (0 == event_count)
+    {
+        p_result->missed++;
+    }
+    else
+    {
+        p_result->wrong++;
+    }
+}
+
+/**
+ * @fn     run_bench
+ * @brief  All gestures of one model through one wiring, from a fresh driver.
+ */
+
+static int run_bench(button_bounce_model_t model, wiring_t wiring, uint32_t gestures, uint64_t seed, bench_result_t * p_result)
+{
+    button_bounce_t gen;
+    uint64_t next_scan = SCAN_PERIOD_US;
+    uint32_t g = 0;
+    memset(p_result, 0, sizeof(*p_result));
+    memset(&api, 0, sizeof(api));
+    api.button_pins[0].pin = 10;
+    api.button_pins[0].interrupt_mode = (WIRING_FALLING_EDGE == wiring) ? BUTTON_INTERRUPT_MODE_FALLING_EDGE
+                                      : ((WIRING_BOTH_EDGES == wiring) ? BUTTON_INTERRUPT_MODE_BOTH_EDGES : BUTTON_INTERRUPT_MODE_NONE);
+    api.button_pins[0].press_debounce_us = press_debounce_us;
+    api.size_of_buttons = 1;
+    api.tick_count_in_1us = 1;
+    api.debounce_us = DEBOUNCE_US;
+    api.long_press_us = LONG_PRESS_US;
+    api.poll_interpolation = (WIRING_POLLED_INTERP == wiring);
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_event_callback = event_callback;
+    now_us = 0;
+    level = 0;
+    rng_state = 0x9E3779B97F4A7C15ULL + seed * 0xD1B54A32D192ED03ULL;
+    rng_state = (0 != rng_state) ? rng_state : 1;
+    if ((0 != button_bounce_init(&gen, model, seed)) || (0 != button_initialize(&api)))
+    {
+        return -1;
+    }
+    for (g=0; g<gestures; g++)
+    {
+        run_gesture(&gen, wiring, &next_scan, p_result);
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t gestures = 2000;
+    uint64_t seed = 1;
+    bench_result_t result;
+    uint32_t model = 0;
+    uint32_t wiring = 0;
+    if (argc > 1)
+    {
+        gestures = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        seed = strtoull(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        press_debounce_us = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+    printf("%u gestures per run, seed %llu, debounce %u ms, press debounce %u us, scan %u us\n",
+           gestures, (unsigned long long)seed, DEBOUNCE_US / 1000U, press_debounce_us, SCAN_PERIOD_US);
+    printf("%-9s %-13s %8s %8s %8s %11s %21s %11s %11s\n",
+           "model", "wiring", "ok", "missed", "wrong", "edges/gest", "release->event ms", "cyc/scan", "cyc/isr");
+    for (model=0; model<BUTTON_BOUNCE_MODEL_MAX; model++)
+    {
+        for (wiring=0; wiring<WIRING_MAX; wiring++)
+        {
+            if (0 != run_bench((button_bounce_model_t)model, (wiring_t)wiring, gestures, seed, &result))
+            {
+                fprintf(stderr, "driver rejected the bench configuration\n");
+                return 1;
+            }
+            printf("%-9s %-13s %8llu %8llu %8llu %11.1f %10.1f / %8.1f %11.1f %11.1f\n",
+                   button_bounce_model_name((button_bounce_model_t)model), wiring_names[wiring],
+                   (unsigned long long)result.ok, (unsigned long long)result.missed, (unsigned long long)result.wrong,
+                   (double)result.edges / result.gestures,
+                   (0 != result.ok) ? (double)result.latency_total_us / result.ok / 1000.0 : 0.0,
+                   (double)result.latency_max_us / 1000.0,
+                   (0 != result.scans) ? (double)result.scan_cycles / result.scans : 0.0,
+                   (0 != result.isr_calls) ? (double)result.isr_cycles / result.isr_calls : 0.0);
+        }
+    }
+    return 0;
+}
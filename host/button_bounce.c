@@ -0,0 +1,251 @@
+/**************************************************
+ * @file    button_bounce.c                       *
+ * @brief   Contact bounce waveform generator     *
+ *                                                *
+ * Description:                                   *
+ * Generates the edge sequences of real switches  *
+ * (tactile, membrane, reed, worn, EMI) from a    *
+ * seeded xorshift64* generator, so simulations   *
+ * and benchmarks can feed the driver realistic   *
+ * input reproducibly instead of square waves.    *
+ *                                                *
+ * The presets are typical figures for each kind  *
+ * of contact, not measurements of one part;      *
+ * adjust p_gen->params to match a datasheet or   *
+ * a scope capture.                               *
+ *                                                *
+ * Build (Linux), with a simulator:               *
+ *   gcc -O2 -I../button_module sim.c             *
+ *       button_bounce.c ...                      *
+ *                                                *
+ **************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "button_bounce.h"
+
+typedef struct
+{
+    button_bounce_edge_t * p_edges;
+    uint32_t capacity;
+    uint32_t count;
+    uint8_t overflow;
+} edge_sink_t;
+
+static const char * const model_names[BUTTON_BOUNCE_MODEL_MAX] =
+{
+    "tactile", "membrane", "reed", "worn", "emi"
+};
+
+static const button_bounce_params_t presets[BUTTON_BOUNCE_MODEL_MAX] =
+{
+    /* press         release        pulse       dropouts         spikes */
+    {  300,  3000,    500,  5000,   20,  400,   0,    0,    0,   0,  0,  0 },  // tactile
+    { 1000,  8000,    200,  1500,   50, 1000,   0,    0,    0,   0,  0,  0 },  // membrane
+    {   50,   400,     20,   200,    5,   40,   0,    0,    0,   0,  0,  0 },  // reed
+    { 2000, 15000,   5000, 25000,   50, 2000,   3,  100, 3000,   0,  0,  0 },  // worn
+    {  300,  3000,    500,  5000,   20,  400,   0,    0,    0,  20,  1, 20 },  // emi
+};
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator.
+ */
+
+static uint64_t rng_next(button_bounce_t * p_gen)
+{
+    p_gen->rng ^= p_gen->rng >> 12;
+    p_gen->rng ^= p_gen->rng << 25;
+    p_gen->rng ^= p_gen->rng >> 27;
+    return p_gen->rng * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @fn     uniform
+ * @brief  Uniform value in [lo, hi]; lo when hi < lo.
+ */
+
+static uint64_t uniform(button_bounce_t * p_gen, uint64_t lo, uint64_t hi)
+{
+    return (hi > lo) ? (lo + (rng_next(p_gen) >> 11) % (hi - lo + 1)) : lo;
+}
+
+/**
+ * @fn     push
+ * @brief  Append an edge, or mark the sink as overflowed when it is full.
+ */
+
+static void push(edge_sink_t * p_sink, uint64_t at_us, uint8_t pressed)
+{
+    if (p_sink->count < p_sink->capacity)
+    {
+        p_sink->p_edges[p_sink->count].at_us = at_us;
+        p_sink->p_edges[p_sink->count].pressed = pressed;
+        p_sink->count++;
+    }
+    else
+    {
+        p_sink->overflow = 1;
+    }
+}
+
+/**
+ * @fn     burst
+ * @brief  Move to a new level with bounce: toggle until duration_us has passed.
+ *
+ * The first edge is at at_us and the last one is on the new level.
+ *
+ * @return Time of the settled level.
+ */
+
+static uint64_t burst(button_bounce_t * p_gen, edge_sink_t * p_sink, uint64_t at_us, uint8_t pressed, uint64_t duration_us)
+{
+    const button_bounce_params_t * p_params = &p_gen->params;
+    uint64_t end = at_us + duration_us;
+    uint64_t t = at_us;
+    uint8_t level = pressed;
+    push(p_sink, t, level);
+    for (;;)
+    {
+        uint64_t gap = uniform(p_gen, (0 != p_params->pulse_min_us) ? p_params->pulse_min_us : 1, p_params->pulse_max_us);
+        if (t + gap >= end)
+        {
+            break;
+        }
+        t += gap;
+        level = !level;
+        push(p_sink, t, level);
+    }
+    if (level != pressed)
+    {
+        t = end;
+        push(p_sink, t, pressed);
+    }
+    return t;
+}
+
+/**
+ * @fn     glitches
+ * @brief  Short excursions from a stable level between from_us and to_us.
+ *
+ * Dropouts (pressed only) and spikes arrive independently; the gap to the next
+ * one is uniform with the mean of their combined rate, and each excursion ends
+ * before to_us.
+ */
+
+static void glitches(button_bounce_t * p_gen, edge_sink_t * p_sink, uint64_t from_us, uint64_t to_us, uint8_t pressed)
+{
+    const button_bounce_params_t * p_params = &p_gen->params;
+    uint32_t dropouts = pressed ? p_params->dropouts_per_s : 0;
+    uint32_t rate = dropouts + p_params->spikes_per_s;
+    uint64_t t = from_us;
+    while (0 != rate)
+    {
+        uint64_t width = 0;
+        t += uniform(p_gen, 1, 2000000ULL / rate);
+        if (uniform(p_gen, 0, rate - 1) < dropouts)
+        {
+            width = uniform(p_gen, p_params->dropout_min_us, p_params->dropout_max_us);
+        }
+        else
+        {
+            width = uniform(p_gen, p_params->spike_min_us, p_params->spike_max_us);
+        }
+        width = (0 != width) ? width : 1;
+        if (t + width >= to_us)
+        {
+            break;
+        }
+        push(p_sink, t, !pressed);
+        t += width;
+        push(p_sink, t, pressed);
+    }
+}
+
+/**
+ * @fn     button_bounce_init
+ * @brief  Load the preset of a switch model and seed the generator.
+ *
+ * @param  p_gen  Generator to initialise.
+ * @param  model  Switch model whose statistics are loaded into p_gen->params.
+ * @param  seed   Any value; equal seeds give equal sequences.
+ * @return 0 on success, -1 for a NULL generator or an unknown model.
+ */
+
+int button_bounce_init(button_bounce_t * p_gen, button_bounce_model_t model, uint64_t seed)
+{
+    int ret = -1;
+    if ((NULL != p_gen) && ((uint32_t)model < BUTTON_BOUNCE_MODEL_MAX))
+    {
+        p_gen->params = presets[model];
+        p_gen->rng = 0x9E3779B97F4A7C15ULL + seed * 0xD1B54A32D192ED03ULL;
+        p_gen->rng = (0 != p_gen->rng) ? p_gen->rng : 1;
+        ret = 0;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_bounce_model_name
+ * @brief  Short lower-case name of a model, "?" for unknown values.
+ */
+
+const char * button_bounce_model_name(button_bounce_model_t model)
+{
+    return ((uint32_t)model < BUTTON_BOUNCE_MODEL_MAX) ? model_names[model] : "?";
+}
+
+/**
+ * @fn     button_bounce_press
+ * @brief  Edge sequence of one press.
+ *
+ * The contacts meet at at_us and part hold_us later (or right after the press
+ * bounce, if that is longer). Edges are in time order, start with a press and
+ * end with the settled release.
+ *
+ * @param  p_gen     Generator.
+ * @param  at_us     Time the contacts meet.
+ * @param  hold_us   Time from meeting to parting.
+ * @param  p_edges   Receives the edges.
+ * @param  capacity  Size of p_edges.
+ * @return Number of edges written, or 0 if they did not fit.
+ */
+
+uint32_t button_bounce_press(button_bounce_t * p_gen, uint64_t at_us, uint32_t hold_us,
+                             button_bounce_edge_t * p_edges, uint32_t capacity)
+{
+    edge_sink_t sink = {p_edges, capacity, 0, 0};
+    uint32_t ret = 0;
+    if ((NULL != p_gen) && (NULL != p_edges))
+    {
+        const button_bounce_params_t * p_params = &p_gen->params;
+        uint64_t settled = burst(p_gen, &sink, at_us,
+                                 1, uniform(p_gen, p_params->press_bounce_min_us, p_params->press_bounce_max_us));
+        uint64_t release = at_us + hold_us;
+        release = (release > settled) ? release : (settled + 1);
+        glitches(p_gen, &sink, settled, release, 1);
+        burst(p_gen, &sink, release, 0, uniform(p_gen, p_params->release_bounce_min_us, p_params->release_bounce_max_us));
+        ret = sink.overflow ? 0 : sink.count;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_bounce_idle
+ * @brief  EMI spikes on a released button between from_us and to_us.
+ *
+ * @return Number of edges written (pairs, possibly none), or 0 if they did not fit.
+ */
+
+uint32_t button_bounce_idle(button_bounce_t * p_gen, uint64_t from_us, uint64_t to_us,
+                            button_bounce_edge_t * p_edges, uint32_t capacity)
+{
+    edge_sink_t sink = {p_edges, capacity, 0, 0};
+    uint32_t ret = 0;
+    if ((NULL != p_gen) && (NULL != p_edges))
+    {
+        glitches(p_gen, &sink, from_us, to_us, 0);
+        ret = sink.overflow ? 0 : sink.count;
+    }
+    return ret;
+}
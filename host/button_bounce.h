@@ -0,0 +1,71 @@
+#ifndef BUTTON_BOUNCE_H
+#define BUTTON_BOUNCE_H
+
+#include <stdint.h>
+
+/*
+ * Contact bounce waveforms for host simulation and benchmarks.
+ *
+ * A generator turns a press ("contact closes at at_us, opens hold_us later")
+ * into the edge sequence a GPIO input would actually see:
+ *
+ *   press bounce     level toggles for press_bounce_us after the contacts meet
+ *   held             dropouts (contact opens briefly) and EMI spikes
+ *   release bounce   level toggles for release_bounce_us after they part
+ *
+ * and button_bounce_idle() adds EMI spikes while the button is released.
+ * Every burst ends on the settled level, so the last edge of a press is the
+ * settled release. Levels are logical (1 = pressed); map them to the pin
+ * polarity in the simulator.
+ *
+ * Each model preset (button_bounce_init) describes one kind of switch; the
+ * statistics stay in p_gen->params and can be changed after init. With the
+ * same seed a generator produces the same sequence on every run.
+ */
+
+typedef enum
+{
+    BUTTON_BOUNCE_TACTILE = 0,  // metal dome tact switch
+    BUTTON_BOUNCE_MEMBRANE,     // carbon pill on a membrane, slow chatter on make
+    BUTTON_BOUNCE_REED,         // reed relay, short resonant ringing
+    BUTTON_BOUNCE_WORN,         // oxidised contacts: long bursts, dropouts while held
+    BUTTON_BOUNCE_EMI,          // tactile switch on a noisy line
+    BUTTON_BOUNCE_MODEL_MAX
+} button_bounce_model_t;
+
+typedef struct
+{
+    uint32_t press_bounce_min_us;       // length of the burst after the contacts meet
+    uint32_t press_bounce_max_us;
+    uint32_t release_bounce_min_us;     // length of the burst after the contacts part
+    uint32_t release_bounce_max_us;
+    uint32_t pulse_min_us;              // time between two toggles inside a burst
+    uint32_t pulse_max_us;
+    uint32_t dropouts_per_s;            // mean rate of brief openings while held, 0 = none
+    uint32_t dropout_min_us;
+    uint32_t dropout_max_us;
+    uint32_t spikes_per_s;              // mean rate of EMI glitches on either level, 0 = none
+    uint32_t spike_min_us;
+    uint32_t spike_max_us;
+} button_bounce_params_t;
+
+typedef struct
+{
+    uint64_t at_us;
+    uint8_t pressed;
+} button_bounce_edge_t;
+
+typedef struct
+{
+    button_bounce_params_t params;
+    uint64_t rng;
+} button_bounce_t;
+
+extern int button_bounce_init(button_bounce_t * p_gen, button_bounce_model_t model, uint64_t seed);
+extern const char * button_bounce_model_name(button_bounce_model_t model);
+extern uint32_t button_bounce_press(button_bounce_t * p_gen, uint64_t at_us, uint32_t hold_us,
+                                    button_bounce_edge_t * p_edges, uint32_t capacity);
+extern uint32_t button_bounce_idle(button_bounce_t * p_gen, uint64_t from_us, uint64_t to_us,
+                                   button_bounce_edge_t * p_edges, uint32_t capacity);
+
+#endif // BUTTON_BOUNCE_H
@@ -0,0 +1,342 @@
+/**************************************************
+ * @file    button_chrome_trace.c                 *
+ * @brief   Chrome / Perfetto trace export of     *
+ *          driver activity                       *
+ *                                                *
+ * Description:                                   *
+ * Implements button_trace_hook() for the hook    *
+ * trace backend. Records are appended to a fixed *
+ * buffer with one atomic add, so the hook is     *
+ * safe from the ISR thread and button_process()  *
+ * at once; button_chrome_trace_write() turns     *
+ * them into trace-event JSON afterwards, keeping *
+ * file I/O off the traced paths.                 *
+ *                                                *
+ * Build (Linux), with the driver:                *
+ *   gcc -DBUTTON_TRACE_BACKEND=2                 *
+ *       -I../button_module app.c                 *
+ *       button_chrome_trace.c                    *
+ *       ../button_module/button.c ...            *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "button_chrome_trace.h"
+
+typedef struct
+{
+    uint32_t now;
+    uint32_t a;
+    uint32_t b;
+    uint8_t point;
+    uint8_t id;
+} trace_record_t;
+
+typedef struct
+{
+    uint64_t press;
+    uint64_t window;
+    uint64_t callback;
+    uint8_t held;
+} button_timeline_t;
+
+static const button_api_t * p_trace_api = NULL;
+static trace_record_t records[BUTTON_CHROME_TRACE_CAPACITY];
+static uint32_t record_count = 0;
+static uint32_t dropped_count = 0;
+static uint64_t trace_origin = 0;
+
+static const char * const type_names[] = {"NORMAL", "LONG", "DOUBLE", "HOLD1", "HOLD2", "HOLD3", "HOLD4"};
+
+/**
+ * @fn     type_name
+ * @brief  Printable name of an event type, "?" for unknown values.
+ */
+
+static const char * type_name(uint32_t type)
+{
+    return (type < (sizeof(type_names) / sizeof(type_names[0]))) ? type_names[type] : "?";
+}
+
+/**
+ * @fn     button_trace_hook
+ * @brief  Tracepoint sink called by the driver (BUTTON_TRACE_BACKEND_HOOK).
+ *
+ * Claims a slot with an atomic add and fills it; records beyond the capacity are
+ * counted as dropped. Does nothing until button_chrome_trace_init() was called.
+ */
+
+void button_trace_hook(button_trace_point_t point, uint8_t id, uint32_t a, uint32_t b)
+{
+    const button_api_t * p_api = __atomic_load_n(&p_trace_api, __ATOMIC_ACQUIRE);
+    if (NULL != p_api)
+    {
+        uint32_t slot = __atomic_fetch_add(&record_count, 1, __ATOMIC_RELAXED);
+        if (slot < BUTTON_CHROME_TRACE_CAPACITY)
+        {
+            records[slot].now = p_api->fp_get_current_tick();
+            records[slot].a = a;
+            records[slot].b = b;
+            records[slot].point = (uint8_t)point;
+            records[slot].id = id;
+        }
+        else
+        {
+            __atomic_fetch_add(&dropped_count, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @fn     button_chrome_trace_init
+ * @brief  Start recording tracepoints against a driver configuration.
+ *
+ * @param  p_api  The configuration passed to button_initialize(); its tick source
+ *                stamps the records and its tick rate and per-button debounce
+ *                times are used when writing the trace.
+ * @return 0 on success; -1 if p_api or its tick functions are missing.
+ */
+
+int button_chrome_trace_init(const button_api_t * p_api)
+{
+    int ret = -1;
+    if ((NULL != p_api) && (NULL != p_api->fp_get_current_tick) && (0 != p_api->tick_count_in_1us))
+    {
+        __atomic_store_n(&p_trace_api, NULL, __ATOMIC_RELEASE);
+        record_count = 0;
+        dropped_count = 0;
+        __atomic_store_n(&p_trace_api, p_api, __ATOMIC_RELEASE);
+        ret = 0;
+    }
+    return ret;
+}
+
+/**
+ * @fn     extend_tick
+ * @brief  Place a 32-bit tick on the 64-bit timeline next to a known reference.
+ *
+ * @param  tick      Tick to extend (recorded "now" or a tick stored by the driver).
+ * @param  ref_tick  32-bit reference tick.
+ * @param  ref_ext   The reference tick on the 64-bit timeline.
+ * @return The extended tick; ticks within 2^31 before or after the reference keep
+ *         their ordering across 32-bit wraps.
+ */
+
+static uint64_t extend_tick(uint32_t tick, uint32_t ref_tick, uint64_t ref_ext)
+{
+    return ref_ext + (int64_t)(int32_t)(tick - ref_tick);
+}
+
+/**
+ * @fn     to_us
+ * @brief  Convert an extended tick to trace microseconds relative to the first record.
+ */
+
+static double to_us(uint64_t tick, double tick_per_us)
+{
+    return (double)(int64_t)(tick - trace_origin) / tick_per_us;
+}
+
+/**
+ * @fn     write_slice
+ * @brief  Emit one complete ("X") event; zero-length slices are skipped.
+ */
+
+static void write_slice(FILE * p_file, const char * p_name, uint8_t tid, uint64_t start, uint64_t end, double tick_per_us)
+{
+    if (end > start)
+    {
+        fprintf(p_file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}",
+                tid, p_name, to_us(start, tick_per_us), (end - start) / tick_per_us);
+    }
+}
+
+/**
+ * @fn     write_instant
+ * @brief  Emit one thread-scoped instant ("i") event with a single argument.
+ */
+
+static void write_instant(FILE * p_file, const char * p_name, uint8_t tid, uint64_t at, const char * p_arg, uint32_t value, double tick_per_us)
+{
+    fprintf(p_file, ",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"args\":{\"%s\":%u}}",
+            tid, p_name, to_us(at, tick_per_us), p_arg, value);
+}
+
+/**
+ * @fn     button_chrome_trace_write
+ * @brief  Write everything recorded so far as Chrome trace-event JSON.
+ *
+ * Recording continues afterwards; records added while writing may be left out.
+ * Timestamps are microseconds from the first record. Buttons appear as threads
+ * 1..BUTTON_MAX ("button 0" ...), ISR entries on thread 0.
+ *
+ * @param  p_path  Output file.
+ * @return Number of records written; -1 if not initialized or the file cannot be created.
+ */
+
+int button_chrome_trace_write(const char * p_path)
+{
+    const button_api_t * p_api = __atomic_load_n(&p_trace_api, __ATOMIC_ACQUIRE);
+    FILE * p_file = NULL;
+    button_timeline_t timeline[BUTTON_MAX];
+    uint32_t count = __atomic_load_n(&record_count, __ATOMIC_ACQUIRE);
+    uint32_t i = 0;
+    uint64_t now_ext = 0;
+    double tick_per_us = 0;
+    uint64_t debounce[BUTTON_MAX];
+    if ((NULL == p_api) || (NULL == (p_file = fopen(p_path, "w"))))
+    {
+        return -1;
+    }
+    count = (count < BUTTON_CHROME_TRACE_CAPACITY) ? count : BUTTON_CHROME_TRACE_CAPACITY;
+    tick_per_us = (double)p_api->tick_count_in_1us;
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        const pin_config_t * p_pin = &p_api->button_pins[i];
+        uint32_t us = (0 != p_pin->release_debounce_us) ? p_pin->release_debounce_us : p_api->debounce_us;
+        debounce[i] = p_pin->hw_filtered ? 0 : (uint64_t)us * p_api->tick_count_in_1us;
+    }
+    memset(timeline, 0, sizeof(timeline));
+    /* The first record sits at 2^32 so edges stored before it stay positive. */
+    now_ext = 1ULL << 32;
+    trace_origin = now_ext;
+    fprintf(p_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(p_file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"button driver\"}}");
+    fprintf(p_file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"isr\"}}");
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        fprintf(p_file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"button %u\"}}", i + 1, i);
+    }
+    for (i=0; i<count; i++)
+    {
+        const trace_record_t * p_rec = &records[i];
+        button_timeline_t * p_line = (p_rec->id < BUTTON_MAX) ? &timeline[p_rec->id] : NULL;
+        uint8_t tid = (uint8_t)(p_rec->id + 1);
+        uint64_t at = 0;
+        char name[32];
+        if (i > 0)
+        {
+            now_ext = extend_tick(p_rec->now, records[i - 1].now, now_ext);
+        }
+        at = now_ext;
+        switch (p_rec->point)
+        {
+            case BUTTON_TRACE_POINT_ISR_ENTRY:
+                write_instant(p_file, "isr", 0, at, "pin", p_rec->id, tick_per_us);
+                break;
+            case BUTTON_TRACE_POINT_EDGE:
+                if (NULL != p_line)
+                {
+                    uint64_t edge = extend_tick(p_rec->b, p_rec->now, now_ext);
+                    write_instant(p_file, (BUTTON_TRACE_EDGE_PRESS == p_rec->a) ? "press edge" : "release edge",
+                                  tid, edge, "traced_late_us", (uint32_t)((now_ext - edge) / tick_per_us), tick_per_us);
+                    if (BUTTON_TRACE_EDGE_PRESS == p_rec->a)
+                    {
+                        p_line->press = edge;
+                        p_line->held = 1;
+                    }
+                    else if (p_line->held)
+                    {
+                        write_slice(p_file, "held", tid, p_line->press, edge, tick_per_us);
+                        if (0 != debounce[p_rec->id])
+                        {
+                            write_slice(p_file, "debounce", tid, edge, edge + debounce[p_rec->id], tick_per_us);
+                        }
+                        p_line->held = 0;
+                    }
+                }
+                break;
+            case BUTTON_TRACE_POINT_DECISION:
+                if (NULL != p_line)
+                {
+                    if (BUTTON_TRACE_DECISION_COUNTED == p_rec->a)
+                    {
+                        write_instant(p_file, "counted", tid, at, "count", p_rec->b, tick_per_us);
+                        if (1 == p_rec->b)
+                        {
+                            p_line->window = at;
+                        }
+                    }
+                    else if (BUTTON_TRACE_DECISION_SETTLED == p_rec->a)
+                    {
+                        write_instant(p_file, "settled", tid, at, "count", p_rec->b, tick_per_us);
+                        if (0 != p_line->window)
+                        {
+                            write_slice(p_file, "multi-press", tid, p_line->window, at, tick_per_us);
+                            p_line->window = 0;
+                        }
+                    }
+                    else if (BUTTON_TRACE_DECISION_GLITCH == p_rec->a)
+                    {
+                        write_instant(p_file, "glitch", tid, at, "count", p_rec->b, tick_per_us);
+                    }
+                    else
+                    {
+                        write_instant(p_file, "long", tid, at, "count", p_rec->b, tick_per_us);
+                    }
+                }
+                break;
+            case BUTTON_TRACE_POINT_EMIT:
+                write_instant(p_file, "emit", tid, at, "type", p_rec->a, tick_per_us);
+                break;
+            case BUTTON_TRACE_POINT_CALLBACK_BEGIN:
+                if (NULL != p_line)
+                {
+                    p_line->callback = at;
+                }
+                break;
+            case BUTTON_TRACE_POINT_CALLBACK_END:
+                if ((NULL != p_line) && (0 != p_line->callback))
+                {
+                    snprintf(name, sizeof(name), "callback %s", type_name(p_rec->a));
+                    write_slice(p_file, name, tid, p_line->callback, at, tick_per_us);
+                    if (0 != p_line->press)
+                    {
+                        snprintf(name, sizeof(name), "latency %s", type_name(p_rec->a));
+                        write_slice(p_file, name, tid, p_line->press, at, tick_per_us);
+                        p_line->press = 0;
+                    }
+                    p_line->callback = 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    fprintf(p_file, "\n]}\n");
+    fclose(p_file);
+    return (int)count;
+}
+
+/**
+ * @fn     button_chrome_trace_count
+ * @brief  Number of records held (at most BUTTON_CHROME_TRACE_CAPACITY).
+ */
+
+uint32_t button_chrome_trace_count(void)
+{
+    uint32_t count = __atomic_load_n(&record_count, __ATOMIC_RELAXED);
+    return (count < BUTTON_CHROME_TRACE_CAPACITY) ? count : BUTTON_CHROME_TRACE_CAPACITY;
+}
+
+/**
+ * @fn     button_chrome_trace_dropped
+ * @brief  Number of records lost because the buffer was full.
+ */
+
+uint32_t button_chrome_trace_dropped(void)
+{
+    return __atomic_load_n(&dropped_count, __ATOMIC_RELAXED);
+}
+
+/**
+ * @fn     button_chrome_trace_close
+ * @brief  Stop recording; the recorded data is discarded at the next init.
+ */
+
+void button_chrome_trace_close(void)
+{
+    __atomic_store_n(&p_trace_api, NULL, __ATOMIC_RELEASE);
+}
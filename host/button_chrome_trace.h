@@ -0,0 +1,36 @@
+#ifndef BUTTON_CHROME_TRACE_H
+#define BUTTON_CHROME_TRACE_H
+
+#include <stdint.h>
+#include "button.h"
+#include "button_trace.h"
+
+/*
+ * Records the driver's tracepoints (button_trace.h, built with
+ * BUTTON_TRACE_BACKEND=BUTTON_TRACE_BACKEND_HOOK) and writes them as Chrome
+ * trace-event JSON, which chrome://tracing and ui.perfetto.dev both load.
+ *
+ * Every record is stamped with the driver's own fp_get_current_tick(), so edge
+ * timestamps stored by the driver and the moments the driver acted on them share
+ * one timeline. Per button the trace shows:
+ *
+ *   held               press edge .. release edge
+ *   debounce           release edge .. release edge + debounce_us
+ *   multi-press        first counted press .. window settled
+ *   callback <type>    fp_event_callback duration
+ *   latency <type>     press edge .. end of the callback
+ *
+ * plus instant markers for every edge, decision and ISR entry.
+ */
+
+#ifndef BUTTON_CHROME_TRACE_CAPACITY
+#define BUTTON_CHROME_TRACE_CAPACITY    (65536)
+#endif
+
+extern int button_chrome_trace_init(const button_api_t * p_api);
+extern int button_chrome_trace_write(const char * p_path);
+extern uint32_t button_chrome_trace_count(void);
+extern uint32_t button_chrome_trace_dropped(void);
+extern void button_chrome_trace_close(void);
+
+#endif // BUTTON_CHROME_TRACE_H
@@ -0,0 +1,247 @@
+/**************************************************
+ * @file    button_publish.c                      *
+ * @brief   Batched event broadcast over local    *
+ *          sockets                               *
+ *                                                *
+ * Description:                                   *
+ * Publishes button events as fixed-layout binary *
+ * datagrams over a Unix-domain or loopback UDP   *
+ * socket, so dashboards and test rigs can        *
+ * subscribe without linking the driver. Events   *
+ * are batched per flush interval. The socket is  *
+ * non-blocking: when a subscriber is slow or     *
+ * absent the batch is dropped and counted, so    *
+ * button_process() is never held up.             *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "button_publish.h"
+
+/**
+ * @fn     put_u16
+ * @brief  Store a little endian 16-bit value into the datagram buffer.
+ */
+
+static void put_u16(uint8_t * p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @fn     put_u32
+ * @brief  Store a little endian 32-bit value into the datagram buffer.
+ */
+
+static void put_u32(uint8_t * p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @fn     open_socket
+ * @brief  Create the non-blocking datagram socket and remember the destination.
+ *
+ * @param  p_pub        Publisher state.
+ * @param  domain       AF_INET or AF_UNIX.
+ * @param  p_addr       Destination address.
+ * @param  addr_len     Size of the destination address.
+ * @param  flush_ticks  Batch interval in ticks.
+ * @return 0 on success; -1 on failure, with p_pub->fd left at -1.
+ */
+
+static int open_socket(button_publish_t * p_pub, int domain, const void * p_addr, uint32_t addr_len, uint32_t flush_ticks)
+{
+    int ret = -1;
+    memset(p_pub, 0, sizeof(*p_pub));
+    p_pub->fd = -1;
+    if (addr_len <= sizeof(p_pub->addr))
+    {
+        p_pub->fd = socket(domain, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    }
+    if (p_pub->fd >= 0)
+    {
+        memcpy(&p_pub->addr, p_addr, addr_len);
+        p_pub->addr_len = addr_len;
+        p_pub->flush_ticks = flush_ticks;
+        ret = 0;
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_publish_open_udp
+ * @brief  Publish to a UDP address, normally 127.0.0.1.
+ *
+ * @param  p_pub        Publisher state.
+ * @param  p_ipv4       Destination IPv4 address in dotted notation.
+ * @param  port         Destination port.
+ * @param  flush_ticks  Batch interval in ticks; 0 sends every event on its own.
+ * @return 0 on success; -1 on failure, with p_pub->fd set to -1.
+ */
+
+int button_publish_open_udp(button_publish_t * p_pub, const char * p_ipv4, uint16_t port, uint32_t flush_ticks)
+{
+    int ret = -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (NULL != p_pub)
+    {
+        p_pub->fd = -1;
+    }
+    if ((NULL != p_pub) && (NULL != p_ipv4) && (1 == inet_pton(AF_INET, p_ipv4, &addr.sin_addr)))
+    {
+        ret = open_socket(p_pub, AF_INET, &addr, sizeof(addr), flush_ticks);
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_publish_open_unix
+ * @brief  Publish to a Unix-domain datagram socket bound by the subscriber.
+ *
+ * @param  p_pub        Publisher state.
+ * @param  p_path       Filesystem path of the subscriber socket.
+ * @param  flush_ticks  Batch interval in ticks; 0 sends every event on its own.
+ * @return 0 on success; -1 on failure, with p_pub->fd set to -1.
+ */
+
+int button_publish_open_unix(button_publish_t * p_pub, const char * p_path, uint32_t flush_ticks)
+{
+    int ret = -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (NULL != p_pub)
+    {
+        p_pub->fd = -1;
+    }
+    if ((NULL != p_pub) && (NULL != p_path) && (strlen(p_path) < sizeof(addr.sun_path)))
+    {
+        strcpy(addr.sun_path, p_path);
+        ret = open_socket(p_pub, AF_UNIX, &addr, sizeof(addr), flush_ticks);
+    }
+    return ret;
+}
+
+/**
+ * @fn     button_publish_flush
+ * @brief  Send the pending batch now.
+ *
+ * The send never blocks. If the socket buffer is full or nobody is listening the
+ * batch is discarded and counted in dropped_batches/dropped_events.
+ *
+ * @param  p_pub  Publisher state.
+ * @param  now    Current tick, stored in the datagram header.
+ */
+
+void button_publish_flush(button_publish_t * p_pub, uint32_t now)
+{
+    if ((NULL != p_pub) && (p_pub->fd >= 0) && (p_pub->count > 0))
+    {
+        size_t len = BUTTON_PUBLISH_HEADER_SIZE + (size_t)p_pub->count * BUTTON_PUBLISH_EVENT_SIZE;
+        put_u32(&p_pub->datagram[0], BUTTON_PUBLISH_MAGIC);
+        put_u16(&p_pub->datagram[4], BUTTON_PUBLISH_VERSION);
+        put_u16(&p_pub->datagram[6], p_pub->count);
+        put_u32(&p_pub->datagram[8], p_pub->seq);
+        put_u32(&p_pub->datagram[12], now);
+        if (sendto(p_pub->fd, p_pub->datagram, len, MSG_DONTWAIT | MSG_NOSIGNAL,
+                   (const struct sockaddr *)&p_pub->addr, p_pub->addr_len) == (ssize_t)len)
+        {
+            p_pub->sent_batches++;
+        }
+        else
+        {
+            p_pub->dropped_batches++;
+            p_pub->dropped_events += p_pub->count;
+        }
+        p_pub->seq++;
+        p_pub->count = 0;
+    }
+}
+
+/**
+ * @fn     button_publish_event
+ * @brief  Append one event to the pending batch.
+ *
+ * Call from fp_event_callback. The batch is sent when it is full, or when
+ * flush_ticks is 0; otherwise `button_publish_poll()` sends it once the flush
+ * interval has passed.
+ *
+ * @param  p_pub      Publisher state.
+ * @param  type       Event type.
+ * @param  button_id  Button that produced the event.
+ * @param  tick       Tick at emission.
+ */
+
+void button_publish_event(button_publish_t * p_pub, button_pressed_types_t type, button_enum button_id, uint32_t tick)
+{
+    if ((NULL != p_pub) && (p_pub->fd >= 0))
+    {
+        uint8_t * p = &p_pub->datagram[BUTTON_PUBLISH_HEADER_SIZE + p_pub->count * BUTTON_PUBLISH_EVENT_SIZE];
+        if (0 == p_pub->count)
+        {
+            p_pub->batch_tick = tick;
+        }
+        put_u32(&p[0], tick);
+        p[4] = (uint8_t)button_id;
+        p[5] = (uint8_t)type;
+        put_u16(&p[6], 0);
+        p_pub->count++;
+        if ((BUTTON_PUBLISH_MAX_EVENTS == p_pub->count) || (0 == p_pub->flush_ticks))
+        {
+            button_publish_flush(p_pub, tick);
+        }
+    }
+}
+
+/**
+ * @fn     button_publish_poll
+ * @brief  Send the pending batch once its flush interval has passed.
+ *
+ * Call periodically, e.g. right after button_process().
+ *
+ * @param  p_pub  Publisher state.
+ * @param  now    Current tick.
+ */
+
+void button_publish_poll(button_publish_t * p_pub, uint32_t now)
+{
+    if ((NULL != p_pub) && (p_pub->fd >= 0) && (p_pub->count > 0) && ((uint32_t)(now - p_pub->batch_tick) >= p_pub->flush_ticks))
+    {
+        button_publish_flush(p_pub, now);
+    }
+}
+
+/**
+ * @fn     button_publish_close
+ * @brief  Drop any pending batch and close the socket.
+ *
+ * @param  p_pub  Publisher state.
+ */
+
+void button_publish_close(button_publish_t * p_pub)
+{
+    if ((NULL != p_pub) && (p_pub->fd >= 0))
+    {
+        close(p_pub->fd);
+        p_pub->fd = -1;
+        p_pub->count = 0;
+    }
+}
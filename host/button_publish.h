@@ -0,0 +1,51 @@
+#ifndef BUTTON_PUBLISH_H
+#define BUTTON_PUBLISH_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include "button.h"
+
+/*
+ * Datagram layout (little endian), one datagram per flushed batch:
+ *
+ *   header, 16 bytes                      event, 8 bytes each
+ *   0..3   magic "BTNE"                   0..3  tick at emission
+ *   4..5   layout version (1)             4     button id
+ *   6..7   number of events               5     button_pressed_types_t
+ *   8..11  batch sequence number          6..7  reserved (0)
+ *   12..15 tick at flush
+ */
+
+#ifndef BUTTON_PUBLISH_MAX_EVENTS
+#define BUTTON_PUBLISH_MAX_EVENTS   (64)
+#endif
+
+#define BUTTON_PUBLISH_MAGIC        (0x454E5442UL)
+#define BUTTON_PUBLISH_VERSION      (1)
+#define BUTTON_PUBLISH_HEADER_SIZE  (16)
+#define BUTTON_PUBLISH_EVENT_SIZE   (8)
+#define BUTTON_PUBLISH_MAX_DATAGRAM (BUTTON_PUBLISH_HEADER_SIZE + BUTTON_PUBLISH_MAX_EVENTS * BUTTON_PUBLISH_EVENT_SIZE)
+
+typedef struct
+{
+    int fd;                             // -1 while closed or after a failed open
+    struct sockaddr_storage addr;
+    uint32_t addr_len;
+    uint32_t flush_ticks;
+    uint32_t batch_tick;
+    uint32_t seq;
+    uint16_t count;
+    uint8_t datagram[BUTTON_PUBLISH_MAX_DATAGRAM];
+    uint32_t sent_batches;
+    uint32_t dropped_batches;
+    uint32_t dropped_events;
+} button_publish_t;
+
+extern int button_publish_open_udp(button_publish_t * p_pub, const char * p_ipv4, uint16_t port, uint32_t flush_ticks);
+extern int button_publish_open_unix(button_publish_t * p_pub, const char * p_path, uint32_t flush_ticks);
+extern void button_publish_event(button_publish_t * p_pub, button_pressed_types_t type, button_enum button_id, uint32_t tick);
+extern void button_publish_poll(button_publish_t * p_pub, uint32_t now);
+extern void button_publish_flush(button_publish_t * p_pub, uint32_t now);
+extern void button_publish_close(button_publish_t * p_pub);
+
+#endif // BUTTON_PUBLISH_H
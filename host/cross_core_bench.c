@@ -0,0 +1,334 @@
+/**************************************************
+ * @file    cross_core_bench.c                    *
+ * @brief   ISR on one core, scan on another      *
+ *                                                *
+ * Description:                                   *
+ * Runs button_isr() on a producer thread and     *
+ * button_process() in a tight loop on a consumer *
+ * thread, each pinned to its own CPU, with the   *
+ * driver built for BUTTON_CROSS_CORE. The        *
+ * producer plays long presses round-robin on     *
+ * five BOTH_EDGES buttons against the real       *
+ * clock (ticks are CLOCK_MONOTONIC nanoseconds). *
+ *                                                *
+ * The trace hook runs where an edge is recorded, *
+ * which in this mode is the scan thread, so the  *
+ * time from the ISR stamp to the hook call is    *
+ * the handoff latency between the cores. Its     *
+ * distribution, the ISR cost, the scan rate,     *
+ * queue drops and the event count against the    *
+ * presses played are reported. On a single CPU   *
+ * the two threads time-share and the latency is  *
+ * the scheduler's, not the queue's.              *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -pthread -DBUTTON_CROSS_CORE=1       *
+ *       -DBUTTON_TRACE_BACKEND=2                 *
+ *       -I../button_module cross_core_bench.c    *
+ *       ../button_module/button.c -o xcore       *
+ * Usage: ./xcore [seconds] [isr_cpu] [scan_cpu]  *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "button.h"
+#include "button_trace.h"
+
+#if (BUTTON_CROSS_CORE == 0)
+#error "build with -DBUTTON_CROSS_CORE=1"
+#endif
+#if (BUTTON_TRACE_BACKEND != BUTTON_TRACE_BACKEND_HOOK)
+#error "build with -DBUTTON_TRACE_BACKEND=2: the latency is measured in button_trace_hook()"
+#endif
+
+#define DEBOUNCE_US         (1000U)
+#define LONG_PRESS_US       (20000U)
+#define HOLD_US             (30000U)
+#define GAP_US              (20000U)
+#define BIN_NS              (50U)
+#define BIN_COUNT           (4096U)
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum_ns;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint64_t bins[BIN_COUNT + 1];       // BIN_NS wide; the last one collects the overflow
+} histogram_t;
+
+static button_api_t api;
+static button_instance_t instance;
+static histogram_t latency;
+static uint64_t events[BUTTON_PRESS_TYPE_MAX];
+static uint64_t scans = 0;
+static uint64_t presses = 0;
+static uint64_t isr_calls = 0;
+static uint64_t isr_ns = 0;
+static uint32_t level = 0;              // bit n = button n pressed, written by the ISR thread
+static volatile int producing = 1;
+static volatile int scanning = 1;
+
+/**
+ * @fn     now_ns
+ * @brief  CLOCK_MONOTONIC in nanoseconds.
+ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @fn     pin_to_cpu
+ * @brief  Restrict the calling thread to one CPU (modulo the online count).
+ */
+
+static void pin_to_cpu(uint32_t cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % (uint32_t)sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    return (uint32_t)now_ns();
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    return ((__atomic_load_n(&level, __ATOMIC_ACQUIRE) >> (p_pin->pin - 1)) & 1U) ? 0 : 1;
+}
+
+static void event_callback(button_pressed_types_t type, button_enum button_id)
+{
+    (void)button_id;
+    if ((uint32_t)type < BUTTON_PRESS_TYPE_MAX)
+    {
+        events[type]++;
+    }
+}
+
+/**
+ * @fn     button_trace_hook
+ * @brief  Histogram of the time from the ISR's stamp to the edge being recorded.
+ */
+
+void button_trace_hook(button_trace_point_t point, uint8_t id, uint32_t a, uint32_t b)
+{
+    (void)id;
+    (void)a;
+    if (BUTTON_TRACE_POINT_EDGE == point)
+    {
+        uint32_t ns = (uint32_t)now_ns() - b;
+        uint32_t bin = ns / BIN_NS;
+        latency.bins[(bin < BIN_COUNT) ? bin : BIN_COUNT]++;
+        latency.min_ns = (0 == latency.count || ns < latency.min_ns) ? ns : latency.min_ns;
+        latency.max_ns = (ns > latency.max_ns) ? ns : latency.max_ns;
+        latency.sum_ns += ns;
+        latency.count++;
+    }
+}
+
+/**
+ * @fn     percentile
+ * @brief  Upper edge of the bin holding the given fraction of the samples.
+ *
+ * @return Nanoseconds, or 0 if that bin is the overflow one.
+ */
+
+static uint32_t percentile(const histogram_t * p_hist, double fraction)
+{
+    uint64_t target = (uint64_t)((double)p_hist->count * fraction);
+    uint64_t seen = 0;
+    uint32_t i = 0;
+    for (i=0; i<BIN_COUNT; i++)
+    {
+        seen += p_hist->bins[i];
+        if (seen > target)
+        {
+            return (i + 1) * BIN_NS;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn     fire
+ * @brief  Change the level of a button and call the ISR for it, timing the call.
+ */
+
+static void fire(uint8_t b, uint8_t pressed)
+{
+    uint64_t t0 = 0;
+    if (pressed)
+    {
+        __atomic_or_fetch(&level, 1U << b, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        __atomic_and_fetch(&level, ~(1U << b), __ATOMIC_RELEASE);
+    }
+    t0 = now_ns();
+    button_isr(&api.button_pins[b]);
+    isr_ns += now_ns() - t0;
+    isr_calls++;
+}
+
+/**
+ * @fn     producer_main
+ * @brief  Long presses on every button, staggered, until the run time is over.
+ */
+
+static void * producer_main(void * p_arg)
+{
+    uint64_t next[BUTTON_MAX];
+    uint8_t pressed[BUTTON_MAX] = {0};
+    uint64_t start = 0;
+    uint8_t b = 0;
+    pin_to_cpu(*(uint32_t *)p_arg);
+    start = now_ns() + 1000000ULL;
+    for (b=0; b<BUTTON_MAX; b++)
+    {
+        next[b] = start + (uint64_t)b * (HOLD_US + GAP_US) * 1000ULL / BUTTON_MAX;
+    }
+    while (producing)
+    {
+        uint8_t first = 0;
+        for (b=1; b<BUTTON_MAX; b++)
+        {
+            first = (next[b] < next[first]) ? b : first;
+        }
+        while (now_ns() < next[first])
+        {
+        }
+        pressed[first] = !pressed[first];
+        fire(first, pressed[first]);
+        next[first] += (pressed[first] ? HOLD_US : GAP_US) * 1000ULL;
+        presses += pressed[first];
+    }
+    for (b=0; b<BUTTON_MAX; b++)
+    {
+        if (pressed[b])
+        {
+            while (now_ns() < next[b])
+            {
+            }
+            fire(b, 0);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn     consumer_main
+ * @brief  button_process() back to back until told to stop.
+ */
+
+static void * consumer_main(void * p_arg)
+{
+    pin_to_cpu(*(uint32_t *)p_arg);
+    while (scanning)
+    {
+        button_process();
+        scans++;
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t seconds = 2;
+    uint32_t isr_cpu = 0;
+    uint32_t scan_cpu = 1;
+    pthread_t producer;
+    pthread_t consumer;
+    uint64_t t0 = 0;
+    uint64_t wall = 0;
+    uint32_t dropped = 0;
+    uint8_t b = 0;
+    if (argc > 1)
+    {
+        seconds = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        isr_cpu = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        scan_cpu = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+    memset(&api, 0, sizeof(api));
+    for (b=0; b<BUTTON_MAX; b++)
+    {
+        api.button_pins[b].pin = (uint8_t)(b + 1);
+        api.button_pins[b].interrupt_mode = BUTTON_INTERRUPT_MODE_BOTH_EDGES;
+    }
+    api.size_of_buttons = BUTTON_MAX;
+    api.tick_count_in_1us = 1000;
+    api.debounce_us = DEBOUNCE_US;
+    api.long_press_us = LONG_PRESS_US;
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_event_callback = event_callback;
+    button_select_instance(&instance);
+    if (0 != button_initialize(&api))
+    {
+        fprintf(stderr, "button_initialize failed\n");
+        return 1;
+    }
+    printf("ISR on CPU %u, scan on CPU %u of %ld, %u s, queue of %u edges per button\n",
+           isr_cpu, scan_cpu, sysconf(_SC_NPROCESSORS_ONLN), seconds, BUTTON_CROSS_CORE_QUEUE);
+
+    t0 = now_ns();
+    pthread_create(&consumer, NULL, consumer_main, &scan_cpu);
+    pthread_create(&producer, NULL, producer_main, &isr_cpu);
+    sleep(seconds);
+    producing = 0;
+    pthread_join(producer, NULL);
+    usleep((BUTTON_MULTI_PRESS_US + 2 * LONG_PRESS_US) * 2);
+    scanning = 0;
+    pthread_join(consumer, NULL);
+    wall = now_ns() - t0;
+
+    for (b=0; b<BUTTON_MAX; b++)
+    {
+        uint32_t count = 0;
+        (void)button_get_edge_drops((button_enum)b, &count);
+        dropped += count;
+    }
+    printf("%llu presses, %llu long / %llu normal / %llu double events, %u edges dropped\n",
+           (unsigned long long)presses, (unsigned long long)events[BUTTON_LONG_PRESS],
+           (unsigned long long)events[BUTTON_NORMAL_PRESS], (unsigned long long)events[BUTTON_DOUBLE_PRESS], dropped);
+    printf("scan: %.2f M button_process/s, ISR: %.0f ns per call\n",
+           (double)scans / ((double)wall / 1e9) / 1e6, (double)isr_ns / (double)((0 != isr_calls) ? isr_calls : 1));
+    if (0 != latency.count)
+    {
+        uint32_t p50 = percentile(&latency, 0.5);
+        uint32_t p99 = percentile(&latency, 0.99);
+        printf("handoff latency over %llu edges: min %u ns, mean %.0f ns, p50 %s%u ns, p99 %s%u ns, max %u ns\n",
+               (unsigned long long)latency.count, latency.min_ns, (double)latency.sum_ns / (double)latency.count,
+               (0 != p50) ? "" : ">", (0 != p50) ? p50 : BIN_COUNT * BIN_NS,
+               (0 != p99) ? "" : ">", (0 != p99) ? p99 : BIN_COUNT * BIN_NS, latency.max_ns);
+    }
+    return ((events[BUTTON_LONG_PRESS] == presses) && (0 == dropped)) ? 0 : 1;
+}
@@ -0,0 +1,532 @@
+/**************************************************
+ * @file    diff_fuzz.c                           *
+ * @brief   Differential fuzzer: every engine in  *
+ *          the table against the reference       *
+ *                                                *
+ * Description:                                   *
+ * Decodes a byte string into a configuration and *
+ * a stream of stimuli (clock advances placed on  *
+ * and around the driver thresholds, pin levels,  *
+ * interrupts, scans, time jumps) and applies the *
+ * same stream to every engine in engines[].      *
+ * After each stimulus the engines must agree     *
+ * with engines[0], button.c as built for the     *
+ * device, on every event (type, button, tick),   *
+ * its button_get_event_info() record and the     *
+ * pressed mask. The first divergence is printed  *
+ * with the step that caused it.                  *
+ *                                                *
+ * The table holds a second build of button.c     *
+ * (diff_fuzz_variant.c) with other compile       *
+ * options; optimised engines are added the same  *
+ * way, one wrapper and one table entry each.     *
+ *                                                *
+ * Standalone, it runs seeded random inputs and   *
+ * reports throughput; a diverging input is saved *
+ * to diff_fuzz_crash.bin and can be replayed by  *
+ * passing the file name. With                    *
+ * -DDIFF_FUZZ_LIBFUZZER it only provides         *
+ * LLVMFuzzerTestOneInput() and aborts on a       *
+ * divergence.                                    *
+ *                                                *
+ * Build (Linux), standalone:                     *
+ *   gcc -O2 -I../button_module diff_fuzz.c       *
+ *       diff_fuzz_variant.c                      *
+ *       ../button_module/button.c -o diff_fuzz   *
+ * Build, libFuzzer:                              *
+ *   clang -O2 -g -fsanitize=fuzzer,address       *
+ *       -DDIFF_FUZZ_LIBFUZZER -I../button_module *
+ *       diff_fuzz.c diff_fuzz_variant.c          *
+ *       ../button_module/button.c -o diff_fuzz   *
+ * Usage: ./diff_fuzz [iterations] [seed]         *
+ *        ./diff_fuzz crash.bin                   *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "button.h"
+
+#define CONFIG_BYTES        (12)
+#define MAX_LOG             (256)
+#define MIN_INPUT           (CONFIG_BYTES + 16)
+#define MAX_INPUT           (4096)
+
+typedef struct
+{
+    const char * p_name;
+    int (* fp_initialize)(button_api_t * p_button_api);
+    void (* fp_isr)(pin_config_t * p_pin);
+    void (* fp_process)(void);
+    void (* fp_notify_time_jump)(uint32_t delta_tick);
+    int (* fp_get_event_info)(button_enum button_id, button_event_info_t * p_info);
+    uint32_t (* fp_get_pressed_mask)(void);
+} engine_t;
+
+typedef struct
+{
+    button_pressed_types_t type;
+    uint8_t id;
+    uint32_t tick;
+    button_event_info_t info;
+} logged_event_t;
+
+typedef struct
+{
+    logged_event_t events[MAX_LOG];
+    uint32_t count;
+} event_log_t;
+
+extern int variant_button_initialize(button_api_t * p_button_api);
+extern void variant_button_isr(pin_config_t * p_pin);
+extern void variant_button_process();
+extern void variant_button_notify_time_jump(uint32_t delta_tick);
+extern int variant_button_get_event_info(button_enum button_id, button_event_info_t * p_info);
+extern uint32_t variant_button_get_pressed_mask(void);
+
+static const engine_t engines[] =
+{
+    {"reference", button_initialize, button_isr, button_process, button_notify_time_jump,
+     button_get_event_info, button_get_pressed_mask},
+    {"lut8+stats", variant_button_initialize, variant_button_isr, variant_button_process, variant_button_notify_time_jump,
+     variant_button_get_event_info, variant_button_get_pressed_mask},
+};
+#define ENGINE_COUNT    (sizeof(engines) / sizeof(engines[0]))
+
+static button_api_t apis[ENGINE_COUNT];
+static event_log_t logs[ENGINE_COUNT];
+static uint32_t virtual_now = 0;
+static uint32_t virtual_cycles = 0;
+static uint8_t virtual_level = 0;
+static uint8_t pin_owner[256];
+static uint64_t total_steps = 0;
+static uint64_t total_events = 0;
+
+static const char * const type_names[] = {"NORMAL", "LONG", "DOUBLE", "HOLD1", "HOLD2", "HOLD3", "HOLD4"};
+static const char * const op_names[] = {"advance", "advance", "levels", "toggle", "isr", "process", "time jump", "scan 1 ms"};
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    return virtual_now;
+}
+
+static uint32_t cycle_counter(void)
+{
+    return virtual_cycles++;
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    uint8_t pressed = (virtual_level >> pin_owner[p_pin->pin]) & 1U;
+    return (pressed == apis[0].active_high) ? 1 : 0;
+}
+
+/**
+ * @fn     log_event
+ * @brief  Append an event of one engine, with its event info, to that engine's log.
+ */
+
+static void log_event(uint8_t engine, button_pressed_types_t type, button_enum button_id)
+{
+    event_log_t * p_log = &logs[engine];
+    if (p_log->count < MAX_LOG)
+    {
+        logged_event_t * p_event = &p_log->events[p_log->count];
+        memset(p_event, 0, sizeof(*p_event));
+        p_event->type = type;
+        p_event->id = (uint8_t)button_id;
+        p_event->tick = virtual_now;
+        (void)engines[engine].fp_get_event_info(button_id, &p_event->info);
+    }
+    p_log->count++;
+}
+
+static void event_callback_0(button_pressed_types_t type, button_enum button_id)
+{
+    log_event(0, type, button_id);
+}
+
+static void event_callback_1(button_pressed_types_t type, button_enum button_id)
+{
+    log_event(1, type, button_id);
+}
+
+static void (* const event_callbacks[ENGINE_COUNT])(button_pressed_types_t type, button_enum button_id) =
+{
+    event_callback_0,
+    event_callback_1,
+};
+
+/**
+ * @fn     print_event
+ * @brief  One logged event as text, or "nothing" past the end of the log.
+ */
+
+static void print_event(const char * p_label, const event_log_t * p_log, uint32_t index)
+{
+    if (index < p_log->count)
+    {
+        const logged_event_t * p_event = &p_log->events[index];
+        printf("  %-10s %s b%u at 0x%08x press 0x%08x (+-%u) release 0x%08x (+-%u)\n", p_label,
+               (p_event->type < BUTTON_PRESS_TYPE_MAX) ? type_names[p_event->type] : "?", p_event->id, p_event->tick,
+               p_event->info.press_tick, p_event->info.press_uncertainty_tick,
+               p_event->info.release_tick, p_event->info.release_uncertainty_tick);
+    }
+    else
+    {
+        printf("  %-10s nothing\n", p_label);
+    }
+}
+
+/**
+ * @fn     compare
+ * @brief  Check every engine against engines[0] after a step.
+ *
+ * @return 0 when they agree; otherwise the divergence is printed and -1 returned.
+ */
+
+static int compare(uint32_t step, uint8_t op)
+{
+    uint8_t e = 0;
+    uint32_t i = 0;
+    for (e=1; e<ENGINE_COUNT; e++)
+    {
+        uint32_t count = (logs[0].count < logs[e].count) ? logs[e].count : logs[0].count;
+        for (i=0; (i<count) && (i<MAX_LOG); i++)
+        {
+            if ((i >= logs[0].count) || (i >= logs[e].count)
+                || (0 != memcmp(&logs[0].events[i], &logs[e].events[i], sizeof(logged_event_t))))
+            {
+                printf("divergence at step %u (%s), event %u:\n", step, op_names[op & 7], i);
+                print_event(engines[0].p_name, &logs[0], i);
+                print_event(engines[e].p_name, &logs[e], i);
+                return -1;
+            }
+        }
+        if (engines[0].fp_get_pressed_mask() != engines[e].fp_get_pressed_mask())
+        {
+            printf("divergence at step %u (%s): pressed mask 0x%02x (%s) vs 0x%02x (%s)\n", step, op_names[op & 7],
+                   engines[0].fp_get_pressed_mask(), engines[0].p_name, engines[e].fp_get_pressed_mask(), engines[e].p_name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn     configure
+ * @brief  Build the configuration shared by all engines from the first CONFIG_BYTES.
+ *
+ * Pins may collide and thresholds may be invalid on purpose: the engines must
+ * then agree on rejecting the configuration.
+ */
+
+static void configure(const uint8_t * p_data)
+{
+    button_api_t api;
+    uint8_t i = 0;
+    memset(&api, 0, sizeof(api));
+    memset(pin_owner, 0, sizeof(pin_owner));
+    api.size_of_buttons = (uint8_t)(1 + p_data[0] % BUTTON_MAX);
+    api.active_high = p_data[1] & 1U;
+    api.poll_interpolation = (p_data[1] >> 1) & 1U;
+    api.time_jump_us = (0 != (p_data[1] & 4U)) ? (200000U + 100000U * (p_data[1] >> 5)) : 0;
+    api.tick_count_in_1us = 1U + ((p_data[1] >> 3) & 3U);
+    for (i=0; i<api.size_of_buttons; i++)
+    {
+        api.button_pins[i].pin = (uint8_t)(p_data[2 + i] % 100);
+        api.button_pins[i].interrupt_mode = (button_interrupt_mode_t)((p_data[7] >> (2 * (i & 3))) & 3U);
+        api.button_pins[i].hw_filtered = (p_data[2 + i] >> 7) & 1U;
+        api.button_pins[i].hold_us[0] = (0 != (p_data[2 + i] & 0x40U)) ? 50000U * (1U + (p_data[8] & 7U)) : 0;
+        api.button_pins[i].hold_us[1] = 3U * api.button_pins[i].hold_us[0];
+        if (0 != (p_data[2 + i] & 0x20U))
+        {
+            api.button_pins[i].press_debounce_us = 1000U * (p_data[11] & 15U);
+            api.button_pins[i].release_debounce_us = 1000U * (1U + (p_data[11] >> 4));
+        }
+        pin_owner[api.button_pins[i].pin] = i;
+    }
+    api.button_pins[4].interrupt_mode = (button_interrupt_mode_t)((p_data[0] >> 4) & 3U);
+    api.debounce_us = 1000U * (1U + p_data[8] % 50);
+    api.long_press_us = (0 == p_data[9]) ? api.debounce_us : (api.debounce_us + 100000U * (1U + p_data[9] % 20));
+    virtual_now = 0U - ((uint32_t)p_data[10] << 20) - p_data[11];
+    virtual_level = 0;
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_cycle_counter = cycle_counter;
+    for (i=0; i<ENGINE_COUNT; i++)
+    {
+        apis[i] = api;
+        apis[i].fp_event_callback = event_callbacks[i];
+        logs[i].count = 0;
+    }
+}
+
+/**
+ * @fn     advance
+ * @brief  Clock advance for an advance step; scale 3 lands on and next to thresholds.
+ */
+
+static uint32_t advance(uint8_t scale, uint8_t arg)
+{
+    const button_api_t * p_api = &apis[0];
+    uint32_t tpu = p_api->tick_count_in_1us;
+    uint32_t thresholds[4];
+    uint32_t delta = 0;
+    thresholds[0] = p_api->debounce_us * tpu;
+    thresholds[1] = p_api->long_press_us * tpu;
+    thresholds[2] = BUTTON_MULTI_PRESS_US * tpu;
+    thresholds[3] = p_api->time_jump_us * tpu;
+    switch (scale)
+    {
+        case 0:
+            delta = arg;
+            break;
+        case 1:
+            delta = (uint32_t)arg * 100U * tpu;
+            break;
+        case 2:
+            delta = (uint32_t)arg * 10000U * tpu;
+            break;
+        default:
+            delta = thresholds[arg & 3] + ((arg >> 2) % 3) - 1U;
+            break;
+    }
+    return delta;
+}
+
+/**
+ * @fn     run_input
+ * @brief  Apply one input to every engine, comparing after each step.
+ *
+ * @return 0 when all engines agreed throughout, -1 at the first divergence.
+ */
+
+static int run_input(const uint8_t * p_data, size_t size)
+{
+    size_t pos = CONFIG_BYTES;
+    uint32_t step = 0;
+    int init = 0;
+    uint8_t e = 0;
+    if (size < CONFIG_BYTES)
+    {
+        return 0;
+    }
+    configure(p_data);
+    init = engines[0].fp_initialize(&apis[0]);
+    for (e=1; e<ENGINE_COUNT; e++)
+    {
+        if (engines[e].fp_initialize(&apis[e]) != init)
+        {
+            printf("divergence at initialization: %s returned %d, %s did not\n", engines[0].p_name, init, engines[e].p_name);
+            return -1;
+        }
+    }
+    if (0 != init)
+    {
+        return 0;
+    }
+    while (pos < size)
+    {
+        uint8_t op = p_data[pos++];
+        uint8_t arg = (pos < size) ? p_data[pos] : 0;
+        uint8_t button = (uint8_t)((op >> 3) % apis[0].size_of_buttons);
+        switch (op & 7)
+        {
+            case 0:
+            case 1:
+                virtual_now += advance((op >> 3) & 3U, arg);
+                pos++;
+                break;
+            case 2:
+                virtual_level = arg;
+                pos++;
+                break;
+            case 3:
+                virtual_level ^= (uint8_t)(1U << button);
+                break;
+            case 4:
+                for (e=0; e<ENGINE_COUNT; e++)
+                {
+                    engines[e].fp_isr(&apis[e].button_pins[button]);
+                }
+                break;
+            case 5:
+                for (e=0; e<ENGINE_COUNT; e++)
+                {
+                    engines[e].fp_process();
+                }
+                break;
+            case 6:
+                for (e=0; e<ENGINE_COUNT; e++)
+                {
+                    engines[e].fp_notify_time_jump((uint32_t)arg * 10000U * apis[0].tick_count_in_1us);
+                }
+                pos++;
+                break;
+            default:
+                virtual_now += 1000U * apis[0].tick_count_in_1us;
+                for (e=0; e<ENGINE_COUNT; e++)
+                {
+                    engines[e].fp_process();
+                }
+                break;
+        }
+        step++;
+        if (0 != compare(step, op))
+        {
+            return -1;
+        }
+    }
+    total_steps += step;
+    total_events += logs[0].count;
+    return 0;
+}
+
+#ifdef DIFF_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t * p_data, size_t size)
+{
+    if (0 != run_input(p_data, size))
+    {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator.
+ */
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @fn     random_input
+ * @brief  Random input biased towards the operations that move the driver forward.
+ */
+
+static size_t random_input(uint8_t * p_data)
+{
+    size_t size = MIN_INPUT + (size_t)(rng_next() % (MAX_INPUT - MIN_INPUT));
+    size_t i = 0;
+    for (i=0; i<size; i++)
+    {
+        uint64_t r = rng_next();
+        p_data[i] = (uint8_t)(r >> 56);
+        if ((i >= CONFIG_BYTES) && (0 == (r & 3)))
+        {
+            p_data[i] = (uint8_t)((p_data[i] & 0xF8U) | 7U);
+        }
+    }
+    /* Mostly valid configurations, so most inputs reach the scan path. */
+    if (0 != (rng_next() & 7))
+    {
+        p_data[9] |= 1U;
+        for (i=0; i<BUTTON_MAX; i++)
+        {
+            p_data[2 + i] = (uint8_t)((p_data[2 + i] & 0xF8U) | i);
+        }
+    }
+    return size;
+}
+
+/**
+ * @fn     replay
+ * @brief  Run one saved input.
+ */
+
+static int replay(const char * p_path)
+{
+    static uint8_t data[MAX_INPUT];
+    size_t size = 0;
+    FILE * p_file = fopen(p_path, "rb");
+    if (NULL == p_file)
+    {
+        fprintf(stderr, "cannot open %s\n", p_path);
+        return 2;
+    }
+    size = fread(data, 1, sizeof(data), p_file);
+    fclose(p_file);
+    if (0 != run_input(data, size))
+    {
+        return 1;
+    }
+    printf("%s: %zu bytes, %llu steps, %llu events, engines agree\n", p_path, size,
+           (unsigned long long)total_steps, (unsigned long long)total_events);
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t data[MAX_INPUT];
+    uint64_t iterations = 100000;
+    uint64_t n = 0;
+    struct timespec t0;
+    struct timespec t1;
+    double wall = 0;
+    if ((argc > 1) && ((argv[1][0] < '0') || (argv[1][0] > '9')))
+    {
+        return replay(argv[1]);
+    }
+    if (argc > 1)
+    {
+        iterations = strtoull(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        rng_state += strtoull(argv[2], NULL, 0) * 0xD1B54A32D192ED03ULL;
+        rng_state = (0 != rng_state) ? rng_state : 1;
+    }
+    printf("%u engines:", (unsigned)ENGINE_COUNT);
+    for (n=0; n<ENGINE_COUNT; n++)
+    {
+        printf(" %s", engines[n].p_name);
+    }
+    printf("\n");
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (n=0; n<iterations; n++)
+    {
+        size_t size = random_input(data);
+        if (0 != run_input(data, size))
+        {
+            FILE * p_file = fopen("diff_fuzz_crash.bin", "wb");
+            if (NULL != p_file)
+            {
+                fwrite(data, 1, size, p_file);
+                fclose(p_file);
+            }
+            printf("input %llu saved to diff_fuzz_crash.bin\n", (unsigned long long)n);
+            return 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    wall = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%llu inputs, %llu steps, %llu events in %.2f s: %.0f inputs/s, %.2f M steps/s, %.0f events/s per engine\n",
+           (unsigned long long)iterations, (unsigned long long)total_steps, (unsigned long long)total_events, wall,
+           (double)iterations / wall, (double)total_steps / wall / 1e6, (double)total_events / wall);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/**************************************************
+ * @file    diff_fuzz_variant.c                   *
+ * @brief   Second copy of the driver for         *
+ *          diff_fuzz.c                           *
+ *                                                *
+ * Description:                                   *
+ * Compiles button.c again with its public        *
+ * functions renamed to variant_button_*, so one  *
+ * process holds two independent driver           *
+ * singletons. This copy is built with a small    *
+ * pin lookup table (pins from 8 up take the      *
+ * linear search) and with BUTTON_CYCLE_STATS,    *
+ * two options that must not change behaviour.    *
+ * An optimised engine gets a wrapper like this   *
+ * one and an entry in diff_fuzz.c's engine       *
+ * table.                                         *
+ *                                                *
+ **************************************************/
+
+#define BUTTON_PIN_LUT_SIZE     (8)
+#define BUTTON_CYCLE_STATS      (1)
+
+#define button_select_instance          variant_button_select_instance
+#define button_initialize               variant_button_initialize
+#define button_initialize_precomputed   variant_button_initialize_precomputed
+#define button_isr                      variant_button_isr
+#define button_process                  variant_button_process
+#define button_notify_time_jump         variant_button_notify_time_jump
+#define button_get_event_info           variant_button_get_event_info
+#define button_inject_event             variant_button_inject_event
+#define button_get_pressed_mask         variant_button_get_pressed_mask
+#define button_get_press_modifiers      variant_button_get_press_modifiers
+#define button_get_edge_drops           variant_button_get_edge_drops
+#define button_get_cycle_stats          variant_button_get_cycle_stats
+#define button_reset_cycle_stats        variant_button_reset_cycle_stats
+
+#include "button.c"
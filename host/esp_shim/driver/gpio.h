@@ -0,0 +1,67 @@
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Host stand-in for driver/gpio.h, backed by the simulated GPIO bank in
+ * esp_shim.c. Inputs are driven by the test through esp_shim_gpio_drive()
+ * (esp_shim.h); handlers registered with gpio_isr_handler_add() run on the
+ * simulated interrupt thread.
+ */
+
+#define GPIO_NUM_MAX    (64)
+
+typedef int gpio_num_t;
+typedef void (* gpio_isr_t)(void * arg);
+
+typedef enum
+{
+    GPIO_MODE_DISABLE = 0,
+    GPIO_MODE_INPUT = 1,
+    GPIO_MODE_OUTPUT = 2,
+    GPIO_MODE_INPUT_OUTPUT = 3,
+} gpio_mode_t;
+
+typedef enum
+{
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE = 1,
+} gpio_pullup_t;
+
+typedef enum
+{
+    GPIO_PULLDOWN_DISABLE = 0,
+    GPIO_PULLDOWN_ENABLE = 1,
+} gpio_pulldown_t;
+
+typedef enum
+{
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE = 1,
+    GPIO_INTR_NEGEDGE = 2,
+    GPIO_INTR_ANYEDGE = 3,
+    GPIO_INTR_LOW_LEVEL = 4,
+    GPIO_INTR_HIGH_LEVEL = 5,
+} gpio_int_type_t;
+
+typedef struct
+{
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+extern esp_err_t gpio_config(const gpio_config_t * p_conf);
+extern int gpio_get_level(gpio_num_t gpio_num);
+extern esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+extern esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+extern esp_err_t gpio_install_isr_service(int intr_alloc_flags);
+extern void gpio_uninstall_isr_service(void);
+extern esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void * args);
+extern esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num);
+
+#endif // DRIVER_GPIO_H
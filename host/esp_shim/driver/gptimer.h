@@ -0,0 +1,48 @@
+#ifndef DRIVER_GPTIMER_H
+#define DRIVER_GPTIMER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * Host stand-in for driver/gptimer.h: counters derived from CLOCK_MONOTONIC
+ * at the requested resolution. Alarms and callbacks are not simulated.
+ */
+
+typedef struct gptimer_t * gptimer_handle_t;
+
+typedef enum
+{
+    GPTIMER_CLK_SRC_DEFAULT = 0,
+    GPTIMER_CLK_SRC_APB = 0,
+    GPTIMER_CLK_SRC_XTAL = 1,
+} gptimer_clock_source_t;
+
+typedef enum
+{
+    GPTIMER_COUNT_DOWN = 0,
+    GPTIMER_COUNT_UP = 1,
+} gptimer_count_direction_t;
+
+typedef struct
+{
+    gptimer_clock_source_t clk_src;
+    gptimer_count_direction_t direction;
+    uint32_t resolution_hz;
+    int intr_priority;
+    struct
+    {
+        uint32_t intr_shared : 1;
+    } flags;
+} gptimer_config_t;
+
+extern esp_err_t gptimer_new_timer(const gptimer_config_t * p_config, gptimer_handle_t * p_ret_timer);
+extern esp_err_t gptimer_del_timer(gptimer_handle_t timer);
+extern esp_err_t gptimer_set_raw_count(gptimer_handle_t timer, uint64_t value);
+extern esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t * p_value);
+extern esp_err_t gptimer_enable(gptimer_handle_t timer);
+extern esp_err_t gptimer_disable(gptimer_handle_t timer);
+extern esp_err_t gptimer_start(gptimer_handle_t timer);
+extern esp_err_t gptimer_stop(gptimer_handle_t timer);
+
+#endif // DRIVER_GPTIMER_H
@@ -0,0 +1,34 @@
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Host stand-in for the ESP-IDF esp_err.h subset used by the examples.
+ */
+
+typedef int esp_err_t;
+
+#define ESP_OK                  (0)
+#define ESP_FAIL                (-1)
+#define ESP_ERR_NO_MEM          (0x101)
+#define ESP_ERR_INVALID_ARG     (0x102)
+#define ESP_ERR_INVALID_STATE   (0x103)
+#define ESP_ERR_NOT_FOUND       (0x105)
+
+extern const char * esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) \
+    do \
+    { \
+        esp_err_t err_rc_ = (x); \
+        if (ESP_OK != err_rc_) \
+        { \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\n%s\n", \
+                    err_rc_, esp_err_to_name(err_rc_), __FILE__, __LINE__, #x); \
+            abort(); \
+        } \
+    } while (0)
+
+#endif // ESP_ERR_H
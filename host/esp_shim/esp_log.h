@@ -0,0 +1,35 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+/*
+ * Host stand-in for esp_log.h: same "L (ms) tag: message" line format as the
+ * device console, written to stdout. Lines above ESP_SHIM_LOG_LEVEL
+ * (1 = error .. 5 = verbose, default 3 = info) are compiled out.
+ */
+
+#ifndef ESP_SHIM_LOG_LEVEL
+#define ESP_SHIM_LOG_LEVEL  (3)
+#endif
+
+extern uint32_t esp_log_timestamp(void);
+
+#define ESP_SHIM_LOG(level, letter, tag, format, ...) \
+    do \
+    { \
+        if (ESP_SHIM_LOG_LEVEL >= (level)) \
+        { \
+            printf(letter " (%u) %s: " format "\n", (unsigned)esp_log_timestamp(), tag, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...)  ESP_SHIM_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  ESP_SHIM_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  ESP_SHIM_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  ESP_SHIM_LOG(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  ESP_SHIM_LOG(5, "V", tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,490 @@
+/**************************************************
+ * @file    esp_shim.c                            *
+ * @brief   Host implementation of the ESP-IDF    *
+ *          subset used by the example app        *
+ *                                                *
+ * Description:                                   *
+ * A simulated GPIO bank, GPIO interrupt service  *
+ * and general purpose timers, so main/           *
+ * example_main.c builds and runs unchanged on    *
+ * Linux. Input edges driven by the test are      *
+ * queued as pending interrupts and dispatched to *
+ * the registered handlers from one interrupt     *
+ * thread, which runs concurrently with the       *
+ * application's button_process() loop like an    *
+ * ISR preempting it on the device. An edge on a  *
+ * pin whose interrupt is still pending is merged *
+ * into it, as the GPIO status register does.     *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "esp_shim.h"
+
+typedef struct
+{
+    int level;
+    uint8_t driven;
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    gpio_isr_t handler;
+    void * arg;
+    uint64_t pending_since_ns;
+} sim_pin_t;
+
+struct gptimer_t
+{
+    uint32_t resolution_hz;
+    gptimer_count_direction_t direction;
+    uint8_t enabled;
+    uint8_t running;
+    uint64_t base_count;
+    uint64_t base_ns;
+};
+
+static pthread_mutex_t gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gpio_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t isr_thread;
+static uint8_t isr_service_installed = 0;
+static uint8_t isr_service_stop = 0;
+static sim_pin_t pins[GPIO_NUM_MAX];
+static uint64_t pending_mask = 0;
+static esp_shim_stats_t stats = {0};
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static uint64_t start_ns = 0;
+
+/**
+ * @fn     now_ns
+ * @brief  CLOCK_MONOTONIC in nanoseconds.
+ */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @fn     record_start
+ * @brief  Remember the process start time for esp_log_timestamp().
+ */
+
+static void record_start(void)
+{
+    start_ns = now_ns();
+}
+
+/**
+ * @fn     edge_matches
+ * @brief  Whether a level change raises the configured interrupt.
+ *
+ * Level interrupts fire once per drive to the active level instead of
+ * re-triggering while the level holds.
+ */
+
+static int edge_matches(gpio_int_type_t type, int old_level, int new_level)
+{
+    int ret = 0;
+    switch (type)
+    {
+        case GPIO_INTR_POSEDGE:
+            ret = (0 == old_level) && (1 == new_level);
+            break;
+        case GPIO_INTR_NEGEDGE:
+            ret = (1 == old_level) && (0 == new_level);
+            break;
+        case GPIO_INTR_ANYEDGE:
+            ret = (old_level != new_level);
+            break;
+        case GPIO_INTR_LOW_LEVEL:
+            ret = (0 == new_level);
+            break;
+        case GPIO_INTR_HIGH_LEVEL:
+            ret = (1 == new_level);
+            break;
+        default:
+            break;
+    }
+    return ret;
+}
+
+/**
+ * @fn     isr_thread_main
+ * @brief  Simulated interrupt controller: runs pending handlers, lowest pin first.
+ */
+
+static void * isr_thread_main(void * p_unused)
+{
+    (void)p_unused;
+    pthread_mutex_lock(&gpio_lock);
+    while (!isr_service_stop)
+    {
+        if (0 == pending_mask)
+        {
+            pthread_cond_wait(&gpio_cond, &gpio_lock);
+        }
+        else
+        {
+            int pin = __builtin_ctzll(pending_mask);
+            gpio_isr_t handler = pins[pin].handler;
+            void * arg = pins[pin].arg;
+            uint64_t latency = 0;
+            pending_mask &= ~(1ULL << pin);
+            latency = now_ns() - pins[pin].pending_since_ns;
+            pthread_mutex_unlock(&gpio_lock);
+            if (NULL != handler)
+            {
+                handler(arg);
+            }
+            pthread_mutex_lock(&gpio_lock);
+            stats.isr_dispatched++;
+            stats.isr_latency_total_ns += latency;
+            if (latency > stats.isr_latency_max_ns)
+            {
+                stats.isr_latency_max_ns = latency;
+            }
+        }
+    }
+    pthread_mutex_unlock(&gpio_lock);
+    return NULL;
+}
+
+const char * esp_err_to_name(esp_err_t code)
+{
+    const char * p_name = "UNKNOWN ERROR";
+    switch (code)
+    {
+        case ESP_OK:                p_name = "ESP_OK"; break;
+        case ESP_FAIL:              p_name = "ESP_FAIL"; break;
+        case ESP_ERR_NO_MEM:        p_name = "ESP_ERR_NO_MEM"; break;
+        case ESP_ERR_INVALID_ARG:   p_name = "ESP_ERR_INVALID_ARG"; break;
+        case ESP_ERR_INVALID_STATE: p_name = "ESP_ERR_INVALID_STATE"; break;
+        case ESP_ERR_NOT_FOUND:     p_name = "ESP_ERR_NOT_FOUND"; break;
+        default: break;
+    }
+    return p_name;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    pthread_once(&start_once, record_start);
+    return (uint32_t)((now_ns() - start_ns) / 1000000ULL);
+}
+
+/* ------------------------------------------------------------------ GPIO */
+
+esp_err_t gpio_config(const gpio_config_t * p_conf)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    int pin = 0;
+    if ((NULL != p_conf) && (0 != p_conf->pin_bit_mask))
+    {
+        pthread_mutex_lock(&gpio_lock);
+        for (pin=0; pin<GPIO_NUM_MAX; pin++)
+        {
+            if (0 != (p_conf->pin_bit_mask & (1ULL << pin)))
+            {
+                pins[pin].mode = p_conf->mode;
+                pins[pin].intr_type = p_conf->intr_type;
+                if (!pins[pin].driven)
+                {
+                    pins[pin].level = (GPIO_PULLUP_ENABLE == p_conf->pull_up_en) ? 1 : 0;
+                }
+            }
+        }
+        pthread_mutex_unlock(&gpio_lock);
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    int level = 0;
+    if ((gpio_num >= 0) && (gpio_num < GPIO_NUM_MAX))
+    {
+        level = __atomic_load_n(&pins[gpio_num].level, __ATOMIC_ACQUIRE);
+        __atomic_fetch_add(&stats.level_reads, 1, __ATOMIC_RELAXED);
+    }
+    return level;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if ((gpio_num >= 0) && (gpio_num < GPIO_NUM_MAX))
+    {
+        if (0 != (pins[gpio_num].mode & GPIO_MODE_OUTPUT))
+        {
+            esp_shim_gpio_drive(gpio_num, (0 != level) ? 1 : 0);
+        }
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if ((gpio_num >= 0) && (gpio_num < GPIO_NUM_MAX))
+    {
+        pthread_mutex_lock(&gpio_lock);
+        pins[gpio_num].intr_type = intr_type;
+        pthread_mutex_unlock(&gpio_lock);
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    (void)intr_alloc_flags;
+    if (!isr_service_installed)
+    {
+        isr_service_stop = 0;
+        ret = (0 == pthread_create(&isr_thread, NULL, isr_thread_main, NULL)) ? ESP_OK : ESP_ERR_NO_MEM;
+        isr_service_installed = (ESP_OK == ret);
+    }
+    return ret;
+}
+
+void gpio_uninstall_isr_service(void)
+{
+    if (isr_service_installed)
+    {
+        pthread_mutex_lock(&gpio_lock);
+        isr_service_stop = 1;
+        pthread_cond_signal(&gpio_cond);
+        pthread_mutex_unlock(&gpio_lock);
+        pthread_join(isr_thread, NULL);
+        isr_service_installed = 0;
+    }
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void * args)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (!isr_service_installed)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else if ((gpio_num >= 0) && (gpio_num < GPIO_NUM_MAX))
+    {
+        pthread_mutex_lock(&gpio_lock);
+        pins[gpio_num].handler = isr_handler;
+        pins[gpio_num].arg = args;
+        pthread_mutex_unlock(&gpio_lock);
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    return gpio_isr_handler_add(gpio_num, NULL, NULL);
+}
+
+/* --------------------------------------------------------------- gptimer */
+
+esp_err_t gptimer_new_timer(const gptimer_config_t * p_config, gptimer_handle_t * p_ret_timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if ((NULL != p_config) && (NULL != p_ret_timer) && (0 != p_config->resolution_hz))
+    {
+        struct gptimer_t * p_timer = calloc(1, sizeof(*p_timer));
+        ret = ESP_ERR_NO_MEM;
+        if (NULL != p_timer)
+        {
+            p_timer->resolution_hz = p_config->resolution_hz;
+            p_timer->direction = p_config->direction;
+            *p_ret_timer = p_timer;
+            ret = ESP_OK;
+        }
+    }
+    return ret;
+}
+
+esp_err_t gptimer_del_timer(gptimer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+        if (!timer->enabled)
+        {
+            free(timer);
+            ret = ESP_OK;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @fn     timer_count
+ * @brief  Current count of a timer; counts only while started.
+ */
+
+static uint64_t timer_count(const struct gptimer_t * p_timer)
+{
+    uint64_t count = p_timer->base_count;
+    if (p_timer->running)
+    {
+        uint64_t ns = now_ns() - p_timer->base_ns;
+        uint64_t ticks = (ns / 1000000000ULL) * p_timer->resolution_hz
+                         + ((ns % 1000000000ULL) * p_timer->resolution_hz) / 1000000000ULL;
+        count = (GPTIMER_COUNT_UP == p_timer->direction) ? (count + ticks) : (count - ticks);
+    }
+    return count;
+}
+
+esp_err_t gptimer_set_raw_count(gptimer_handle_t timer, uint64_t value)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        timer->base_count = value;
+        timer->base_ns = now_ns();
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t * p_value)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if ((NULL != timer) && (NULL != p_value))
+    {
+        *p_value = timer_count(timer);
+        __atomic_fetch_add(&stats.timer_reads, 1, __ATOMIC_RELAXED);
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t gptimer_enable(gptimer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        ret = timer->enabled ? ESP_ERR_INVALID_STATE : ESP_OK;
+        timer->enabled = 1;
+    }
+    return ret;
+}
+
+esp_err_t gptimer_disable(gptimer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        ret = (timer->enabled && !timer->running) ? ESP_OK : ESP_ERR_INVALID_STATE;
+        if (ESP_OK == ret)
+        {
+            timer->enabled = 0;
+        }
+    }
+    return ret;
+}
+
+esp_err_t gptimer_start(gptimer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        ret = (timer->enabled && !timer->running) ? ESP_OK : ESP_ERR_INVALID_STATE;
+        if (ESP_OK == ret)
+        {
+            timer->base_ns = now_ns();
+            timer->running = 1;
+        }
+    }
+    return ret;
+}
+
+esp_err_t gptimer_stop(gptimer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    if (NULL != timer)
+    {
+        ret = timer->running ? ESP_OK : ESP_ERR_INVALID_STATE;
+        if (ESP_OK == ret)
+        {
+            timer->base_count = timer_count(timer);
+            timer->running = 0;
+        }
+    }
+    return ret;
+}
+
+/* ------------------------------------------------------------ simulation */
+
+/**
+ * @fn     esp_shim_gpio_drive
+ * @brief  Drive an input pin from outside, raising its interrupt if configured.
+ *
+ * @param  gpio_num  Pin to drive.
+ * @param  level     0 or 1; overrides the pull resistor from now on.
+ */
+
+void esp_shim_gpio_drive(gpio_num_t gpio_num, int level)
+{
+    if ((gpio_num >= 0) && (gpio_num < GPIO_NUM_MAX))
+    {
+        int old_level = 0;
+        pthread_mutex_lock(&gpio_lock);
+        old_level = pins[gpio_num].level;
+        __atomic_store_n(&pins[gpio_num].level, (0 != level) ? 1 : 0, __ATOMIC_RELEASE);
+        pins[gpio_num].driven = 1;
+        if (isr_service_installed && (NULL != pins[gpio_num].handler)
+            && edge_matches(pins[gpio_num].intr_type, old_level, pins[gpio_num].level))
+        {
+            if (0 != (pending_mask & (1ULL << gpio_num)))
+            {
+                stats.isr_coalesced++;
+            }
+            else
+            {
+                pending_mask |= (1ULL << gpio_num);
+                pins[gpio_num].pending_since_ns = now_ns();
+                pthread_cond_signal(&gpio_cond);
+            }
+        }
+        pthread_mutex_unlock(&gpio_lock);
+    }
+}
+
+/**
+ * @fn     esp_shim_time_us
+ * @brief  Microseconds since the simulation started.
+ */
+
+uint64_t esp_shim_time_us(void)
+{
+    pthread_once(&start_once, record_start);
+    return (now_ns() - start_ns) / 1000ULL;
+}
+
+/**
+ * @fn     esp_shim_get_stats
+ * @brief  Snapshot of the simulation counters.
+ */
+
+void esp_shim_get_stats(esp_shim_stats_t * p_stats)
+{
+    pthread_mutex_lock(&gpio_lock);
+    *p_stats = stats;
+    p_stats->level_reads = __atomic_load_n(&stats.level_reads, __ATOMIC_RELAXED);
+    p_stats->timer_reads = __atomic_load_n(&stats.timer_reads, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&gpio_lock);
+}
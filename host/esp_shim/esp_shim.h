@@ -0,0 +1,26 @@
+#ifndef ESP_SHIM_H
+#define ESP_SHIM_H
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+/*
+ * Test-side control of the simulated ESP-IDF environment: drives input pins
+ * as the outside world would and reports what the application did with them.
+ */
+
+typedef struct
+{
+    uint64_t level_reads;           // gpio_get_level() calls
+    uint64_t timer_reads;           // gptimer_get_raw_count() calls
+    uint64_t isr_dispatched;        // handlers run on the interrupt thread
+    uint64_t isr_coalesced;         // edges merged into an interrupt still pending
+    uint64_t isr_latency_max_ns;    // edge to handler start
+    uint64_t isr_latency_total_ns;
+} esp_shim_stats_t;
+
+extern void esp_shim_gpio_drive(gpio_num_t gpio_num, int level);
+extern uint64_t esp_shim_time_us(void);
+extern void esp_shim_get_stats(esp_shim_stats_t * p_stats);
+
+#endif // ESP_SHIM_H
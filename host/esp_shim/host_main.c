@@ -0,0 +1,150 @@
+/**************************************************
+ * @file    host_main.c                           *
+ * @brief   Runs main/example_main.c unchanged    *
+ *          on Linux                              *
+ *                                                *
+ * Description:                                   *
+ * Starts a stimulus thread that presses the two  *
+ * example buttons (GPIO33 interrupt driven,      *
+ * GPIO32 polled shift, both active low with      *
+ * pull-ups) with optional contact bounce, then   *
+ * hands the main thread to app_main(), whose     *
+ * busy loop runs button_process() exactly as on  *
+ * the device.                                    *
+ * When the scenario is done the simulation       *
+ * counters are printed and the process exits.    *
+ *                                                *
+ * Build (Linux), from the repository root:       *
+ *   python3 tools/button_codegen.py              *
+ *       main/button_config.json                  *
+ *       host/esp_shim/button_config_gen.h        *
+ *   gcc -O2 -pthread -Ihost/esp_shim             *
+ *       -Ibutton_module main/example_main.c      *
+ *       button_module/button.c                   *
+ *       button_module/button_keymap.c            *
+ *       host/esp_shim/esp_shim.c                 *
+ *       host/esp_shim/host_main.c -o esp_host    *
+ * Usage: ./esp_host [repeats] [bounces]          *
+ *   (perf record ./esp_host 20 to profile)       *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "esp_shim.h"
+
+#define ISR_GPIO        (33)
+#define POLLED_GPIO     (32)
+#define BOUNCE_GAP_US   (300)
+
+extern void app_main(void);
+
+static int repeats = 1;
+static int bounces = 0;
+
+/**
+ * @fn     sleep_us
+ * @brief  Sleep for the given number of microseconds.
+ */
+
+static void sleep_us(uint64_t us)
+{
+    struct timespec ts = {(time_t)(us / 1000000ULL), (long)((us % 1000000ULL) * 1000ULL)};
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @fn     settle
+ * @brief  Move an active-low button to a new level with contact bounce.
+ *
+ * @param  gpio     Pin to drive.
+ * @param  pressed  1 to press (drive low), 0 to release.
+ */
+
+static void settle(int gpio, int pressed)
+{
+    int level = pressed ? 0 : 1;
+    int i = 0;
+    for (i=0; i<bounces; i++)
+    {
+        esp_shim_gpio_drive(gpio, level);
+        sleep_us(BOUNCE_GAP_US);
+        esp_shim_gpio_drive(gpio, !level);
+        sleep_us(BOUNCE_GAP_US);
+    }
+    esp_shim_gpio_drive(gpio, level);
+}
+
+/**
+ * @fn     press
+ * @brief  Hold a button for hold_ms and leave it released for gap_ms.
+ */
+
+static void press(int gpio, uint32_t hold_ms, uint32_t gap_ms)
+{
+    settle(gpio, 1);
+    sleep_us(hold_ms * 1000ULL);
+    settle(gpio, 0);
+    sleep_us(gap_ms * 1000ULL);
+}
+
+/**
+ * @fn     stimulus_main
+ * @brief  Scenario thread: single, double and long presses, then shift + tap.
+ *
+ * Shift is released 50 ms after the tap, long before the tap's event is due at
+ * the end of the multi-press window; the layer must still be the shift one.
+ */
+
+static void * stimulus_main(void * p_unused)
+{
+    esp_shim_stats_t stats;
+    int i = 0;
+    (void)p_unused;
+    sleep_us(200000);
+    for (i=0; i<repeats; i++)
+    {
+        printf("--- round %d: expect SELECT, BACK, MENU, PREVIOUS\n", i + 1);
+        press(ISR_GPIO, 80, 900);
+        press(ISR_GPIO, 80, 150);
+        press(ISR_GPIO, 80, 900);
+        press(ISR_GPIO, 1500, 900);
+        settle(POLLED_GPIO, 1);
+        sleep_us(100000);
+        press(ISR_GPIO, 80, 50);
+        settle(POLLED_GPIO, 0);
+        sleep_us(900000);
+    }
+    esp_shim_get_stats(&stats);
+    printf("--- %llu level reads, %llu timer reads, %llu ISRs (%llu edges coalesced), ISR latency mean %.1f us max %.1f us\n",
+           (unsigned long long)stats.level_reads, (unsigned long long)stats.timer_reads,
+           (unsigned long long)stats.isr_dispatched, (unsigned long long)stats.isr_coalesced,
+           (0 != stats.isr_dispatched) ? (double)stats.isr_latency_total_ns / stats.isr_dispatched / 1000.0 : 0.0,
+           (double)stats.isr_latency_max_ns / 1000.0);
+    fflush(stdout);
+    exit(0);
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    pthread_t stimulus;
+    if (argc > 1)
+    {
+        repeats = atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        bounces = atoi(argv[2]);
+    }
+    if (0 != pthread_create(&stimulus, NULL, stimulus_main, NULL))
+    {
+        return 1;
+    }
+    app_main();
+    return 0;
+}
@@ -0,0 +1,209 @@
+/**************************************************
+ * @file    history_check.c                       *
+ * @brief   Cross-check of the event history      *
+ *          queries against a linear scan         *
+ *                                                *
+ * Description:                                   *
+ * Records random events into the history ring    *
+ * over many 32-bit tick wraps, with scans (and   *
+ * sometimes long idle stretches) in between, and *
+ * keeps a shadow list of every event with its    *
+ * true 64-bit time. After each step the count,  *
+ * button_history_count_since() and               *
+ * button_history_query_button() are compared     *
+ * with a linear scan of the shadow list for a    *
+ * random window, including windows reaching      *
+ * back across wraps. The first mismatch is       *
+ * printed and the exit status is 1.              *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -DBUTTON_HISTORY_SIZE=64             *
+ *       -I../button_module history_check.c       *
+ *       ../button_module/button_history.c        *
+ *       -o history_check                         *
+ * Usage: ./history_check [steps] [seed]          *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "button_history.h"
+
+#if (BUTTON_HISTORY_SIZE == 0)
+#error "build with -DBUTTON_HISTORY_SIZE=n (1..256)"
+#endif
+
+#define MAX_EVENTS      (1U << 20)
+#define MAX_RESULTS     (BUTTON_HISTORY_SIZE)
+
+typedef struct
+{
+    uint64_t time;
+    button_pressed_types_t type;
+    button_enum button_id;
+} shadow_t;
+
+static shadow_t shadow[MAX_EVENTS];
+static uint32_t shadow_count = 0;
+static uint64_t clock_now = 0;
+static uint32_t rng = 1;
+
+static uint32_t next_random(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+/**
+ * @fn     advance_clock
+ * @brief  Move the true clock forward, scanning at most every 2^30 ticks.
+ *
+ * Mostly short gaps, sometimes up to a second at 40 ticks/us, now and then an
+ * idle stretch of a few wraps with the scans the driver would make, and rarely
+ * one of around 256 wraps, where entries must expire.
+ */
+
+static void advance_clock(void)
+{
+    uint32_t pick = next_random() % 1000U;
+    uint64_t gap = (pick < 700) ? (next_random() % 400000U)
+                 : (pick < 970) ? (next_random() % 40000000U)
+                 : (pick < 999) ? ((uint64_t)next_random() << 2)
+                 : (((uint64_t)(250U + next_random() % 12U) << 32) + next_random());
+    while (gap > (1ULL << 30))
+    {
+        clock_now += 1ULL << 30;
+        gap -= 1ULL << 30;
+        button_history_advance((uint32_t)clock_now);
+    }
+    clock_now += gap;
+    button_history_advance((uint32_t)clock_now);
+}
+
+/**
+ * @fn     held_oldest
+ * @brief  Index in the shadow list of the oldest event the ring still holds.
+ *
+ * Events are overwritten after BUTTON_HISTORY_SIZE newer ones and expire once
+ * they are 256 wraps old.
+ */
+
+static uint32_t held_oldest(void)
+{
+    uint32_t oldest = (shadow_count > BUTTON_HISTORY_SIZE) ? (shadow_count - BUTTON_HISTORY_SIZE) : 0;
+    while ((oldest < shadow_count) && (((clock_now >> 32) - (shadow[oldest].time >> 32)) >= 256))
+    {
+        oldest++;
+    }
+    return oldest;
+}
+
+/**
+ * @fn     age_at
+ * @brief  True age of a shadow event at a query time; 0 if the event is newer.
+ */
+
+static uint64_t age_at(uint32_t index, uint64_t query_time)
+{
+    return (shadow[index].time > query_time) ? 0 : (query_time - shadow[index].time);
+}
+
+/**
+ * @fn     check_queries
+ * @brief  Compare the queries with a linear scan for one window.
+ *
+ * Now and then the query time lies a little behind the last scan, as when the
+ * application read the tick just before button_process() ran.
+ *
+ * @return 0 if they agree, -1 after printing the mismatch.
+ */
+
+static int check_queries(uint32_t step, uint32_t window)
+{
+    button_history_entry_t entries[MAX_RESULTS];
+    uint32_t oldest = held_oldest();
+    uint32_t expect = 0;
+    uint32_t i = 0;
+    uint64_t query_time = (0 == (next_random() % 8U)) ? (clock_now - next_random() % 100000U) : clock_now;
+    uint16_t held = button_history_count();
+    uint16_t got = button_history_count_since((uint32_t)query_time, window);
+    button_enum button_id = (button_enum)(next_random() % BUTTON_MAX);
+    uint16_t max_entries = (uint16_t)(1 + next_random() % MAX_RESULTS);
+    uint16_t found = 0;
+    uint16_t want = 0;
+
+    if (held != shadow_count - oldest)
+    {
+        printf("step %u: count() = %u, linear scan %u\n", step, held, shadow_count - oldest);
+        return -1;
+    }
+    for (i=shadow_count; (i > oldest) && (age_at(i - 1, query_time) <= window); i--)
+    {
+        expect++;
+    }
+    if (got != expect)
+    {
+        printf("step %u: count_since(window %u) = %u, linear scan %u\n", step, window, got, expect);
+        return -1;
+    }
+
+    found = button_history_query_button(button_id, (uint32_t)query_time, window, entries, max_entries);
+    for (i=shadow_count; (i > oldest) && (age_at(i - 1, query_time) <= window) && (want < max_entries); i--)
+    {
+        const shadow_t * p_event = &shadow[i - 1];
+        if (p_event->button_id == button_id)
+        {
+            if ((want >= found) || (entries[want].tick != (uint32_t)p_event->time)
+                || (entries[want].type != p_event->type))
+            {
+                printf("step %u: query_button(%d, window %u) entry %u differs from the linear scan\n",
+                       step, button_id, window, want);
+                return -1;
+            }
+            want++;
+        }
+    }
+    if (found != want)
+    {
+        printf("step %u: query_button(%d, window %u) = %u entries, linear scan %u\n", step, button_id, window, found, want);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t steps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000;
+    uint32_t step = 0;
+    rng = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    rng = (0 != rng) ? rng : 1;
+    steps = (steps < MAX_EVENTS) ? steps : MAX_EVENTS;
+
+    button_history_clear();
+    clock_now = 0xFFFFFFFFULL - 1000000ULL;
+    for (step=0; step<steps; step++)
+    {
+        uint32_t window = 0;
+        shadow_t * p_event = &shadow[shadow_count++];
+        advance_clock();
+        p_event->time = clock_now;
+        p_event->type = (button_pressed_types_t)(next_random() % BUTTON_PRESS_TYPE_MAX);
+        p_event->button_id = (button_enum)(next_random() % BUTTON_MAX);
+        button_history_record(p_event->type, p_event->button_id, (uint32_t)clock_now);
+        if (0 == (next_random() % 4U))
+        {
+            advance_clock();
+        }
+        window = (0 == (next_random() % 4U)) ? next_random() : (next_random() % 80000000U);
+        if (0 != check_queries(step, window))
+        {
+            return 1;
+        }
+    }
+    printf("%u events over %llu tick wraps: count_since and query_button match the linear scan\n",
+           steps, (unsigned long long)(clock_now >> 32));
+    return 0;
+}
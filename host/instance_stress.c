@@ -0,0 +1,444 @@
+/**************************************************
+ * @file    instance_stress.c                     *
+ * @brief   Many driver instances on many cores   *
+ *                                                *
+ * Description:                                   *
+ * Creates enough driver instances (five buttons  *
+ * each, button_instance_t) to hold the requested *
+ * number of virtual buttons and scans all of     *
+ * them once per virtual millisecond. Instances   *
+ * are grouped in chunks; every round each worker *
+ * thread gets an equal range of chunks and, once *
+ * its own range is done, steals chunks from the  *
+ * end of other workers' ranges. Each range is    *
+ * one 64-bit word (head, tail) changed only by   *
+ * compare-and-swap, so owner and thieves never   *
+ * take the same chunk.                           *
+ *                                                *
+ * Traffic: every button waits 0.2-3 s, then is   *
+ * held for a tap (50-250 ms) or, one time in     *
+ * ten, for a long press (1.2-2 s). All instances *
+ * share one button_api_t and one precomputed     *
+ * button_derived_t, as a gateway serving         *
+ * identical panels would; the callbacks find the *
+ * panel being scanned through a thread-local     *
+ * pointer.                                       *
+ *                                                *
+ * A single-thread run of another tenth of the    *
+ * rounds, continuing from the state the main run *
+ * left, is the baseline for the per-core         *
+ * efficiency: (throughput / threads) / baseline. *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -pthread -DBUTTON_INSTANCE_TLS=1     *
+ *       -I../button_module instance_stress.c     *
+ *       ../button_module/button.c -o stress      *
+ * Usage: ./stress [buttons] [threads] [rounds]   *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "button.h"
+
+#if (BUTTON_INSTANCE_TLS == 0)
+#error "build with -DBUTTON_INSTANCE_TLS=1: workers select instances concurrently"
+#endif
+
+#define CHUNK_INSTANCES     (256)
+#define MAX_WORKERS         (256)
+#define SCAN_PERIOD_US      (1000U)
+#define DEBOUNCE_US         (10000U)
+#define LONG_PRESS_US       (1000000U)
+
+typedef struct
+{
+    uint64_t rng;
+    uint16_t countdown[BUTTON_MAX];     // scans until the level of each button changes
+    uint8_t level;                      // bit n = button n pressed
+} panel_t;
+
+typedef struct
+{
+    uint64_t range;                     // next chunk << 32 | end chunk, changed by CAS only
+    pthread_t thread;
+    uint32_t index;
+    uint32_t pad0;
+    uint64_t scans;
+    uint64_t events;
+    uint64_t chunks;
+    uint64_t stolen;
+    uint64_t busy_ns;
+} __attribute__((aligned(64))) worker_t;
+
+static button_api_t api;
+static const button_derived_t shared_derived =
+    BUTTON_DERIVED_INITIALIZER(1, DEBOUNCE_US, LONG_PRESS_US, 0, 0);      // polled only: no pin slots
+static button_instance_t * p_instances = NULL;
+static panel_t * p_panels = NULL;
+static uint32_t instance_count = 0;
+static uint32_t chunk_count = 0;
+static worker_t workers[MAX_WORKERS];
+static uint32_t worker_count = 0;
+static pthread_barrier_t round_start;
+static pthread_barrier_t round_end;
+static volatile uint32_t virtual_now = 0;
+static volatile int running = 1;
+static _Thread_local panel_t * p_current = NULL;
+static _Thread_local uint64_t thread_events = 0;
+
+/**
+ * @fn     elapsed_ns
+ * @brief  Nanoseconds between two CLOCK_MONOTONIC readings.
+ */
+
+static uint64_t elapsed_ns(const struct timespec * p_start, const struct timespec * p_end)
+{
+    return (uint64_t)(p_end->tv_sec - p_start->tv_sec) * 1000000000ULL + (uint64_t)p_end->tv_nsec - (uint64_t)p_start->tv_nsec;
+}
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator, one state per panel.
+ */
+
+static uint64_t rng_next(uint64_t * p_state)
+{
+    *p_state ^= *p_state >> 12;
+    *p_state ^= *p_state << 25;
+    *p_state ^= *p_state >> 27;
+    return *p_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @fn     uniform
+ * @brief  Uniform value in [lo, hi].
+ */
+
+static uint32_t uniform(uint64_t * p_state, uint32_t lo, uint32_t hi)
+{
+    return lo + (uint32_t)((rng_next(p_state) >> 11) % (hi - lo + 1));
+}
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    return virtual_now;
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    return ((p_current->level >> (p_pin->pin - 1)) & 1U) ? 0 : 1;
+}
+
+static void event_callback(button_pressed_types_t type, button_enum button_id)
+{
+    (void)type;
+    (void)button_id;
+    thread_events++;
+}
+
+/**
+ * @fn     step_traffic
+ * @brief  Advance the input of one panel by one scan period.
+ */
+
+static void step_traffic(panel_t * p_panel)
+{
+    uint8_t i = 0;
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        if (0 == --p_panel->countdown[i])
+        {
+            p_panel->level ^= (uint8_t)(1U << i);
+            if (p_panel->level & (1U << i))
+            {
+                p_panel->countdown[i] = (0 == uniform(&p_panel->rng, 0, 9)) ? uniform(&p_panel->rng, 1200, 2000)
+                                                                           : uniform(&p_panel->rng, 50, 250);
+            }
+            else
+            {
+                p_panel->countdown[i] = uniform(&p_panel->rng, 200, 3000);
+            }
+        }
+    }
+}
+
+/**
+ * @fn     scan_chunk
+ * @brief  One scan of every instance in a chunk.
+ */
+
+static void scan_chunk(worker_t * p_worker, uint32_t chunk)
+{
+    uint32_t first = chunk * CHUNK_INSTANCES;
+    uint32_t last = first + CHUNK_INSTANCES;
+    uint32_t i = 0;
+    last = (last < instance_count) ? last : instance_count;
+    for (i=first; i<last; i++)
+    {
+        p_current = &p_panels[i];
+        step_traffic(p_current);
+        button_select_instance(&p_instances[i]);
+        button_process();
+    }
+    p_worker->scans += last - first;
+    p_worker->chunks++;
+}
+
+/**
+ * @fn     take_own
+ * @brief  Take the next chunk from the front of a worker's own range.
+ *
+ * @return 0 and the chunk in *p_chunk, or -1 when the range is empty.
+ */
+
+static int take_own(worker_t * p_worker, uint32_t * p_chunk)
+{
+    uint64_t range = __atomic_load_n(&p_worker->range, __ATOMIC_ACQUIRE);
+    while ((uint32_t)(range >> 32) < (uint32_t)range)
+    {
+        if (__atomic_compare_exchange_n(&p_worker->range, &range, range + (1ULL << 32), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            *p_chunk = (uint32_t)(range >> 32);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @fn     steal
+ * @brief  Take a chunk from the back of another worker's range.
+ *
+ * @return 0 and the chunk in *p_chunk, or -1 when every range is empty.
+ */
+
+static int steal(worker_t * p_thief, uint32_t * p_chunk)
+{
+    uint32_t n = 0;
+    for (n=1; n<worker_count; n++)
+    {
+        worker_t * p_victim = &workers[(p_thief->index + n) % worker_count];
+        uint64_t range = __atomic_load_n(&p_victim->range, __ATOMIC_ACQUIRE);
+        while ((uint32_t)(range >> 32) < (uint32_t)range)
+        {
+            if (__atomic_compare_exchange_n(&p_victim->range, &range, range - 1, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                *p_chunk = (uint32_t)range - 1;
+                p_thief->stolen++;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @fn     worker_main
+ * @brief  Per round: own chunks first, then stolen ones, then wait for the next round.
+ */
+
+static void * worker_main(void * p_arg)
+{
+    worker_t * p_worker = (worker_t *)p_arg;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(p_worker->index % (uint32_t)sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    for (;;)
+    {
+        struct timespec t0;
+        struct timespec t1;
+        uint32_t chunk = 0;
+        pthread_barrier_wait(&round_start);
+        if (!running)
+        {
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        while ((0 == take_own(p_worker, &chunk)) || (0 == steal(p_worker, &chunk)))
+        {
+            scan_chunk(p_worker, chunk);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        p_worker->busy_ns += elapsed_ns(&t0, &t1);
+        p_worker->events = thread_events;
+        pthread_barrier_wait(&round_end);
+    }
+    return NULL;
+}
+
+/**
+ * @fn     setup
+ * @brief  Allocate and initialise every instance and panel.
+ *
+ * @return 0 on success, -1 if memory ran out or the driver rejected the configuration.
+ */
+
+static int setup(uint32_t buttons)
+{
+    uint32_t i = 0;
+    uint8_t b = 0;
+    memset(&api, 0, sizeof(api));
+    for (b=0; b<BUTTON_MAX; b++)
+    {
+        api.button_pins[b].pin = (uint8_t)(b + 1);
+        api.button_pins[b].interrupt_mode = BUTTON_INTERRUPT_MODE_NONE;
+    }
+    api.size_of_buttons = BUTTON_MAX;
+    api.tick_count_in_1us = 1;
+    api.debounce_us = DEBOUNCE_US;
+    api.long_press_us = LONG_PRESS_US;
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_event_callback = event_callback;
+    instance_count = (buttons + BUTTON_MAX - 1) / BUTTON_MAX;
+    chunk_count = (instance_count + CHUNK_INSTANCES - 1) / CHUNK_INSTANCES;
+    p_instances = calloc(instance_count, sizeof(button_instance_t));
+    p_panels = calloc(instance_count, sizeof(panel_t));
+    if ((NULL == p_instances) || (NULL == p_panels))
+    {
+        return -1;
+    }
+    virtual_now = SCAN_PERIOD_US;
+    for (i=0; i<instance_count; i++)
+    {
+        p_panels[i].rng = 0x9E3779B97F4A7C15ULL + (uint64_t)(i + 1) * 0xD1B54A32D192ED03ULL;
+        for (b=0; b<BUTTON_MAX; b++)
+        {
+            p_panels[i].countdown[b] = (uint16_t)uniform(&p_panels[i].rng, 1, 3000);
+        }
+        button_select_instance(&p_instances[i]);
+        if (0 != button_initialize_precomputed(&api, &shared_derived))
+        {
+            return -1;
+        }
+    }
+    button_select_instance(NULL);
+    return 0;
+}
+
+/**
+ * @fn     run
+ * @brief  Scan every instance for the given number of rounds with the given workers.
+ *
+ * @return Wall time in nanoseconds.
+ */
+
+static uint64_t run(uint32_t threads, uint32_t rounds)
+{
+    struct timespec t0;
+    struct timespec t1;
+    uint32_t r = 0;
+    uint32_t w = 0;
+    worker_count = threads;
+    running = 1;
+    memset(workers, 0, sizeof(workers));
+    pthread_barrier_init(&round_start, NULL, threads + 1);
+    pthread_barrier_init(&round_end, NULL, threads + 1);
+    for (w=0; w<threads; w++)
+    {
+        workers[w].index = w;
+        pthread_create(&workers[w].thread, NULL, worker_main, &workers[w]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (r=0; r<rounds; r++)
+    {
+        for (w=0; w<threads; w++)
+        {
+            uint64_t first = (uint64_t)chunk_count * w / threads;
+            uint64_t end = (uint64_t)chunk_count * (w + 1) / threads;
+            __atomic_store_n(&workers[w].range, (first << 32) | end, __ATOMIC_RELEASE);
+        }
+        virtual_now += SCAN_PERIOD_US;
+        pthread_barrier_wait(&round_start);
+        pthread_barrier_wait(&round_end);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    running = 0;
+    pthread_barrier_wait(&round_start);
+    for (w=0; w<threads; w++)
+    {
+        pthread_join(workers[w].thread, NULL);
+    }
+    pthread_barrier_destroy(&round_start);
+    pthread_barrier_destroy(&round_end);
+    return elapsed_ns(&t0, &t1);
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t buttons = 1000000;
+    uint32_t threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t rounds = 1000;
+    uint32_t baseline_rounds = 0;
+    uint64_t wall = 0;
+    uint64_t scans = 0;
+    uint64_t events = 0;
+    double baseline = 0;
+    double throughput = 0;
+    uint32_t w = 0;
+    if (argc > 1)
+    {
+        buttons = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        threads = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        rounds = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+    threads = (threads < 1) ? 1 : ((threads > MAX_WORKERS) ? MAX_WORKERS : threads);
+    baseline_rounds = (rounds / 10 > 0) ? rounds / 10 : 1;
+    if (0 != setup(buttons))
+    {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    printf("%u instances (%u buttons) in %u chunks of %u, %zu bytes per instance, %u rounds of %u us\n",
+           instance_count, instance_count * BUTTON_MAX, chunk_count, CHUNK_INSTANCES,
+           sizeof(button_instance_t), rounds, SCAN_PERIOD_US);
+
+    wall = run(threads, rounds);
+    for (w=0; w<threads; w++)
+    {
+        scans += workers[w].scans;
+        events += workers[w].events;
+    }
+    throughput = (double)scans * BUTTON_MAX / ((double)wall / 1e9);
+    printf("%u threads: %.2f M button scans/s, %.2f M instance scans/s, %.0f events/s, %.1f virtual s in %.2f s\n",
+           threads, throughput / 1e6, (double)scans / ((double)wall / 1e9) / 1e6, (double)events / ((double)wall / 1e9),
+           (double)rounds * SCAN_PERIOD_US / 1e6, (double)wall / 1e9);
+    for (w=0; w<threads; w++)
+    {
+        printf("  worker %3u: %10llu instance scans, %8llu chunks (%llu stolen), %8llu events, busy %.0f%%\n", w,
+               (unsigned long long)workers[w].scans, (unsigned long long)workers[w].chunks,
+               (unsigned long long)workers[w].stolen, (unsigned long long)workers[w].events,
+               100.0 * (double)workers[w].busy_ns / (double)wall);
+    }
+
+    wall = run(1, baseline_rounds);
+    baseline = (double)workers[0].scans * BUTTON_MAX / ((double)wall / 1e9);
+    printf("baseline, 1 thread: %.2f M button scans/s\n", baseline / 1e6);
+    printf("per-core efficiency %.0f%% (speedup %.2f)\n", 100.0 * throughput / threads / baseline, throughput / baseline);
+    free(p_instances);
+    free(p_panels);
+    return 0;
+}
@@ -0,0 +1,385 @@
+/**************************************************
+ * @file    link_loopback.c                       *
+ * @brief   Host check of the remote panel link   *
+ *                                                *
+ * Description:                                   *
+ * Simulates many remote button panels sharing    *
+ * one serial link. A pipe (default) or a pty in  *
+ * raw mode stands in for the UART/RS-485 line.   *
+ * Frames from every panel are parsed back, the   *
+ * events of panel 0 are fed into a local driver  *
+ * instance and the totals are cross-checked.     *
+ * A second pass feeds a receiver directly with   *
+ * corrupted, replayed, skipped and noisy frames  *
+ * in random fragments, and checks every frame    *
+ * delivered and the crc_errors, duplicate_frames *
+ * and lost_frames counters against the faults.   *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module link_loopback.c   *
+ *       ../button_module/button_link.c           *
+ *       ../button_module/button.c -lutil         *
+ *       -o link_loopback                         *
+ * Usage: ./link_loopback [panels] [rounds] [pty] *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pty.h>
+#include <termios.h>
+#include "button.h"
+#include "button_link.h"
+
+#define MAX_PANELS      (4096)
+#define FAULT_NODES     (3)
+#define FAULT_FRAMES    (20000)
+#define FAULT_QUEUE     (64)
+
+typedef struct
+{
+    uint8_t bytes[BUTTON_LINK_MAX_FRAME];
+    uint16_t len;
+} captured_t;
+
+typedef struct
+{
+    uint32_t corrupted;
+    uint32_t replayed;
+    uint32_t skipped;
+    uint32_t noisy;
+    uint32_t delivered;
+    uint32_t expected_delivered;
+    uint32_t expected_lost;
+    uint32_t mismatches;
+} fault_stats_t;
+
+static int write_fd = -1;
+static int read_fd = -1;
+static button_link_tx_t panels[MAX_PANELS];
+static button_link_rx_t receiver;
+static button_api_t local_api;
+static uint64_t sent_events = 0;
+static uint64_t received_events = 0;
+static uint64_t local_events = 0;
+static uint64_t link_bytes = 0;
+static captured_t captured;
+static button_link_rx_t fault_rx;
+static button_link_frame_t expected[FAULT_QUEUE];
+static uint32_t expected_head = 0;
+static uint32_t expected_tail = 0;
+static fault_stats_t faults;
+static uint32_t fault_seed = 7;
+
+static int32_t link_write(const uint8_t * p_data, uint16_t len)
+{
+    uint8_t rx_buf[512];
+    ssize_t n = write(write_fd, p_data, len);
+    ssize_t got = 0;
+    link_bytes += len;
+    while ((n > 0) && (got < n))
+    {
+        ssize_t r = read(read_fd, rx_buf, sizeof(rx_buf));
+        if (r <= 0)
+        {
+            break;
+        }
+        got += r;
+        button_link_rx_feed(&receiver, rx_buf, (uint16_t)r);
+    }
+    return (int32_t)n;
+}
+
+static void on_frame(const button_link_frame_t * p_frame)
+{
+    uint8_t i = 0;
+    received_events += p_frame->count;
+    for (i=0; (0 == p_frame->node_id) && (i<p_frame->count); i++)
+    {
+        button_inject_event((button_pressed_types_t)p_frame->events[i].kind, (button_enum)p_frame->events[i].button);
+    }
+}
+
+static uint32_t fault_random(void)
+{
+    fault_seed ^= fault_seed << 13;
+    fault_seed ^= fault_seed >> 17;
+    fault_seed ^= fault_seed << 5;
+    return fault_seed;
+}
+
+static int32_t capture_write(const uint8_t * p_data, uint16_t len)
+{
+    memcpy(captured.bytes, p_data, len);
+    captured.len = len;
+    return len;
+}
+
+/**
+ * @fn     on_fault_frame
+ * @brief  Check that a frame delivered in the fault pass is the oldest intact frame
+ *         fed and not yet delivered.
+ *
+ * A false candidate may hold frames back, so delivery can lag the feed, but the
+ * order must be kept.
+ */
+
+static void on_fault_frame(const button_link_frame_t * p_frame)
+{
+    const button_link_frame_t * p_expect = &expected[expected_tail % FAULT_QUEUE];
+    uint8_t i = 0;
+    int same = (expected_tail != expected_head) && (p_frame->node_id == p_expect->node_id)
+               && (p_frame->seq == p_expect->seq) && (p_frame->count == p_expect->count)
+               && (p_frame->base_tick == p_expect->base_tick);
+    for (i=0; same && (i<p_frame->count); i++)
+    {
+        same = (p_frame->events[i].kind == p_expect->events[i].kind)
+               && (p_frame->events[i].button == p_expect->events[i].button)
+               && (p_frame->events[i].tick == p_expect->events[i].tick);
+    }
+    expected_tail += (expected_tail != expected_head) ? 1 : 0;
+    faults.delivered++;
+    faults.mismatches += same ? 0 : 1;
+}
+
+/**
+ * @fn     feed_fragmented
+ * @brief  Feed bytes to the fault receiver in random fragments of 1..16 bytes.
+ */
+
+static void feed_fragmented(const uint8_t * p_data, uint16_t len)
+{
+    uint16_t pos = 0;
+    while (pos < len)
+    {
+        uint16_t n = (uint16_t)(1 + fault_random() % 16U);
+        n = (n < (len - pos)) ? n : (uint16_t)(len - pos);
+        button_link_rx_feed(&fault_rx, &p_data[pos], n);
+        pos = (uint16_t)(pos + n);
+    }
+}
+
+/**
+ * @fn     run_faults
+ * @brief  Send frames from a few nodes through a lossy, noisy link.
+ *
+ * Each frame is sent clean, with one bit flipped (CRC-16 catches every single-bit
+ * error), twice, not at all, or after a burst of noise that contains SOF bytes.
+ * Intact frames are queued in send order for on_fault_frame().
+ * A corrupted or skipped frame shows up as a gap at the node's next delivered
+ * frame. Ages range up to 2^31 ticks, so entries use every varint length.
+ *
+ * @return 0 if every count matches, 1 otherwise.
+ */
+
+static int run_faults(void)
+{
+    static button_link_tx_t nodes[FAULT_NODES];
+    static const uint8_t idle[BUTTON_LINK_MAX_FRAME] = {0};
+    uint32_t pending_gap[FAULT_NODES] = {0};
+    uint32_t f = 0;
+    uint8_t n = 0;
+    button_link_rx_init(&fault_rx, on_fault_frame);
+    for (n=0; n<FAULT_NODES; n++)
+    {
+        button_link_tx_init(&nodes[n], n, capture_write);
+    }
+    for (f=0; f<FAULT_FRAMES; f++)
+    {
+        uint8_t node = (uint8_t)(fault_random() % FAULT_NODES);
+        uint32_t now = fault_random();
+        uint32_t events = fault_random() % 6U;
+        uint32_t pick = fault_random() % 100U;
+        uint32_t i = 0;
+        button_link_frame_t * p_frame = &expected[expected_head % FAULT_QUEUE];
+        if ((expected_head - expected_tail) >= FAULT_QUEUE)
+        {
+            printf("fault pass: more than %u frames held back\n", FAULT_QUEUE);
+            return 1;
+        }
+        p_frame->node_id = node;
+        p_frame->seq = nodes[node].seq;
+        p_frame->count = (uint8_t)events;
+        p_frame->base_tick = now;
+        for (i=0; i<events; i++)
+        {
+            button_link_event_t * p_event = &p_frame->events[i];
+            p_event->kind = (uint8_t)(fault_random() % BUTTON_PRESS_TYPE_MAX);
+            p_event->button = (uint8_t)(fault_random() % BUTTON_MAX);
+            p_event->tick = now - (fault_random() >> (fault_random() % 32U));
+            button_link_tx_push(&nodes[node], (button_pressed_types_t)p_event->kind, (button_enum)p_event->button, p_event->tick);
+        }
+        button_link_tx_flush(&nodes[node], now);
+
+        if (pick < 5)
+        {
+            captured.bytes[fault_random() % captured.len] ^= (uint8_t)(1U << (fault_random() % 8U));
+            feed_fragmented(captured.bytes, captured.len);
+            pending_gap[node]++;
+            faults.corrupted++;
+            continue;
+        }
+        if (pick < 10)
+        {
+            pending_gap[node]++;
+            faults.skipped++;
+            continue;
+        }
+        if (pick < 15)
+        {
+            uint8_t noise[24];
+            uint8_t k = 0;
+            for (k=0; k<sizeof(noise); k++)
+            {
+                noise[k] = (0 == (fault_random() % 4U)) ? BUTTON_LINK_SOF : (uint8_t)fault_random();
+            }
+            feed_fragmented(noise, sizeof(noise));
+            faults.noisy++;
+        }
+        expected_head++;
+        feed_fragmented(captured.bytes, captured.len);
+        if (pick >= 95)
+        {
+            feed_fragmented(captured.bytes, captured.len);
+            faults.replayed++;
+        }
+        faults.expected_delivered++;
+        faults.expected_lost += pending_gap[node];
+        pending_gap[node] = 0;
+    }
+    /* An idle line (no SOF) completes any false candidate still holding frames. */
+    feed_fragmented(idle, sizeof(idle));
+
+    printf("fault pass:      %u frames, %u corrupted, %u skipped, %u replayed, %u after noise\n", FAULT_FRAMES,
+           faults.corrupted, faults.skipped, faults.replayed, faults.noisy);
+    printf("                 %u delivered (expected %u, %u altered), %u crc errors, %u lost (expected %u), %u duplicate\n",
+           faults.delivered, faults.expected_delivered, faults.mismatches, fault_rx.crc_errors,
+           fault_rx.lost_frames, faults.expected_lost, fault_rx.duplicate_frames);
+    return ((faults.delivered == faults.expected_delivered) && (0 == faults.mismatches) && (expected_tail == expected_head)
+            && (fault_rx.crc_errors >= faults.corrupted) && (fault_rx.lost_frames == faults.expected_lost)
+            && (fault_rx.duplicate_frames == faults.replayed)) ? 0 : 1;
+}
+
+static void local_event(button_pressed_types_t type, button_enum button_id)
+{
+    (void)type;
+    (void)button_id;
+    local_events++;
+}
+
+static uint32_t local_tick(void)
+{
+    return 1;
+}
+
+static uint32_t local_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static int32_t local_read(pin_config_t * p_pin)
+{
+    (void)p_pin;
+    return 1;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t panel_count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 300;
+    uint32_t rounds = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1000;
+    int use_pty = (argc > 3) && (0 == strcmp(argv[3], "pty"));
+    uint64_t expected_local = 0;
+    uint32_t seed = 1;
+    uint32_t r = 0;
+    uint32_t p = 0;
+    struct timespec t0;
+    struct timespec t1;
+    double seconds = 0;
+
+    if ((0 == panel_count) || (panel_count > MAX_PANELS))
+    {
+        fprintf(stderr, "panels must be 1..%d\n", MAX_PANELS);
+        return 1;
+    }
+    if (use_pty)
+    {
+        struct termios tio;
+        if (0 != openpty(&write_fd, &read_fd, NULL, NULL, NULL))
+        {
+            perror("openpty");
+            return 1;
+        }
+        tcgetattr(read_fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(read_fd, TCSANOW, &tio);
+    }
+    else
+    {
+        int fds[2];
+        if (0 != pipe(fds))
+        {
+            perror("pipe");
+            return 1;
+        }
+        read_fd = fds[0];
+        write_fd = fds[1];
+    }
+
+    local_api.size_of_buttons = BUTTON_MAX;
+    local_api.tick_count_in_1us = 1;
+    local_api.debounce_us = 10000;
+    local_api.long_press_us = 1000000;
+    local_api.fp_tick_elapsed = local_elapsed;
+    local_api.fp_read_button = local_read;
+    local_api.fp_get_current_tick = local_tick;
+    local_api.fp_event_callback = local_event;
+    button_initialize(&local_api);
+    button_link_rx_init(&receiver, on_frame);
+    for (p=0; p<panel_count; p++)
+    {
+        button_link_tx_init(&panels[p], (uint16_t)p, link_write);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (r=0; r<rounds; r++)
+    {
+        uint32_t now = r * 10000U;
+        for (p=0; p<panel_count; p++)
+        {
+            uint32_t n = 0;
+            seed = seed * 1103515245U + 12345U;
+            n = (seed >> 16) % 4;
+            while (n--)
+            {
+                button_pressed_types_t type = (button_pressed_types_t)((seed >> 8) % 3);
+                seed = seed * 1103515245U + 12345U;
+                button_link_tx_push(&panels[p], type, (button_enum)((seed >> 16) % BUTTON_MAX), now - ((seed >> 4) % 10000U));
+                sent_events++;
+                expected_local += (0 == p);
+            }
+            button_link_tx_flush(&panels[p], now);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("link:            %s\n", use_pty ? "pty (raw)" : "pipe");
+    printf("panels:          %u, rounds: %u\n", panel_count, rounds);
+    printf("frames:          %u ok, %u crc errors, %u lost, %u duplicate\n", receiver.frames, receiver.crc_errors,
+           receiver.lost_frames, receiver.duplicate_frames);
+    printf("events:          %llu sent, %llu received, %llu delivered locally (expected %llu)\n",
+           (unsigned long long)sent_events, (unsigned long long)received_events,
+           (unsigned long long)local_events, (unsigned long long)expected_local);
+    printf("bytes/frame:     %.1f\n", (double)link_bytes / ((double)panel_count * rounds));
+    printf("throughput:      %.0f frames/s, %.0f events/s\n",
+           (double)panel_count * rounds / seconds, (double)sent_events / seconds);
+    printf("1 frame/panel/s: %.0f baud needed for %u panels (8N1)\n",
+           (double)link_bytes / rounds * 10.0, panel_count);
+    return ((received_events == sent_events) && (local_events == expected_local) && (0 == receiver.crc_errors)
+            && (0 == run_faults())) ? 0 : 1;
+}
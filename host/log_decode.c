@@ -0,0 +1,117 @@
+/**************************************************
+ * @file    log_decode.c                          *
+ * @brief   Host-side decoder for the driver's    *
+ *          delta-encoded event log               *
+ *                                                *
+ * Description:                                   *
+ * Reads a snapshot produced by                   *
+ * button_log_snapshot(), either as raw binary or *
+ * as hex text (e.g. copied from a serial         *
+ * console), and prints one line per event with   *
+ * its time relative to the newest event.         *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module log_decode.c      *
+ *       ../button_module/button_log.c            *
+ *       -o log_decode                            *
+ * Usage: ./log_decode <snapshot> [ticks_per_us]  *
+ *                                                *
+ **************************************************/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "button_log.h"
+
+#define MAX_SNAPSHOT    (BUTTON_LOG_HEADER_SIZE + 65535)
+
+static const char * const type_names[] = {"NORMAL", "LONG", "DOUBLE", "HOLD1", "HOLD2", "HOLD3", "HOLD4", "TYPE7"};
+static uint8_t snapshot[MAX_SNAPSHOT];
+static uint32_t newest_units = 0;
+static double unit_us = 0;
+
+static void find_newest(button_pressed_types_t type, button_enum button_id, uint32_t time_units)
+{
+    (void)type;
+    (void)button_id;
+    newest_units = time_units;
+}
+
+static void print_record(button_pressed_types_t type, button_enum button_id, uint32_t time_units)
+{
+    uint32_t age = newest_units - time_units;
+    if (unit_us > 0)
+    {
+        printf("%12.3f s  button %d  %s\n", -(double)age * unit_us / 1e6, button_id, type_names[type & 7]);
+    }
+    else
+    {
+        printf("%12d units  button %d  %s\n", -(int32_t)age, button_id, type_names[type & 7]);
+    }
+}
+
+static uint32_t load(const char * p_path)
+{
+    FILE * p_file = fopen(p_path, "rb");
+    static uint8_t raw[MAX_SNAPSHOT * 3];
+    uint32_t len = 0;
+    uint32_t i = 0;
+    uint32_t out = 0;
+    int is_hex = 1;
+    if (NULL == p_file)
+    {
+        return 0;
+    }
+    len = (uint32_t)fread(raw, 1, sizeof(raw), p_file);
+    fclose(p_file);
+    for (i=0; i<len; i++)
+    {
+        if (!isxdigit(raw[i]) && !isspace(raw[i]))
+        {
+            is_hex = 0;
+        }
+    }
+    if (!is_hex)
+    {
+        len = (len < MAX_SNAPSHOT) ? len : MAX_SNAPSHOT;
+        memcpy(snapshot, raw, len);
+        return len;
+    }
+    for (i=0; (i + 1 < len) && (out < MAX_SNAPSHOT); i++)
+    {
+        if (isxdigit(raw[i]) && isxdigit(raw[i + 1]))
+        {
+            char pair[3] = {(char)raw[i], (char)raw[i + 1], 0};
+            snapshot[out++] = (uint8_t)strtoul(pair, NULL, 16);
+            i++;
+        }
+    }
+    return out;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t len = 0;
+    int32_t count = 0;
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <snapshot> [ticks_per_us]\n", argv[0]);
+        return 1;
+    }
+    len = load(argv[1]);
+    count = button_log_decode(snapshot, len, find_newest);
+    if (count < 0)
+    {
+        fprintf(stderr, "%s: not a valid button log snapshot\n", argv[1]);
+        return 1;
+    }
+    if (argc > 2)
+    {
+        unit_us = (double)(1UL << snapshot[5]) / atof(argv[2]);
+    }
+    printf("%d events, %u record bytes, %u ticks per unit\n", count, (unsigned)(snapshot[6] | (snapshot[7] << 8)), 1U << snapshot[5]);
+    button_log_decode(snapshot, len, print_record);
+    return 0;
+}
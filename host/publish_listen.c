@@ -0,0 +1,111 @@
+/**************************************************
+ * @file    publish_listen.c                      *
+ * @brief   Reference subscriber for the event    *
+ *          broadcast                             *
+ *                                                *
+ * Description:                                   *
+ * Receives the datagrams sent by button_publish  *
+ * and prints the events. It decodes the fixed    *
+ * binary layout directly and does not link the   *
+ * driver, as a dashboard or test rig would.      *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 publish_listen.c -o publish_listen   *
+ * Usage: ./publish_listen udp <port>             *
+ *        ./publish_listen unix <path>            *
+ *                                                *
+ **************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static uint32_t get_u32(const uint8_t * p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_u16(const uint8_t * p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+int main(int argc, char ** argv)
+{
+    static const char * const type_names[] = {"NORMAL", "LONG", "DOUBLE", "HOLD1", "HOLD2", "HOLD3", "HOLD4"};
+    uint8_t buf[65536];
+    uint32_t expected_seq = 0;
+    int have_seq = 0;
+    int fd = -1;
+
+    if ((argc == 3) && (0 == strcmp(argv[1], "udp")))
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(argv[2]));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if ((fd < 0) || (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))))
+        {
+            perror("bind");
+            return 1;
+        }
+    }
+    else if ((argc == 3) && (0 == strcmp(argv[1], "unix")))
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, argv[2], sizeof(addr.sun_path) - 1);
+        unlink(argv[2]);
+        fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if ((fd < 0) || (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))))
+        {
+            perror("bind");
+            return 1;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "usage: %s udp <port> | unix <path>\n", argv[0]);
+        return 1;
+    }
+
+    while (1)
+    {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        uint16_t count = 0;
+        uint32_t seq = 0;
+        uint16_t i = 0;
+        if ((len < 16) || (0x454E5442UL != get_u32(buf)) || (1 != get_u16(&buf[4])))
+        {
+            continue;
+        }
+        count = get_u16(&buf[6]);
+        seq = get_u32(&buf[8]);
+        if ((ssize_t)(16 + count * 8) > len)
+        {
+            continue;
+        }
+        if (have_seq && (seq != expected_seq))
+        {
+            printf("-- %u batch(es) dropped by publisher\n", seq - expected_seq);
+        }
+        expected_seq = seq + 1;
+        have_seq = 1;
+        for (i=0; i<count; i++)
+        {
+            const uint8_t * p = &buf[16 + i * 8];
+            printf("tick %10u  button %u  %s\n", get_u32(p), p[4], (p[5] < (sizeof(type_names) / sizeof(type_names[0]))) ? type_names[p[5]] : "?");
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,798 @@
+/**************************************************
+ * @file    soak_runner.c                         *
+ * @brief   Virtual-time soak test of the driver  *
+ *                                                *
+ * Description:                                   *
+ * Simulates days or weeks of button use through  *
+ * the real driver on a virtual 40 MHz tick, so   *
+ * the 32-bit counter wraps every 107 s. Each of  *
+ * the five buttons runs its own script of taps,  *
+ * double taps and long presses with contact      *
+ * bounce, separated by short pauses, bursts      *
+ * where every button fires at once, and idle     *
+ * periods of minutes. The device also sleeps:    *
+ * for up to 50 s in the middle of a              *
+ * multi-press window (resumed through            *
+ * button_notify_time_jump() or the automatic     *
+ * time jump detection) and for hours when idle.  *
+ * Edges and scans are placed exactly on the tick *
+ * wrap now and then.                             *
+ *                                                *
+ * Buttons 0-2 and 4 are polled with edge         *
+ * interpolation; button 3 is interrupt driven    *
+ * with clean edges, since BOTH_EDGES pairs edges *
+ * and cannot take bounce (see README, 17).       *
+ *                                                *
+ * Idle time is skipped: when nothing is pending  *
+ * the clock jumps to one scan period before the  *
+ * next edge, so only active time costs scans.    *
+ *                                                *
+ * Invariants, checked on every event and scan:   *
+ *   - every gesture produces exactly its event   *
+ *     (NORMAL, DOUBLE or LONG) before its        *
+ *     deadline: no lost presses                  *
+ *   - no event without a gesture, no wrong type  *
+ *     (this covers spurious LONG_PRESS)          *
+ *   - at most MAX_BACKLOG gestures per button    *
+ *     wait for their event: bounded queue depth  *
+ *                                                *
+ * Every event is also published through          *
+ * button_publish to a Unix-domain subscriber     *
+ * socket the runner binds itself. The subscriber *
+ * is drained every simulated second, but now and *
+ * then stalls for minutes, so full socket        *
+ * buffers make the publisher drop batches.       *
+ * Received plus dropped events must equal the    *
+ * published ones, and the sequence gaps must     *
+ * equal the dropped batches.                     *
+ *                                                *
+ * Built with the hook trace backend and          *
+ * button_chrome_trace.c, the start of the run is *
+ * also written as a Chrome trace. It spans the   *
+ * first tick wrap and ends before the first gap  *
+ * the exporter cannot order (see trace_before).  *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module soak_runner.c     *
+ *       button_publish.c                         *
+ *       ../button_module/button.c -o soak        *
+ * With a trace:                                  *
+ *   gcc -O2 -DBUTTON_TRACE_BACKEND=2             *
+ *       -I../button_module soak_runner.c         *
+ *       button_publish.c button_chrome_trace.c   *
+ *       ../button_module/button.c -o soak        *
+ * Usage: ./soak [days] [seed] [trace.json]       *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "button.h"
+#include "button_publish.h"
+#include "button_trace.h"
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+#include "button_chrome_trace.h"
+#endif
+
+#define TICKS_PER_US        (40ULL)
+#define US(us)              ((uint64_t)(us) * TICKS_PER_US)
+#define MS(ms)              (US(ms) * 1000ULL)
+#define SEC(s)              (MS(s) * 1000ULL)
+#define WRAP                (1ULL << 32)
+
+#define DEBOUNCE_US         (10000U)
+#define LONG_PRESS_US       (1000000U)
+#define TIME_JUMP_US        (200000U)
+#define SCAN_PERIOD         MS(1)
+#define ISR_BUTTON          (3)
+#define MAX_EDGES           (48)
+#define MAX_BACKLOG         (2)
+#define MAX_REPORTS         (20)
+#define PUBLISH_FLUSH       MS(20)
+#define DRAIN_PERIOD        SEC(1)
+#define TRACE_MAX_GAP       SEC(50)
+
+typedef enum
+{
+    GESTURE_TAP,
+    GESTURE_DOUBLE,
+    GESTURE_LONG,
+} gesture_t;
+
+typedef struct
+{
+    uint64_t at;
+    uint8_t pressed;
+} edge_t;
+
+typedef struct
+{
+    button_pressed_types_t type;
+    uint64_t deadline;
+    uint64_t released;
+} expect_t;
+
+typedef struct
+{
+    edge_t edges[MAX_EDGES];
+    uint8_t edge_count;
+    uint8_t next_edge;
+    uint8_t pressed;
+    button_pressed_types_t script_type;
+    expect_t expect[MAX_BACKLOG + 1];
+    uint8_t expect_count;
+} sim_button_t;
+
+typedef struct
+{
+    uint64_t gestures;
+    uint64_t events;
+    uint64_t edges;
+    uint64_t scans;
+    uint64_t isr_calls;
+    uint64_t wraps;
+    uint64_t wrap_hits;
+    uint64_t sleeps_pending;
+    uint64_t sleeps_idle;
+    uint64_t bursts;
+    uint64_t lost;
+    uint64_t spurious;
+    uint64_t wrong;
+    uint64_t backlog_overflow;
+    uint8_t max_backlog;
+} soak_stats_t;
+
+typedef struct
+{
+    int fd;
+    uint64_t published;
+    uint64_t received;
+    uint64_t datagrams;
+    uint64_t gaps;
+    uint64_t bad;
+    uint64_t stalls;
+    uint32_t next_seq;
+    uint64_t next_drain;
+    uint64_t stall_until;
+    uint32_t rng;                       // own generator, so the gestures do not depend on it
+    struct sockaddr_un addr;
+} subscriber_t;
+
+static button_api_t api;
+static sim_button_t buttons[BUTTON_MAX];
+static soak_stats_t stats;
+static uint64_t now64 = 0;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint32_t reports = 0;
+static button_publish_t pub;
+static subscriber_t sub;
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+static const char * p_trace_path = "soak_trace.json";
+static int trace_written = 0;
+static uint32_t trace_count = 0;
+static uint64_t trace_last_at = 0;
+#endif
+
+static const char * const type_names[] = {"NORMAL", "LONG", "DOUBLE", "HOLD1", "HOLD2", "HOLD3", "HOLD4"};
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator.
+ */
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @fn     uniform
+ * @brief  Uniform value in [lo, hi].
+ */
+
+static uint64_t uniform(uint64_t lo, uint64_t hi)
+{
+    return lo + (rng_next() >> 11) % (hi - lo + 1);
+}
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    return (uint32_t)now64;
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    return buttons[p_pin - api.button_pins].pressed ? 0 : 1;
+}
+
+/**
+ * @fn     fail
+ * @brief  Count an invariant violation and print the first MAX_REPORTS of them.
+ */
+
+static void fail(uint64_t * p_counter, const char * p_what, uint8_t id, const char * p_detail)
+{
+    (*p_counter)++;
+    if (reports++ < MAX_REPORTS)
+    {
+        printf("  FAIL %-9s t=%.6f s (tick 0x%08x) button %u: %s\n",
+               p_what, (double)now64 / SEC(1), (uint32_t)now64, id, p_detail);
+    }
+}
+
+static void event_callback(button_pressed_types_t type, button_enum button_id)
+{
+    sim_button_t * p_btn = &buttons[button_id];
+    char detail[96];
+    stats.events++;
+    sub.published++;
+    button_publish_event(&pub, type, button_id, (uint32_t)now64);
+    if (0 == p_btn->expect_count)
+    {
+        snprintf(detail, sizeof(detail), "%s without a gesture", type_names[type]);
+        fail(&stats.spurious, "spurious", (uint8_t)button_id, detail);
+    }
+    else
+    {
+        if (p_btn->expect[0].type != type)
+        {
+            snprintf(detail, sizeof(detail), "%s for a %s gesture released at %.6f s", type_names[type],
+                     type_names[p_btn->expect[0].type], (double)p_btn->expect[0].released / SEC(1));
+            fail(&stats.wrong, "wrong", (uint8_t)button_id, detail);
+        }
+        p_btn->expect_count--;
+        memmove(&p_btn->expect[0], &p_btn->expect[1], p_btn->expect_count * sizeof(expect_t));
+    }
+}
+
+/**
+ * @fn     add_transition
+ * @brief  Append a level change with 0..4 bounce pulses in its first 3 ms.
+ *
+ * @return Time of the settled level.
+ */
+
+static uint64_t add_transition(sim_button_t * p_btn, uint64_t at, uint8_t pressed, int bouncy)
+{
+    uint8_t pulses = bouncy ? (uint8_t)uniform(0, 4) : 0;
+    uint8_t i = 0;
+    for (i=0; i<pulses; i++)
+    {
+        p_btn->edges[p_btn->edge_count++] = (edge_t){at, pressed};
+        at += uniform(US(50), US(300));
+        p_btn->edges[p_btn->edge_count++] = (edge_t){at, !pressed};
+        at += uniform(US(50), US(300));
+    }
+    p_btn->edges[p_btn->edge_count++] = (edge_t){at, pressed};
+    return at;
+}
+
+/**
+ * @fn     new_script
+ * @brief  Schedule the next gesture of a button, starting no earlier than start.
+ *
+ * Gesture timing stays clear of the driver thresholds (taps <= 250 ms, long
+ * presses >= 1.3 s, second tap within the multi-press window) so each gesture
+ * has exactly one correct outcome. Now and then the first edge is moved onto
+ * the next tick wrap.
+ */
+
+static void new_script(uint8_t id, uint64_t start)
+{
+    sim_button_t * p_btn = &buttons[id];
+    int bouncy = (ISR_BUTTON != id);
+    uint64_t t = start;
+    gesture_t gesture = (gesture_t)uniform(0, 9);
+    gesture = (gesture < 6) ? GESTURE_TAP : ((gesture < 8) ? GESTURE_DOUBLE : GESTURE_LONG);
+    if (0 == uniform(0, 15))
+    {
+        uint64_t wrap_at = (t + WRAP - 1) & ~(WRAP - 1);
+        if (wrap_at - t < SEC(120))
+        {
+            t = wrap_at;
+        }
+    }
+    p_btn->edge_count = 0;
+    p_btn->next_edge = 0;
+    switch (gesture)
+    {
+        case GESTURE_TAP:
+            t = add_transition(p_btn, t, 1, bouncy) + uniform(MS(40), MS(250));
+            add_transition(p_btn, t, 0, bouncy);
+            p_btn->script_type = BUTTON_NORMAL_PRESS;
+            break;
+        case GESTURE_DOUBLE:
+            t = add_transition(p_btn, t, 1, bouncy) + uniform(MS(40), MS(120));
+            t = add_transition(p_btn, t, 0, bouncy) + uniform(MS(60), MS(150));
+            t = add_transition(p_btn, t, 1, bouncy) + uniform(MS(40), MS(120));
+            add_transition(p_btn, t, 0, bouncy);
+            p_btn->script_type = BUTTON_DOUBLE_PRESS;
+            break;
+        default:
+            t = add_transition(p_btn, t, 1, bouncy) + uniform(MS(1300), MS(4000));
+            add_transition(p_btn, t, 0, bouncy);
+            p_btn->script_type = BUTTON_LONG_PRESS;
+            break;
+    }
+}
+
+/**
+ * @fn     next_gap
+ * @brief  Pause before a button's next gesture: mostly seconds, sometimes an idle period.
+ */
+
+static uint64_t next_gap(void)
+{
+    uint64_t gap = MS(700) + uniform(0, SEC(8));
+    if (0 == uniform(0, 99))
+    {
+        gap = uniform(SEC(60), SEC(1800));
+    }
+    return gap;
+}
+
+/**
+ * @fn     finish_gesture
+ * @brief  The last edge of a script was applied: expect its event and schedule the next.
+ */
+
+static void finish_gesture(uint8_t id)
+{
+    sim_button_t * p_btn = &buttons[id];
+    uint64_t released = p_btn->edges[p_btn->edge_count - 1].at;
+    expect_t * p_exp = &p_btn->expect[p_btn->expect_count];
+    /* NORMAL/DOUBLE wait out the multi-press window after being counted. */
+    uint64_t latency = US(DEBOUNCE_US) + ((BUTTON_LONG_PRESS == p_btn->script_type) ? 0 : US(BUTTON_MULTI_PRESS_US)) + MS(10);
+    stats.gestures++;
+    if (p_btn->expect_count >= MAX_BACKLOG)
+    {
+        fail(&stats.backlog_overflow, "backlog", id, "too many gestures waiting for their event");
+    }
+    else
+    {
+        p_exp->type = p_btn->script_type;
+        p_exp->released = released;
+        p_exp->deadline = released + latency;
+        p_btn->expect_count++;
+        if (p_btn->expect_count > stats.max_backlog)
+        {
+            stats.max_backlog = p_btn->expect_count;
+        }
+    }
+    new_script(id, released + next_gap());
+}
+
+/**
+ * @fn     apply_edges
+ * @brief  Apply every scripted edge of a button up to now; ISR buttons get button_isr().
+ */
+
+static void apply_edges(uint8_t id)
+{
+    sim_button_t * p_btn = &buttons[id];
+    while ((p_btn->next_edge < p_btn->edge_count) && (p_btn->edges[p_btn->next_edge].at <= now64))
+    {
+        uint8_t pressed = p_btn->edges[p_btn->next_edge].pressed;
+        p_btn->next_edge++;
+        stats.edges++;
+        if (pressed != p_btn->pressed)
+        {
+            p_btn->pressed = pressed;
+            if (ISR_BUTTON == id)
+            {
+                stats.isr_calls++;
+                button_isr(&api.button_pins[id]);
+            }
+        }
+        if (p_btn->next_edge == p_btn->edge_count)
+        {
+            finish_gesture(id);
+        }
+    }
+}
+
+/**
+ * @fn     check_deadlines
+ * @brief  Report and drop expectations whose deadline passed.
+ */
+
+static void check_deadlines(void)
+{
+    uint8_t id = 0;
+    char detail[96];
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        sim_button_t * p_btn = &buttons[id];
+        while ((0 != p_btn->expect_count) && (now64 > p_btn->expect[0].deadline))
+        {
+            snprintf(detail, sizeof(detail), "%s released at %.6f s never reported",
+                     type_names[p_btn->expect[0].type], (double)p_btn->expect[0].released / SEC(1));
+            fail(&stats.lost, "lost", id, detail);
+            p_btn->expect_count--;
+            memmove(&p_btn->expect[0], &p_btn->expect[1], p_btn->expect_count * sizeof(expect_t));
+        }
+    }
+}
+
+/**
+ * @fn     shift_all
+ * @brief  Move every script and deadline later by delta, e.g. across a sleep.
+ */
+
+static void shift_all(uint64_t delta)
+{
+    uint8_t id = 0;
+    uint8_t i = 0;
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        for (i=buttons[id].next_edge; i<buttons[id].edge_count; i++)
+        {
+            buttons[id].edges[i].at += delta;
+        }
+        for (i=0; i<buttons[id].expect_count; i++)
+        {
+            buttons[id].expect[i].released += delta;
+            buttons[id].expect[i].deadline += delta;
+        }
+    }
+}
+
+/**
+ * @fn     mid_gesture
+ * @brief  Whether any button is pressed or between the edges of a gesture.
+ */
+
+static int mid_gesture(void)
+{
+    uint8_t id = 0;
+    int busy = 0;
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        busy |= buttons[id].pressed || (0 != buttons[id].next_edge);
+    }
+    return busy;
+}
+
+/**
+ * @fn     next_edge_at
+ * @brief  Earliest pending scripted edge over all buttons (or only the ISR button).
+ */
+
+static uint64_t next_edge_at(int isr_only)
+{
+    uint64_t at = UINT64_MAX;
+    uint8_t id = 0;
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        const sim_button_t * p_btn = &buttons[id];
+        if (((!isr_only) || (ISR_BUTTON == id)) && (p_btn->next_edge < p_btn->edge_count)
+            && (p_btn->edges[p_btn->next_edge].at < at))
+        {
+            at = p_btn->edges[p_btn->next_edge].at;
+        }
+    }
+    return at;
+}
+
+/**
+ * @fn     sleep_device
+ * @brief  Stop scanning for a while with the tick running, then resume.
+ *
+ * With a multi-press window open the sleep stays below half a tick wrap, the
+ * longest discontinuity the 32-bit tick can express, and the driver is told
+ * either explicitly or through the time jump detection. Idle sleeps last hours.
+ */
+
+static void sleep_device(uint64_t * p_next_scan)
+{
+    int pending = 0;
+    uint64_t duration = 0;
+    uint8_t id = 0;
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        pending |= (0 != buttons[id].expect_count);
+    }
+    duration = pending ? uniform(SEC(1), SEC(50)) : uniform(SEC(60), SEC(2 * 3600));
+    stats.sleeps_pending += (uint64_t)pending;
+    stats.sleeps_idle += (uint64_t)!pending;
+    now64 += duration;
+    shift_all(duration);
+    if (pending && (0 != (rng_next() & 1)))
+    {
+        button_notify_time_jump((uint32_t)duration);
+    }
+    *p_next_scan = now64;
+}
+
+/**
+ * @fn     open_subscriber
+ * @brief  Bind the subscriber socket and point the publisher at it.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+
+static int open_subscriber(void)
+{
+    int ret = -1;
+    memset(&sub, 0, sizeof(sub));
+    sub.rng = 1;
+    sub.addr.sun_family = AF_UNIX;
+    snprintf(sub.addr.sun_path, sizeof(sub.addr.sun_path), "/tmp/soak_publish.%d", (int)getpid());
+    unlink(sub.addr.sun_path);
+    sub.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((sub.fd >= 0) && (0 == bind(sub.fd, (const struct sockaddr *)&sub.addr, sizeof(sub.addr))))
+    {
+        ret = button_publish_open_unix(&pub, sub.addr.sun_path, (uint32_t)PUBLISH_FLUSH);
+    }
+    return ret;
+}
+
+/**
+ * @fn     drain_subscriber
+ * @brief  Read and check every queued datagram, unless the subscriber is stalled.
+ *
+ * Once a simulated hour on average the subscriber stops reading for 5 to 30
+ * minutes, longer than the socket queue lasts at about one event per second.
+ *
+ * @param  force  Drain even while stalled (at the end of the run).
+ */
+
+static void drain_subscriber(int force)
+{
+    uint8_t datagram[BUTTON_PUBLISH_MAX_DATAGRAM];
+    ssize_t len = 0;
+    if ((!force) && ((now64 < sub.next_drain) || (now64 < sub.stall_until)))
+    {
+        return;
+    }
+    sub.next_drain = now64 + DRAIN_PERIOD;
+    sub.rng ^= sub.rng << 13;
+    sub.rng ^= sub.rng >> 17;
+    sub.rng ^= sub.rng << 5;
+    if ((!force) && (0 == (sub.rng % 3600U)))
+    {
+        sub.stall_until = now64 + SEC(300 + (sub.rng >> 12) % 1500U);
+        sub.stalls++;
+    }
+    while ((len = recv(sub.fd, datagram, sizeof(datagram), MSG_DONTWAIT)) > 0)
+    {
+        uint32_t magic = (uint32_t)datagram[0] | ((uint32_t)datagram[1] << 8) | ((uint32_t)datagram[2] << 16)
+                         | ((uint32_t)datagram[3] << 24);
+        uint16_t count = (uint16_t)(datagram[6] | (datagram[7] << 8));
+        uint32_t seq = (uint32_t)datagram[8] | ((uint32_t)datagram[9] << 8) | ((uint32_t)datagram[10] << 16)
+                       | ((uint32_t)datagram[11] << 24);
+        if ((len < BUTTON_PUBLISH_HEADER_SIZE) || (BUTTON_PUBLISH_MAGIC != magic) || (0 == count)
+            || (len != (ssize_t)(BUTTON_PUBLISH_HEADER_SIZE + count * BUTTON_PUBLISH_EVENT_SIZE)))
+        {
+            sub.bad++;
+            continue;
+        }
+        sub.gaps += seq - sub.next_seq;
+        sub.next_seq = seq + 1;
+        sub.datagrams++;
+        sub.received += count;
+    }
+}
+
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+/**
+ * @fn     trace_before
+ * @brief  End the trace before the clock moves too far past its last record.
+ *
+ * The exporter places each record on the timeline from its 32-bit tick relative
+ * to the previous record, which holds while records are less than 2^31 ticks
+ * (53 s) apart. Before the clock moves TRACE_MAX_GAP past the last record, e.g.
+ * into an idle period or a sleep, the trace is written and recording stops.
+ *
+ * @param  next  Time the clock is about to move to; UINT64_MAX at the end of the run.
+ */
+
+static void trace_before(uint64_t next)
+{
+    uint32_t count = button_chrome_trace_count();
+    if (0 != trace_written)
+    {
+        return;
+    }
+    if (count != trace_count)
+    {
+        trace_count = count;
+        trace_last_at = now64;
+    }
+    if ((0 != trace_count) && ((next - trace_last_at) >= TRACE_MAX_GAP))
+    {
+        trace_written = button_chrome_trace_write(p_trace_path);
+        trace_written = (0 == trace_written) ? -1 : trace_written;
+        button_chrome_trace_close();
+    }
+}
+#endif
+
+int main(int argc, char ** argv)
+{
+    double days = 7.0;
+    uint64_t end = 0;
+    uint64_t next_scan = 0;
+    uint64_t next_sleep = 0;
+    uint64_t next_burst = 0;
+    uint64_t last_wrap = 0;
+    uint8_t id = 0;
+    struct timespec t0;
+    struct timespec t1;
+    double wall = 0;
+    if (argc > 1)
+    {
+        days = atof(argv[1]);
+    }
+    if (argc > 2)
+    {
+        rng_state += strtoull(argv[2], NULL, 0) * 0xD1B54A32D192ED03ULL;
+        rng_state = (0 != rng_state) ? rng_state : 1;
+    }
+    memset(&api, 0, sizeof(api));
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        api.button_pins[id].pin = (uint8_t)(10 + id);
+        api.button_pins[id].interrupt_mode = (ISR_BUTTON == id) ? BUTTON_INTERRUPT_MODE_BOTH_EDGES : BUTTON_INTERRUPT_MODE_NONE;
+    }
+    api.size_of_buttons = BUTTON_MAX;
+    api.tick_count_in_1us = (uint32_t)TICKS_PER_US;
+    api.debounce_us = DEBOUNCE_US;
+    api.long_press_us = LONG_PRESS_US;
+    api.time_jump_us = TIME_JUMP_US;
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_event_callback = event_callback;
+    api.poll_interpolation = 1;
+    if (0 != button_initialize(&api))
+    {
+        fprintf(stderr, "driver rejected the soak configuration\n");
+        return 1;
+    }
+    if (0 != open_subscriber())
+    {
+        perror("publish socket");
+        return 1;
+    }
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+    p_trace_path = (argc > 3) ? argv[3] : p_trace_path;
+    button_chrome_trace_init(&api);
+#endif
+    now64 = WRAP - SEC(30);
+    end = now64 + (uint64_t)(days * 86400.0 * SEC(1));
+    for (id=0; id<BUTTON_MAX; id++)
+    {
+        new_script(id, now64 + uniform(MS(100), SEC(3)));
+    }
+    next_scan = now64;
+    next_sleep = now64 + uniform(SEC(600), SEC(3600));
+    next_burst = now64 + uniform(SEC(60), SEC(600));
+    last_wrap = now64 >> 32;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (now64 < end)
+    {
+        uint64_t isr_at = next_edge_at(1);
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+        trace_before((isr_at < next_scan) ? isr_at : next_scan);
+#endif
+        if (isr_at < next_scan)
+        {
+            now64 = isr_at;
+            apply_edges(ISR_BUTTON);
+            continue;
+        }
+        now64 = next_scan;
+        if ((now64 >> 32) != last_wrap)
+        {
+            stats.wraps += (now64 >> 32) - last_wrap;
+            last_wrap = now64 >> 32;
+        }
+        stats.wrap_hits += (0 == (uint32_t)now64);
+        for (id=0; id<BUTTON_MAX; id++)
+        {
+            if (ISR_BUTTON != id)
+            {
+                apply_edges(id);
+            }
+        }
+        stats.scans++;
+        button_process();
+        button_publish_poll(&pub, (uint32_t)now64);
+        drain_subscriber(0);
+        check_deadlines();
+        if ((now64 >= next_burst) && !mid_gesture())
+        {
+            uint64_t at = now64 + MS(200);
+            for (id=0; id<BUTTON_MAX; id++)
+            {
+                uint64_t earliest = (0 != buttons[id].expect_count) ? buttons[id].expect[0].released + MS(700) : at;
+                new_script(id, ((earliest > at) ? earliest : at) + uniform(0, MS(20)));
+            }
+            stats.bursts++;
+            next_burst = now64 + uniform(SEC(60), SEC(1800));
+        }
+        if ((now64 >= next_sleep) && !mid_gesture())
+        {
+            sleep_device(&next_scan);
+            next_sleep = next_scan + uniform(SEC(600), SEC(7200));
+            continue;
+        }
+        next_scan = now64 + SCAN_PERIOD + uniform(0, US(500)) - US(250);
+        if ((0 == button_get_pressed_mask()) && !mid_gesture())
+        {
+            uint8_t waiting = 0;
+            for (id=0; id<BUTTON_MAX; id++)
+            {
+                waiting |= (0 != buttons[id].expect_count);
+            }
+            if (!waiting)
+            {
+                uint64_t edge_at = next_edge_at(0);
+                if ((edge_at != UINT64_MAX) && (edge_at > next_scan + SCAN_PERIOD))
+                {
+                    next_scan = edge_at - SCAN_PERIOD;
+                }
+            }
+        }
+        if ((next_scan >> 32) != (now64 >> 32) && (0 != (rng_next() & 1)))
+        {
+            next_scan &= ~(WRAP - 1);
+        }
+    }
+    button_publish_flush(&pub, (uint32_t)now64);
+    drain_subscriber(1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    wall = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("simulated %.2f days in %.2f s (%.0fx real time)\n", days, wall, days * 86400.0 / wall);
+    printf("  %llu gestures, %llu events, %llu edges, %llu scans, %llu ISR calls: %.2f M edges+scans/s\n",
+           (unsigned long long)stats.gestures, (unsigned long long)stats.events, (unsigned long long)stats.edges,
+           (unsigned long long)stats.scans, (unsigned long long)stats.isr_calls,
+           (double)(stats.edges + stats.scans) / wall / 1e6);
+    printf("  %llu tick wraps (%llu scans exactly on 0), %llu sleeps in a multi-press window, %llu idle sleeps, %llu bursts\n",
+           (unsigned long long)stats.wraps, (unsigned long long)stats.wrap_hits, (unsigned long long)stats.sleeps_pending,
+           (unsigned long long)stats.sleeps_idle, (unsigned long long)stats.bursts);
+    printf("  lost %llu, spurious %llu, wrong type %llu, backlog overflow %llu, max backlog %u\n",
+           (unsigned long long)stats.lost, (unsigned long long)stats.spurious, (unsigned long long)stats.wrong,
+           (unsigned long long)stats.backlog_overflow, stats.max_backlog);
+    printf("  published %llu events in %llu datagrams (%.2f per datagram); %u batches (%u events) dropped during %llu stalls\n",
+           (unsigned long long)sub.published, (unsigned long long)(sub.datagrams + pub.dropped_batches),
+           (double)sub.published / (double)(sub.datagrams + pub.dropped_batches + (0 == sub.datagrams + pub.dropped_batches)),
+           pub.dropped_batches, pub.dropped_events, (unsigned long long)sub.stalls);
+    printf("  received %llu events, %llu sequence gaps, %llu malformed datagrams\n",
+           (unsigned long long)sub.received, (unsigned long long)sub.gaps, (unsigned long long)sub.bad);
+    button_publish_close(&pub);
+    close(sub.fd);
+    unlink(sub.addr.sun_path);
+#if (BUTTON_TRACE_BACKEND == BUTTON_TRACE_BACKEND_HOOK)
+    trace_before(UINT64_MAX);
+    if (trace_written < 0)
+    {
+        printf("  FAIL trace: cannot write %s\n", p_trace_path);
+        return 1;
+    }
+    printf("  trace: %d records over the first %.1f s written to %s (%u dropped once the buffer was full)\n",
+           trace_written, (double)(trace_last_at - (WRAP - SEC(30))) / SEC(1), p_trace_path, button_chrome_trace_dropped());
+#endif
+    if ((sub.received + pub.dropped_events != sub.published) || (sub.gaps != pub.dropped_batches) || (0 != sub.bad))
+    {
+        printf("  FAIL publish: received and dropped events or batches do not add up\n");
+        return 1;
+    }
+    return (0 == (stats.lost + stats.spurious + stats.wrong + stats.backlog_overflow)) ? 0 : 1;
+}
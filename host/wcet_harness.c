@@ -0,0 +1,675 @@
+/**************************************************
+ * @file    wcet_harness.c                        *
+ * @brief   Searches for inputs that maximise the *
+ *          execution time of the driver          *
+ *                                                *
+ * Description:                                   *
+ * Replays input traces against the real driver   *
+ * on a virtual clock and measures every          *
+ * button_process() and button_isr() call. A      *
+ * trace is a list of steps: advance the clock,   *
+ * set the level of all buttons, fire the ISR of  *
+ * some of them, then scan. Three generators look *
+ * for the worst trace:                           *
+ *   - exhaustive: every trace of a few steps     *
+ *     over a small alphabet of levels and of     *
+ *     clock advances placed on the debounce,     *
+ *     multi-press, long press and time jump      *
+ *     boundaries                                 *
+ *   - random: long random traces                 *
+ *   - guided: mutation search starting from the  *
+ *     worst traces found so far                  *
+ * Traces are ranked by a deterministic cost (the *
+ * number of calls the driver makes through its   *
+ * function pointers plus emitted events), which  *
+ * follows the executed path, and the worst ones  *
+ * are re-measured in cycles: the minimum over    *
+ * many replays, i.e. the path cost without       *
+ * preemption or cold-cache noise. Add margin for *
+ * those, and confirm on the target with          *
+ * BUTTON_CYCLE_STATS.                            *
+ * Both initialization paths are timed first:     *
+ * button_initialize() and                        *
+ * button_initialize_precomputed() with a table   *
+ * for the same configuration (build with         *
+ * -DBUTTON_VERIFY_PRECOMPUTED=1 to time the full *
+ * check).                                        *
+ *                                                *
+ * Build (Linux):                                 *
+ *   gcc -O2 -I../button_module wcet_harness.c    *
+ *       ../button_module/button.c -o wcet        *
+ * Usage: ./wcet [iterations] [seed]              *
+ *                                                *
+ **************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "button.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define MAX_STEPS           (48)
+#define RANDOM_STEPS        (32)
+#define EXHAUSTIVE_STEPS    (3)
+#define KEEP_BEST           (8)
+#define MEASURE_REPS        (200)
+
+#define DEBOUNCE_US         (10000U)
+#define LONG_PRESS_US       (1000000U)
+#define TIME_JUMP_US        (2000000U)
+#define ALL_BUTTONS         ((1U << BUTTON_MAX) - 1U)
+#define HOLD_TICKS          { BUTTON_US_TO_TICK(1, BUTTON_MULTI_PRESS_US), BUTTON_US_TO_TICK(1, LONG_PRESS_US) }
+
+typedef struct
+{
+    uint32_t delta;         // ticks to advance before the step
+    uint8_t level;          // bit n = button n pressed
+    uint8_t isr;            // bit n = run button_isr() for button n
+} step_t;
+
+typedef struct
+{
+    step_t steps[MAX_STEPS];
+    uint8_t len;
+} trace_t;
+
+typedef struct
+{
+    uint32_t ops;           // worst single call
+    uint8_t step;           // step of the worst call
+    uint64_t cycles;        // worst single call, min over replays
+    uint8_t cycles_step;
+} worst_t;
+
+typedef struct
+{
+    worst_t process;
+    worst_t isr;
+} result_t;
+
+typedef struct
+{
+    trace_t trace;
+    result_t result;
+} candidate_t;
+
+static button_api_t api;
+static uint32_t virtual_now = 0;
+static uint8_t virtual_level = 0;
+static uint32_t op_count = 0;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static candidate_t best_process[KEEP_BEST];
+static candidate_t best_isr[KEEP_BEST];
+static uint64_t traces_run = 0;
+
+/* Clock advances on and around every threshold the driver compares against. */
+static const uint32_t boundary_deltas[] =
+{
+    1,
+    DEBOUNCE_US, DEBOUNCE_US + 1,
+    BUTTON_MULTI_PRESS_US, BUTTON_MULTI_PRESS_US + 1,
+    LONG_PRESS_US + 1,
+    TIME_JUMP_US + 1,
+};
+#define BOUNDARY_COUNT  (sizeof(boundary_deltas) / sizeof(boundary_deltas[0]))
+
+/* What button_initialize() derives from setup_api(), evaluated by the compiler. */
+static const button_derived_t derived =
+{
+    BUTTON_DERIVED_FIELDS(1, DEBOUNCE_US, LONG_PRESS_US, TIME_JUMP_US),
+    .hold_tick = { HOLD_TICKS, HOLD_TICKS, HOLD_TICKS, HOLD_TICKS, HOLD_TICKS },
+    .pin_slot = { [18] = 5 },
+};
+
+/* Level patterns for the exhaustive search: none, all, and two interleavings. */
+static const uint8_t small_levels[] = {0x00, ALL_BUTTONS, 0x15, 0x0A};
+
+/**
+ * @fn     cycles_now
+ * @brief  Serialized time stamp counter on x86, nanoseconds elsewhere.
+ */
+
+static inline uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t t = 0;
+    _mm_lfence();
+    t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @fn     rng_seed
+ * @brief  Derive the xorshift state from a user seed.
+ *
+ * The seed is spread with a multiplier other than the default state's, so no
+ * seed cancels the state to 0, where xorshift would only ever return 0.
+ *
+ * @param  seed  Seed from the command line.
+ */
+
+static void rng_seed(uint64_t seed)
+{
+    rng_state = 0x9E3779B97F4A7C15ULL + seed * 0xD1B54A32D192ED03ULL;
+    rng_state = (0 != rng_state) ? rng_state : 1;
+}
+
+/**
+ * @fn     rng_next
+ * @brief  xorshift64* pseudo random generator.
+ */
+
+static uint32_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t tick_elapsed(uint32_t start, uint32_t end)
+{
+    op_count++;
+    return end - start;
+}
+
+static uint32_t get_current_tick(void)
+{
+    op_count++;
+    return virtual_now;
+}
+
+static int32_t read_button(pin_config_t * p_pin)
+{
+    uint8_t i = 0;
+    op_count++;
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        if (&api.button_pins[i] == p_pin)
+        {
+            break;
+        }
+    }
+    /* Active low: pressed reads 0. */
+    return (0 != (virtual_level & (1U << i))) ? 0 : 1;
+}
+
+static void event_callback(button_pressed_types_t type, button_enum button_id)
+{
+    (void)type;
+    (void)button_id;
+    op_count++;
+}
+
+/**
+ * @fn     setup_api
+ * @brief  Five buttons covering every scan path: two polled with interpolation,
+ *         one per interrupt mode, and two pins above the lookup table so the ISR
+ *         also takes the linear search.
+ */
+
+static void setup_api(void)
+{
+    static const uint8_t pins[BUTTON_MAX] = {4, 5, BUTTON_PIN_LUT_SIZE + 6, BUTTON_PIN_LUT_SIZE + 7, 18};
+    static const button_interrupt_mode_t modes[BUTTON_MAX] =
+    {
+        BUTTON_INTERRUPT_MODE_NONE, BUTTON_INTERRUPT_MODE_NONE, BUTTON_INTERRUPT_MODE_BOTH_EDGES,
+        BUTTON_INTERRUPT_MODE_RISING_EDGE, BUTTON_INTERRUPT_MODE_FALLING_EDGE,
+    };
+    uint8_t i = 0;
+    memset(&api, 0, sizeof(api));
+    for (i=0; i<BUTTON_MAX; i++)
+    {
+        api.button_pins[i].pin = pins[i];
+        api.button_pins[i].interrupt_mode = modes[i];
+        /* Hold levels on thresholds the boundary deltas already hit. */
+        api.button_pins[i].hold_us[0] = BUTTON_MULTI_PRESS_US;
+        api.button_pins[i].hold_us[1] = LONG_PRESS_US;
+    }
+    api.size_of_buttons = BUTTON_MAX;
+    api.poll_interpolation = 1;
+    api.tick_count_in_1us = 1;
+    api.debounce_us = DEBOUNCE_US;
+    api.long_press_us = LONG_PRESS_US;
+    api.time_jump_us = TIME_JUMP_US;
+    api.fp_tick_elapsed = tick_elapsed;
+    api.fp_read_button = read_button;
+    api.fp_get_current_tick = get_current_tick;
+    api.fp_event_callback = event_callback;
+}
+
+/**
+ * @fn     time_init
+ * @brief  Time both initialization paths over MEASURE_REPS calls each.
+ *
+ * @return 0, or -1 if either path rejects the configuration.
+ */
+
+static int time_init(void)
+{
+    uint64_t full_min = UINT64_MAX;
+    uint64_t full_sum = 0;
+    uint64_t pre_min = UINT64_MAX;
+    uint64_t pre_sum = 0;
+    uint32_t rep = 0;
+    int ret = 0;
+    for (rep=0; rep<MEASURE_REPS; rep++)
+    {
+        uint64_t t0 = cycles_now();
+        uint64_t t1 = 0;
+        uint64_t t2 = 0;
+        ret |= button_initialize(&api);
+        t1 = cycles_now();
+        ret |= button_initialize_precomputed(&api, &derived);
+        t2 = cycles_now();
+        full_min = ((t1 - t0) < full_min) ? (t1 - t0) : full_min;
+        full_sum += t1 - t0;
+        pre_min = ((t2 - t1) < pre_min) ? (t2 - t1) : pre_min;
+        pre_sum += t2 - t1;
+    }
+    if (0 == ret)
+    {
+        printf("init: button_initialize() min %llu mean %llu, button_initialize_precomputed() min %llu mean %llu cycles%s\n",
+               (unsigned long long)full_min, (unsigned long long)(full_sum / MEASURE_REPS),
+               (unsigned long long)pre_min, (unsigned long long)(pre_sum / MEASURE_REPS),
+               (BUTTON_VERIFY_PRECOMPUTED > 0) ? " (verified)" : "");
+    }
+    return (0 == ret) ? 0 : -1;
+}
+
+/**
+ * @fn     note_worst
+ * @brief  Keep the largest per-call op count together with its step (first replay only).
+ */
+
+static void note_worst(worst_t * p_worst, uint32_t ops, uint8_t step, int first_rep)
+{
+    if (first_rep && (ops > p_worst->ops))
+    {
+        p_worst->ops = ops;
+        p_worst->step = step;
+    }
+}
+
+/**
+ * @fn     run_trace
+ * @brief  Replay a trace reps times from a fresh driver state.
+ *
+ * The op counts are identical on every replay. Cycle counts are kept per call as
+ * the minimum over the replays, then the worst call is reported.
+ *
+ * @param  p_trace   Trace to replay.
+ * @param  reps      Number of replays; 1 gives exact op counts but noisy cycles.
+ * @param  p_result  Receives the worst process and ISR calls.
+ */
+
+static void run_trace(const trace_t * p_trace, uint32_t reps, result_t * p_result)
+{
+    static uint64_t process_min[MAX_STEPS];
+    static uint64_t isr_min[MAX_STEPS];
+    uint32_t rep = 0;
+    uint8_t s = 0;
+    uint8_t b = 0;
+    memset(p_result, 0, sizeof(*p_result));
+    for (s=0; s<p_trace->len; s++)
+    {
+        process_min[s] = UINT64_MAX;
+        isr_min[s] = 0;
+    }
+    for (rep=0; rep<reps; rep++)
+    {
+        virtual_now = 1000;
+        virtual_level = 0;
+        button_initialize(&api);
+        for (s=0; s<p_trace->len; s++)
+        {
+            const step_t * p_step = &p_trace->steps[s];
+            uint64_t isr_worst = 0;
+            uint64_t t0 = 0;
+            uint64_t t1 = 0;
+            virtual_now += p_step->delta;
+            virtual_level = p_step->level;
+            for (b=0; b<BUTTON_MAX; b++)
+            {
+                if (0 != (p_step->isr & (1U << b)))
+                {
+                    op_count = 0;
+                    t0 = cycles_now();
+                    button_isr(&api.button_pins[b]);
+                    t1 = cycles_now();
+                    note_worst(&p_result->isr, op_count, s, (0 == rep));
+                    isr_worst = ((t1 - t0) > isr_worst) ? (t1 - t0) : isr_worst;
+                }
+            }
+            if ((0 == rep) || (isr_worst < isr_min[s]))
+            {
+                isr_min[s] = isr_worst;
+            }
+            op_count = 0;
+            t0 = cycles_now();
+            button_process();
+            t1 = cycles_now();
+            note_worst(&p_result->process, op_count, s, (0 == rep));
+            if ((t1 - t0) < process_min[s])
+            {
+                process_min[s] = t1 - t0;
+            }
+        }
+    }
+    for (s=0; s<p_trace->len; s++)
+    {
+        if (process_min[s] > p_result->process.cycles)
+        {
+            p_result->process.cycles = process_min[s];
+            p_result->process.cycles_step = s;
+        }
+        if (isr_min[s] > p_result->isr.cycles)
+        {
+            p_result->isr.cycles = isr_min[s];
+            p_result->isr.cycles_step = s;
+        }
+    }
+    traces_run++;
+}
+
+/**
+ * @fn     offer
+ * @brief  Insert a trace into a best-of list ordered by op count, then cycles.
+ *
+ * @return 1 if the trace entered the list.
+ */
+
+static int offer(candidate_t * p_list, const trace_t * p_trace, const result_t * p_result, int use_isr)
+{
+    const worst_t * p_new = use_isr ? &p_result->isr : &p_result->process;
+    int slot = -1;
+    int i = 0;
+    for (i=0; i<KEEP_BEST; i++)
+    {
+        const worst_t * p_old = use_isr ? &p_list[i].result.isr : &p_list[i].result.process;
+        if ((p_new->ops > p_old->ops) || ((p_new->ops == p_old->ops) && (p_new->cycles > p_old->cycles)))
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0)
+    {
+        memmove(&p_list[slot + 1], &p_list[slot], (KEEP_BEST - 1 - slot) * sizeof(candidate_t));
+        p_list[slot].trace = *p_trace;
+        p_list[slot].result = *p_result;
+    }
+    return (slot >= 0);
+}
+
+/**
+ * @fn     evaluate
+ * @brief  Run a trace once and offer it to both best-of lists.
+ *
+ * @return 1 if it improved either list.
+ */
+
+static int evaluate(const trace_t * p_trace)
+{
+    result_t result;
+    int improved = 0;
+    run_trace(p_trace, 1, &result);
+    improved |= offer(best_process, p_trace, &result, 0);
+    improved |= offer(best_isr, p_trace, &result, 1);
+    return improved;
+}
+
+/**
+ * @fn     random_step
+ * @brief  A step with random levels and ISR mask and a boundary or random delta.
+ */
+
+static void random_step(step_t * p_step)
+{
+    p_step->level = (uint8_t)(rng_next() & ALL_BUTTONS);
+    p_step->isr = (uint8_t)(rng_next() & ALL_BUTTONS);
+    if (0 != (rng_next() & 1))
+    {
+        p_step->delta = boundary_deltas[rng_next() % BOUNDARY_COUNT];
+    }
+    else
+    {
+        p_step->delta = rng_next() % (LONG_PRESS_US * 2);
+    }
+}
+
+/**
+ * @fn     search_exhaustive
+ * @brief  Every EXHAUSTIVE_STEPS-step trace over the small alphabet.
+ */
+
+static void search_exhaustive(void)
+{
+    const uint32_t per_step = sizeof(small_levels) * 2 * BOUNDARY_COUNT;
+    uint32_t total = 1;
+    uint32_t n = 0;
+    uint8_t s = 0;
+    trace_t trace;
+    for (s=0; s<EXHAUSTIVE_STEPS; s++)
+    {
+        total *= per_step;
+    }
+    memset(&trace, 0, sizeof(trace));
+    trace.len = EXHAUSTIVE_STEPS;
+    for (n=0; n<total; n++)
+    {
+        uint32_t code = n;
+        for (s=0; s<EXHAUSTIVE_STEPS; s++)
+        {
+            uint32_t symbol = code % per_step;
+            code /= per_step;
+            trace.steps[s].delta = boundary_deltas[symbol % BOUNDARY_COUNT];
+            symbol /= BOUNDARY_COUNT;
+            trace.steps[s].isr = (0 != (symbol & 1)) ? ALL_BUTTONS : 0;
+            trace.steps[s].level = small_levels[symbol >> 1];
+        }
+        evaluate(&trace);
+    }
+    printf("exhaustive: %u traces of %u steps\n", total, EXHAUSTIVE_STEPS);
+}
+
+/**
+ * @fn     search_random
+ * @brief  Independent random traces.
+ */
+
+static void search_random(uint32_t iterations)
+{
+    uint32_t n = 0;
+    uint8_t s = 0;
+    trace_t trace;
+    for (n=0; n<iterations; n++)
+    {
+        trace.len = RANDOM_STEPS;
+        for (s=0; s<trace.len; s++)
+        {
+            random_step(&trace.steps[s]);
+        }
+        evaluate(&trace);
+    }
+    printf("random:     %u traces of %u steps\n", iterations, RANDOM_STEPS);
+}
+
+/**
+ * @fn     mutate
+ * @brief  Apply one random edit: replace, tweak or duplicate steps, insert or drop one.
+ */
+
+static void mutate(trace_t * p_trace)
+{
+    uint8_t s = (uint8_t)(rng_next() % p_trace->len);
+    switch (rng_next() % 6)
+    {
+        case 0:
+            random_step(&p_trace->steps[s]);
+            break;
+        case 1:
+            p_trace->steps[s].level ^= (uint8_t)(1U << (rng_next() % BUTTON_MAX));
+            break;
+        case 2:
+            p_trace->steps[s].isr ^= (uint8_t)(1U << (rng_next() % BUTTON_MAX));
+            break;
+        case 3:
+            p_trace->steps[s].delta = boundary_deltas[rng_next() % BOUNDARY_COUNT] + (rng_next() % 3) - 1;
+            break;
+        case 4:
+            if (p_trace->len < MAX_STEPS)
+            {
+                memmove(&p_trace->steps[s + 1], &p_trace->steps[s], (p_trace->len - s) * sizeof(step_t));
+                p_trace->len++;
+            }
+            break;
+        default:
+            if (p_trace->len > 1)
+            {
+                memmove(&p_trace->steps[s], &p_trace->steps[s + 1], (p_trace->len - s - 1) * sizeof(step_t));
+                p_trace->len--;
+            }
+            break;
+    }
+}
+
+/**
+ * @fn     search_guided
+ * @brief  Mutation search seeded with the worst traces found so far.
+ */
+
+static void search_guided(uint32_t iterations)
+{
+    uint32_t n = 0;
+    uint32_t improvements = 0;
+    trace_t trace;
+    for (n=0; n<iterations; n++)
+    {
+        const candidate_t * p_parent = (0 != (n & 1)) ? &best_isr[rng_next() % KEEP_BEST] : &best_process[rng_next() % KEEP_BEST];
+        uint32_t edits = 1 + (rng_next() % 4);
+        if (0 == p_parent->trace.len)
+        {
+            continue;
+        }
+        trace = p_parent->trace;
+        while (0 != edits--)
+        {
+            mutate(&trace);
+        }
+        improvements += (uint32_t)evaluate(&trace);
+    }
+    printf("guided:     %u mutations, %u improved a best-of list\n", iterations, improvements);
+}
+
+/**
+ * @fn     shrink
+ * @brief  Reduce a trace to the steps needed to reach its worst op count.
+ *
+ * Steps after the worst call are cut, then every earlier step is dropped if the
+ * worst call still costs at least as much without it.
+ */
+
+static void shrink(candidate_t * p_cand, int use_isr)
+{
+    const worst_t * p_w = use_isr ? &p_cand->result.isr : &p_cand->result.process;
+    uint32_t target = p_w->ops;
+    trace_t trial;
+    result_t result;
+    int i = 0;
+    p_cand->trace.len = (uint8_t)(p_w->step + 1);
+    for (i=(int)p_cand->trace.len - 2; i>=0; i--)
+    {
+        trial = p_cand->trace;
+        memmove(&trial.steps[i], &trial.steps[i + 1], (trial.len - i - 1) * sizeof(step_t));
+        trial.len--;
+        run_trace(&trial, 1, &result);
+        if ((use_isr ? result.isr.ops : result.process.ops) >= target)
+        {
+            p_cand->trace = trial;
+        }
+    }
+}
+
+/**
+ * @fn     report
+ * @brief  Shrink and re-measure a best-of list, then print the worst call with its trace.
+ */
+
+static void report(const char * p_name, candidate_t * p_list, int use_isr)
+{
+    candidate_t * p_worst = NULL;
+    uint64_t worst_cycles = 0;
+    int i = 0;
+    uint8_t s = 0;
+    for (i=0; i<KEEP_BEST; i++)
+    {
+        const worst_t * p_w = NULL;
+        if (0 == p_list[i].trace.len)
+        {
+            continue;
+        }
+        shrink(&p_list[i], use_isr);
+        run_trace(&p_list[i].trace, MEASURE_REPS, &p_list[i].result);
+        p_w = use_isr ? &p_list[i].result.isr : &p_list[i].result.process;
+        if ((NULL == p_worst) || (p_w->cycles > worst_cycles))
+        {
+            p_worst = &p_list[i];
+            worst_cycles = p_w->cycles;
+        }
+    }
+    if (NULL != p_worst)
+    {
+        const worst_t * p_w = use_isr ? &p_worst->result.isr : &p_worst->result.process;
+        printf("\nWCET %s: %llu cycles at step %u (min of %u replays); most driver calls: %u at step %u (worst of the list: %u)\n",
+               p_name, (unsigned long long)p_w->cycles, p_w->cycles_step, MEASURE_REPS, p_w->ops, p_w->step,
+               use_isr ? p_list[0].result.isr.ops : p_list[0].result.process.ops);
+        printf("  step  +ticks   pressed  isr\n");
+        for (s=0; s<p_worst->trace.len; s++)
+        {
+            const step_t * p_step = &p_worst->trace.steps[s];
+            printf("  %4u %8u   0x%02x     0x%02x%s\n", s, p_step->delta, p_step->level, p_step->isr,
+                   (s == p_w->cycles_step) ? "   <- worst" : "");
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t iterations = 20000;
+    if (argc > 1)
+    {
+        iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        rng_seed(strtoull(argv[2], NULL, 0));
+    }
+    setup_api();
+    if (0 != time_init())
+    {
+        fprintf(stderr, "driver rejected the harness configuration\n");
+        return 1;
+    }
+    memset(best_process, 0, sizeof(best_process));
+    memset(best_isr, 0, sizeof(best_isr));
+    search_exhaustive();
+    search_random(iterations);
+    search_guided(iterations);
+    printf("%llu traces replayed\n", (unsigned long long)traces_run);
+    report("button_process()", best_process, 0);
+    report("button_isr()", best_isr, 1);
+    return 0;
+}
@@ -5,19 +5,29 @@
 #include "driver/gptimer.h"
 #include "esp_log.h"
 
+// button_config_gen.h is generated from button_config.json at build time (see CMakeLists.txt)
+#define BUTTON_CFG_READ_LEVEL(pin)  gpio_get_level(pin)
+#include "button_config_gen.h"
+
 #define TICK_DIFF(tick)         (tick_elapsed(tick, get_current_tick()))
 #define USEC_TO_TICK(us)        (us * (SYSTEM_FREQUENCY / 1000000))
 #define MSEC_TO_TICK(ms)        (ms * (SYSTEM_FREQUENCY / 1000))
 #define GET_CURRENT_TIMER_TICK  (gptimer_get_raw_count(gptimer, &current_tick)) 
-#define BUTTON1_GPIO        (33)
-#define BUTTON2_GPIO        (32)
-#define SYSTEM_FREQUENCY    (40000000U)
+#define BUTTON1_GPIO        (BUTTON_CFG_PIN_BUTTON_1)
+#define BUTTON2_GPIO        (BUTTON_CFG_PIN_BUTTON_2)
+#define SYSTEM_FREQUENCY    (BUTTON_CFG_TICK_COUNT_IN_1US * 1000000U)
 
 static gptimer_handle_t gptimer = NULL;
-static button_api_t button_api;
 static uint64_t current_tick = 0;
 static const char * tag = "app_main";
 static uint32_t last_press_tick = 0;
+static const char * const action_names[] =
+{
+    [ACTION_SELECT] = "SELECT",
+    [ACTION_BACK] = "BACK",
+    [ACTION_MENU] = "MENU",
+    [ACTION_PREVIOUS] = "PREVIOUS",
+};
 
 static uint32_t get_current_tick(void)
 {
@@ -46,46 +56,25 @@ static uint32_t tick_elapsed(uint32_t start, uint32_t end)
     return diff;
 }
 
-static int32_t read_button(pin_config_t * p_pin)
-{
-    return (int32_t)gpio_get_level(p_pin->pin);
-}
-
 static void button_event_callback(button_pressed_types_t type, button_enum button_id)
 {
-    switch(type)
+    button_action_t action = BUTTON_CFG_ACTION_NONE;
+    // gestures of button_config.json, on the layer of the modifiers held at the press
+    action = button_keymap_lookup(&button_cfg_keymap, type, button_id);
+    if (BUTTON_CFG_ACTION_NONE != action)
     {
-        case BUTTON_NORMAL_PRESS:
-            ESP_LOGI("BUTTON_NORMAL_PRESS", "Button normally %d pressed\n", button_id);
-            break;
-        case BUTTON_LONG_PRESS:
-            ESP_LOGI("BUTTON_LONG_PRESS", "Button LONG %d pressed\n", button_id);
-            break;
-        case BUTTON_DOUBLE_PRESS:
-            ESP_LOGI("BUTTON_DOUBLE_PRESS", "Button DOUBLE %d pressed\n", button_id);
-            break;
-        default:
-            break;
+        ESP_LOGI(tag, "Button %d: %s\n", button_id, action_names[action]);
     }
 }
 
+static button_api_t button_api = BUTTON_CFG_API_INITIALIZER(tick_elapsed, get_current_tick, button_event_callback);
+static const button_derived_t button_derived = BUTTON_CFG_DERIVED_INITIALIZER;
+
 static void system_init(void)
 {
     // -------------button api init begin------------------
-    button_api.button_pins[BUTTON_1].pin = BUTTON1_GPIO;
-    button_api.button_pins[BUTTON_1].interrupt_mode = BUTTON_INTERRUPT_MODE_BOTH_EDGES;
-    button_api.button_pins[BUTTON_2].pin = BUTTON2_GPIO;
-    button_api.button_pins[BUTTON_2].interrupt_mode = BUTTON_INTERRUPT_MODE_NONE;
-    button_api.size_of_buttons = 2;
-    button_api.active_high = 0;
-    button_api.tick_count_in_1us = USEC_TO_TICK(1); //40MHz
-    button_api.debounce_us = 10000; //10ms
-    button_api.long_press_us = 1000000; //1s
-    button_api.fp_tick_elapsed = tick_elapsed;
-    button_api.fp_read_button = read_button;
-    button_api.fp_get_current_tick = get_current_tick;
-    button_api.fp_event_callback = button_event_callback;
-    int ret_value = button_initialize(&button_api);
+    // pins, modes and thresholds come from button_config.json
+    int ret_value = button_initialize_precomputed(&button_api, &button_derived);
     ESP_LOGI(tag, "button init ret value: %d", ret_value);
     // -------------button api init end------------------
 
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""Generate a constant button configuration header from a declarative spec.
+
+The spec (JSON) describes pins, interrupt modes, thresholds, gestures and
+chords. The generated header holds:
+
+  * BUTTON_CFG_API_INITIALIZER(...)  - a complete button_api_t initializer, so the
+    configuration is a single constant copy instead of field-by-field code;
+  * button_cfg_read_button()          - a scan routine specialised on the
+    configured pins (each case reads a constant pin);
+  * BUTTON_CFG_DERIVED_INITIALIZER     - thresholds in ticks and the pin lookup
+    table, for button_initialize_precomputed();
+  * keymap tables (button_keymap.h)   - actions per (layer, button, event) and the
+    layer selected by every held-modifier mask, precomputed here.
+
+All validation happens at generation time, so a bad spec fails the build
+instead of button_initialize() - or the compiler: names that end up in C
+(button names, actions) must be identifiers, and actions must not reuse the
+driver's BUTTON_ prefix.
+
+Usage: button_codegen.py <spec.json> <output.h>
+"""
+
+import json
+import re
+import sys
+
+BUTTON_MAX = 5
+MULTI_PRESS_US = 500000
+MAX_LAYERS = 4
+HOLD_LEVELS = 4
+EVENTS = {
+    "normal": "BUTTON_NORMAL_PRESS",
+    "long": "BUTTON_LONG_PRESS",
+    "double": "BUTTON_DOUBLE_PRESS",
+    "hold1": "BUTTON_HOLD_LEVEL_1",
+    "hold2": "BUTTON_HOLD_LEVEL_2",
+    "hold3": "BUTTON_HOLD_LEVEL_3",
+    "hold4": "BUTTON_HOLD_LEVEL_4",
+}
+MODES = {
+    "none": "BUTTON_INTERRUPT_MODE_NONE",
+    "rising_edge": "BUTTON_INTERRUPT_MODE_RISING_EDGE",
+    "falling_edge": "BUTTON_INTERRUPT_MODE_FALLING_EDGE",
+    "both_edges": "BUTTON_INTERRUPT_MODE_BOTH_EDGES",
+}
+IDENTIFIER = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+C_KEYWORDS = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum",
+    "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return",
+    "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void",
+    "volatile", "while", "_Bool", "_Complex", "_Imaginary", "_Static_assert", "_Thread_local",
+}
+UINT32_MAX = 0xFFFFFFFF
+
+
+class SpecError(Exception):
+    pass
+
+
+def require(condition, message):
+    if not condition:
+        raise SpecError(message)
+
+
+def load_spec(path):
+    with open(path, encoding="utf-8") as handle:
+        spec = json.load(handle)
+
+    tick_hz = spec.get("tick_hz")
+    require(isinstance(tick_hz, int) and tick_hz >= 1000000 and tick_hz % 1000000 == 0,
+            "tick_hz must be a whole number of MHz")
+    ticks_per_us = tick_hz // 1000000
+
+    for key in ("debounce_us", "long_press_us"):
+        require(isinstance(spec.get(key), int) and spec[key] > 0, "%s must be a positive integer" % key)
+    spec.setdefault("time_jump_us", 0)
+    spec.setdefault("active_high", False)
+    spec.setdefault("poll_interpolation", False)
+    require(spec["debounce_us"] < spec["long_press_us"], "debounce_us must be shorter than long_press_us")
+    for key in ("debounce_us", "long_press_us", "time_jump_us"):
+        require(spec[key] * ticks_per_us <= UINT32_MAX, "%s does not fit 32-bit ticks at %d Hz" % (key, tick_hz))
+
+    buttons = spec.get("buttons", [])
+    require(0 < len(buttons) <= BUTTON_MAX, "1..%d buttons required" % BUTTON_MAX)
+    names = {}
+    pins = set()
+    for index, button in enumerate(buttons):
+        name = button.get("name", "BUTTON_%d" % (index + 1))
+        require(isinstance(name, str) and IDENTIFIER.match(name),
+                "button %d: name %r must be a C identifier (it becomes BUTTON_CFG_PIN_<name>)" % (index + 1, name))
+        require(name not in names, "duplicate button name %s" % name)
+        require(isinstance(button.get("pin"), int) and 0 <= button["pin"] <= 255, "%s: pin must be 0..255" % name)
+        require(button.get("mode", "none") in MODES, "%s: unknown mode %s" % (name, button.get("mode")))
+        require(button.get("mode", "none") == "none" or button["pin"] not in pins,
+                "%s: interrupt pin %d used twice" % (name, button["pin"]))
+        require(isinstance(button.get("hw_filtered", False), bool), "%s: hw_filtered must be true or false" % name)
+        hold = button.get("hold_us", [])
+        require(isinstance(hold, list) and len(hold) <= HOLD_LEVELS
+                and all(isinstance(us, int) and 0 < us and us * ticks_per_us <= UINT32_MAX for us in hold),
+                "%s: hold_us must list up to %d positive thresholds that fit 32-bit ticks" % (name, HOLD_LEVELS))
+        require(all(a < b for a, b in zip(hold, hold[1:])), "%s: hold_us must increase" % name)
+        for key in ("press_debounce_us", "release_debounce_us"):
+            value = button.get(key, 0)
+            require(isinstance(value, int) and 0 <= value < spec["long_press_us"],
+                    "%s: %s must be 0 or shorter than long_press_us" % (name, key))
+            button[key] = value
+        require(not hold or hold[0] > button["press_debounce_us"], "%s: hold_us must be longer than press_debounce_us" % name)
+        names[name] = index
+        if button.get("mode", "none") != "none":
+            pins.add(button["pin"])
+        button["name"] = name
+        button.setdefault("mode", "none")
+        button.setdefault("hw_filtered", False)
+        button.setdefault("hold_us", [])
+
+    chords = spec.get("chords", [])
+    require(len(chords) < MAX_LAYERS, "at most %d chords (layers 1..%d)" % (MAX_LAYERS - 1, MAX_LAYERS - 1))
+    layers = {"base": 0}
+    for number, chord in enumerate(chords, start=1):
+        layer = chord.get("layer")
+        require(isinstance(layer, str) and layer not in layers, "chord %d needs a unique layer name" % number)
+        held = chord.get("hold", [])
+        require(len(held) > 0, "chord %s must hold at least one button" % layer)
+        for name in held:
+            require(name in names, "chord %s: unknown button %s" % (layer, name))
+        chord["mask"] = sum(1 << names[name] for name in set(held))
+        layers[layer] = number
+
+    actions = ["BUTTON_CFG_ACTION_NONE"]
+    mapping = {}
+    for gesture in spec.get("gestures", []):
+        layer = gesture.get("layer", "base")
+        button = gesture.get("button")
+        event = gesture.get("event")
+        action = gesture.get("action")
+        require(layer in layers, "gesture: unknown layer %s" % layer)
+        require(button in names, "gesture: unknown button %s" % button)
+        require(event in EVENTS, "gesture: unknown event %s" % event)
+        require(isinstance(action, str) and IDENTIFIER.match(action) and action not in C_KEYWORDS,
+                "gesture: action %r must be a C identifier" % (action,))
+        require(not action.startswith("BUTTON_"),
+                "gesture: action %s clashes with the driver's BUTTON_ names (including BUTTON_CFG_ACTION_NONE)" % action)
+        key = (layers[layer], names[button], event)
+        require(key not in mapping, "gesture %s/%s/%s mapped twice" % (layer, button, event))
+        if action not in actions:
+            actions.append(action)
+        mapping[key] = action
+
+    spec.setdefault("pin_lut_size", 64)
+    require(isinstance(spec["pin_lut_size"], int) and 1 <= spec["pin_lut_size"] <= 256,
+            "pin_lut_size must be 1..256 (BUTTON_PIN_LUT_SIZE)")
+    require(MULTI_PRESS_US * ticks_per_us <= UINT32_MAX, "multi-press window does not fit 32-bit ticks at %d Hz" % tick_hz)
+    spec["ticks_per_us"] = ticks_per_us
+    spec["layer_count"] = len(chords) + 1
+    spec["actions"] = actions
+    spec["mapping"] = mapping
+    return spec
+
+
+def layer_of_mask(mask, chords):
+    layer = 0
+    for number, chord in enumerate(chords, start=1):
+        if (mask & chord["mask"]) == chord["mask"]:
+            layer = number
+    return layer
+
+
+def render(spec, source):
+    ticks = spec["ticks_per_us"]
+    buttons = spec["buttons"]
+    chords = spec.get("chords", [])
+    out = []
+    emit = out.append
+
+    emit("/* Generated by tools/button_codegen.py from %s - do not edit. */" % source)
+    emit("#ifndef BUTTON_CONFIG_GEN_H")
+    emit("#define BUTTON_CONFIG_GEN_H")
+    emit("")
+    emit("#include <stdint.h>")
+    emit('#include "button.h"')
+    emit('#include "button_keymap.h"')
+    emit("")
+    emit("#ifndef BUTTON_CFG_READ_LEVEL")
+    emit('#error "define BUTTON_CFG_READ_LEVEL(pin) to read the raw level of a constant pin"')
+    emit("#endif")
+    emit("")
+    emit("#define BUTTON_CFG_COUNT                (%d)" % len(buttons))
+    emit("#define BUTTON_CFG_TICK_COUNT_IN_1US    (%dU)" % ticks)
+    emit("#define BUTTON_CFG_LAYER_COUNT          (%d)" % spec["layer_count"])
+    for button in buttons:
+        emit("#define BUTTON_CFG_PIN_%-20s (%d)" % (button["name"], button["pin"]))
+    emit("")
+    emit("typedef enum")
+    emit("{")
+    for action in spec["actions"]:
+        emit("    %s," % action)
+    emit("} button_cfg_action_t;")
+    emit("")
+    emit("static inline int32_t button_cfg_read_button(pin_config_t * p_pin)")
+    emit("{")
+    emit("    switch (p_pin->pin)")
+    emit("    {")
+    for pin in sorted(set(button["pin"] for button in buttons)):
+        emit("        case %d: return (int32_t)BUTTON_CFG_READ_LEVEL(%d);" % (pin, pin))
+    emit("        default: return %d;" % (0 if spec["active_high"] else 1))
+    emit("    }")
+    emit("}")
+    emit("")
+    emit("#define BUTTON_CFG_API_INITIALIZER(fp_elapsed, fp_tick, fp_callback) \\")
+    emit("    { \\")
+    emit("        .button_pins = { \\")
+    for index, button in enumerate(buttons):
+        hold = (", .hold_us = { %s }" % ", ".join("%dU" % us for us in button["hold_us"])) if button["hold_us"] else ""
+        for key in ("press_debounce_us", "release_debounce_us"):
+            hold += (", .%s = %dU" % (key, button[key])) if button[key] else ""
+        emit("            [%d] = { .pin = %d, .interrupt_mode = %s, .hw_filtered = %d%s }, \\"
+             % (index, button["pin"], MODES[button["mode"]], 1 if button["hw_filtered"] else 0, hold))
+    emit("        }, \\")
+    emit("        .size_of_buttons = %d, \\" % len(buttons))
+    emit("        .active_high = %d, \\" % (1 if spec["active_high"] else 0))
+    emit("        .poll_interpolation = %d, \\" % (1 if spec["poll_interpolation"] else 0))
+    emit("        .tick_count_in_1us = %dU, \\" % ticks)
+    emit("        .debounce_us = %dU, \\" % spec["debounce_us"])
+    emit("        .long_press_us = %dU, \\" % spec["long_press_us"])
+    emit("        .time_jump_us = %dU, \\" % spec["time_jump_us"])
+    emit("        .fp_tick_elapsed = (fp_elapsed), \\")
+    emit("        .fp_read_button = button_cfg_read_button, \\")
+    emit("        .fp_get_current_tick = (fp_tick), \\")
+    emit("        .fp_event_callback = (fp_callback), \\")
+    emit("    }")
+    emit("")
+    emit("#define BUTTON_CFG_DERIVED_INITIALIZER \\")
+    slots = ", ".join("[%d] = %d" % (b["pin"], i + 1) for i, b in enumerate(buttons)
+                      if b["mode"] != "none" and b["pin"] < spec["pin_lut_size"])
+    emit("    { \\")
+    emit("        BUTTON_DERIVED_FIELDS(%dU, %dU, %dU, %dU), \\"
+         % (ticks, spec["debounce_us"], spec["long_press_us"], spec["time_jump_us"]))
+    hold = ", ".join("[%d] = { %s }" % (i, ", ".join("%dU" % (us * ticks) for us in b["hold_us"]))
+                     for i, b in enumerate(buttons) if b["hold_us"])
+    if hold:
+        emit("        .hold_tick = { %s }, \\" % hold)
+    for key in ("press_debounce", "release_debounce"):
+        ticks_of = ", ".join("[%d] = %dU" % (i, b[key + "_us"] * ticks) for i, b in enumerate(buttons) if b[key + "_us"])
+        if ticks_of:
+            emit("        .%s_tick = { %s }, \\" % (key, ticks_of))
+    emit("        .pin_slot = { %s }, \\" % (slots or "0"))
+    emit("    }")
+    emit("")
+    masks = 1 << BUTTON_MAX
+    emit("static const uint8_t button_cfg_layer_of_mask[BUTTON_KEYMAP_MASKS] =")
+    emit("{")
+    for row in range(0, masks, 16):
+        emit("    " + ", ".join(str(layer_of_mask(mask, chords)) for mask in range(row, row + 16)) + ",")
+    emit("};")
+    emit("")
+    emit("static const button_action_t button_cfg_actions[BUTTON_KEYMAP_SIZE(BUTTON_CFG_LAYER_COUNT)] =")
+    emit("{")
+    for (layer, index, event), action in sorted(spec["mapping"].items()):
+        emit("    [BUTTON_KEYMAP_INDEX(%d, %d, %s)] = %s," % (layer, index, EVENTS[event], action))
+    emit("};")
+    emit("")
+    emit("static const button_keymap_t button_cfg_keymap =")
+    emit("{")
+    emit("    button_cfg_actions,")
+    emit("    button_cfg_layer_of_mask,")
+    emit("    BUTTON_CFG_LAYER_COUNT,")
+    emit("};")
+    emit("")
+    emit("_Static_assert(BUTTON_CFG_COUNT <= BUTTON_MAX, \"too many buttons for BUTTON_MAX\");")
+    emit("_Static_assert(BUTTON_PIN_LUT_SIZE == %d, \"regenerate with the current BUTTON_PIN_LUT_SIZE (pin_lut_size)\");" % spec["pin_lut_size"])
+    emit("_Static_assert(BUTTON_KEYMAP_MASKS == %d, \"regenerate for the current BUTTON_MAX\");" % masks)
+    emit("")
+    emit("#endif // BUTTON_CONFIG_GEN_H")
+    return "\n".join(out) + "\n"
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s <spec.json> <output.h>\n" % argv[0])
+        return 2
+    try:
+        spec = load_spec(argv[1])
+    except (SpecError, ValueError, OSError) as error:
+        sys.stderr.write("%s: %s\n" % (argv[1], error))
+        return 1
+    text = render(spec, argv[1].replace("\\", "/").split("/")[-1])
+    try:
+        with open(argv[2], encoding="utf-8") as handle:
+            if handle.read() == text:
+                return 0
+    except OSError:
+        pass
+    with open(argv[2], "w", encoding="utf-8") as handle:
+        handle.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))